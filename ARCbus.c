@@ -1,644 +1,2129 @@
-#include <ctl.h>
-#include <msp430.h>
-#include <stdlib.h>
-#include "timerA.h"
-#include "ARCbus.h"
-#include "crc.h"
-#include "spi.h"
-
-#include "ARCbus_internal.h"
-
-__thread unsigned char BUS_thread_addr_flags=0;
-
-//=======================================================================================
-//                                 [BUS Functions]
-//=======================================================================================
-
-//return own address
-unsigned char BUS_get_OA(void){
-  int i;
-  //base address for own I2C addresses
-  volatile unsigned int * const oa_base=&UCB0I2COA0;
-  unsigned char addr;
-  //check for default address flags
-  if(BUS_thread_addr_flags!=0){
-    //try to get thread specific address
-    addr=BUS_flags_to_addr(BUS_thread_addr_flags);
-    //check for success
-    if(!(addr&BUS_FLAGS_ADDR_MASK) && addr!=BUS_ADDR_GC){
-      //return address
-      return addr;
-    }
-    //report error
-    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_I2C,I2C_ERR_INVALID_FLAGS,(BUS_thread_addr_flags<<8)|(addr));
-    //reset flags to default
-    BUS_thread_addr_flags=0;
-  }
-  //Fallback loop through addresses and return the first one that is enabled
-  for(i=0;i<4;i++){
-    //check if address enabled
-    if(oa_base[i]&UCOAEN){
-      //return address
-      return (~(UCGCEN|UCOAEN))&oa_base[i];
-    }
-  }
-  //no match! return OA0
-  //TODO: report error? do something else?
-  return UCB0I2COA0;
-}//return own address
-
-
-//set own address, this is done on a per-task basis
-unsigned char BUS_set_OA(unsigned char addr){
-  unsigned char flags;
-  //get flags from address
-  flags=BUS_addr_to_flags(addr);
-  //check for error
-  switch(flags){
-    case BUS_FLAGS_ADDR_DISABLED:
-    case BUS_FLAGS_INVALID_ADDR:
-    case CMD_PARSE_GC_ADDR:
-      //return error from BUS_addr_to_flags
-      //TODO: is there a better way to do this?
-      return flags;
-    default:
-      //set flags for this task
-      BUS_thread_addr_flags=flags;
-      //return success
-      return RET_SUCCESS;
-  }
-}
-
-//enable extra I2C own address registers
-int BUS_I2C_aux_addr(unsigned char addr,unsigned char dest){
-  switch(dest){
-    case CMD_PARSE_ADDR1:
-      //check if address is enabled
-      if(UCOAEN&UCB0I2COA1){
-        //error, address is already enabled
-        return ERR_BAD_ADDR;
-      }
-      //enable interrupts for address 2
-      UCB0IE|=UCTXIE1|UCRXIE1;
-      //set and enable address 1
-      UCB0I2COA1=UCOAEN|addr;
-    break;
-    case CMD_PARSE_ADDR2:
-      //check if address is enabled
-      if(UCOAEN&UCB0I2COA2){
-        //error, address is already enabled
-        return ERR_BAD_ADDR;
-      }
-      //enable interrupts for address 2
-      UCB0IE|=UCTXIE2|UCRXIE2;
-      //set and enable address 2
-      UCB0I2COA2=UCOAEN|addr;
-    break;
-    case CMD_PARSE_ADDR3:
-      //check if address is enabled
-      if(UCOAEN&UCB0I2COA3){
-        //error, address is already enabled
-        return ERR_BAD_ADDR;
-      }
-      //enable interrupts for address 3
-      UCB0IE|=UCTXIE3|UCRXIE3;
-      //set and enable address 3
-      UCB0I2COA3=UCOAEN|addr;
-    break;
-    default:
-      //all other values are invalid
-      return ERR_INVALID_ARGUMENT;
-  }
-  return RET_SUCCESS;
-}
-
-//return I2C address based on flags
-unsigned char BUS_flags_to_addr(unsigned char flags){
-  switch(flags){
-    case CMD_PARSE_ADDR0:
-      //check if address is enabled
-      if(UCOAEN&UCB0I2COA0){
-        //return address without GCEN or OAEN bits
-        return (~(UCGCEN|UCOAEN))&UCB0I2COA0;
-      }
-    break;
-    case CMD_PARSE_ADDR1:
-      //check if address is enabled
-      if(UCOAEN&UCB0I2COA1){
-        //return address without GCEN or OAEN bits
-        return (~(UCGCEN|UCOAEN))&UCB0I2COA1;
-      }
-    break;
-    case CMD_PARSE_ADDR2:
-      //check if address is enabled
-      if(UCOAEN&UCB0I2COA2){
-        //return address without GCEN or OAEN bits
-        return (~(UCGCEN|UCOAEN))&UCB0I2COA2;
-      }
-    break;
-    case CMD_PARSE_ADDR3:
-      //check if address is enabled
-      if(UCOAEN&UCB0I2COA3){
-        //return address without GCEN or OAEN bits
-        return (~(UCGCEN|UCOAEN))&UCB0I2COA3;
-      }
-    break;
-    case CMD_PARSE_GC_ADDR:
-      return BUS_ADDR_GC;
-    default:
-      return BUS_FLAGS_INVALID_ADDR;
-  }
-  return BUS_FLAGS_ADDR_DISABLED;
-}
-
-//find flags for address, address must be enabled
-unsigned char BUS_addr_to_flags(unsigned char addr){
-  int i,disabled;
-  //base address for own I2C addresses
-  volatile unsigned int * const oa_base=&UCB0I2COA0;
-  //loop through addresses to find a match
-  for(i=0,disabled;i<4;i++){
-    //check for a match
-    if(((~(UCGCEN|UCOAEN))&oa_base[i])==addr){
-      //check if address is enabled
-      if(oa_base[i]&UCOAEN){
-        //Success!!, return flags for address
-        return CMD_PARSE_ADDR0<<i;
-      }else{
-        //disabled, set flag
-        disabled=1;
-      }
-    }
-  }
-  //TODO: are these the best error values to return??
-  //check if address was disabled
-  if(disabled){
-    //return disabled error
-    return BUS_FLAGS_ADDR_DISABLED;
-  }else{
-    //return invalid flags error
-    return BUS_FLAGS_INVALID_ADDR;
-  }
-}//return own address
-
-//Setup buffer for command 
-unsigned char *BUS_cmd_init(unsigned char *buf,unsigned char id){
-  buf[1]=id;
-  //set originator address
-  buf[0]=BUS_get_OA();
-  //start of payload
-  return buf+2;
-}
-
-//check for own address
-int BUS_OA_check(unsigned char addr){
-  int i;
-  //base address for own I2C addresses
-  volatile unsigned int * const oa_base=&UCB0I2COA0;
-  //check if addr matches any slave address
-  for(i=0;i<4;i++){
-    //skip if address disabled
-    if(!(oa_base[i]&UCOAEN))continue;
-    //check for address match
-    if(addr==((~(UCGCEN|UCOAEN))&oa_base[i])){
-      return ERR_BAD_ADDR;
-    }
-  }
-  //not a match success!
-  return RET_SUCCESS;
-}
-
-//function to check I2C addresses
-int addr_chk(unsigned char addr){
-  //check if 8th bit is set
-  if(addr&0x80){
-    return ERR_BAD_ADDR;
-  }
-  //success!
-  return RET_SUCCESS;
-}
-
-static ticker packet_time=0;
-
-static unsigned BUS_I2C_lock(void){
-  int i;
-  //try to capture mutex
-  if(0==ctl_mutex_lock(&arcBus_stat.i2c_stat.mutex,CTL_TIMEOUT_DELAY,100)){
-     return ERR_BUSY;
-  }
-  return 0;
-} 
-
-//release the I2C bus
-void BUS_I2C_release(void){
-  ctl_mutex_unlock(&arcBus_stat.i2c_stat.mutex);
-}
-
-//keep track of which errors have happened
-static int BUS_I2C_err_track(int error){
-  //keep track of how many errors have happened
-  static errors=0;
-  //check which error happened
-  switch(error){
-    //I2C start timeout error happened
-    case ERR_I2C_START_TIMEOUT:
-      //This error causes problems reset after only a few errors
-      if(errors>3){
-        //reset MSP430 to clear the error
-        reset(ERR_LEV_ERROR+20,BUS_ERR_SRC_I2C,I2C_ERR_TOO_MANY_ERRORS,error);
-      }
-      errors++;
-    break;
-    //These errors happen when the device is not found or busy
-    case ERR_I2C_NACK:
-    case BUS_EV_I2C_TX_SELF:
-    case BUS_EV_I2C_ABORT:
-      //Do nothing, errors are not cleared or incremented
-    break;
-    //send successful!
-    case RET_SUCCESS:
-      //reset error count
-      errors=0;
-    break;
-    //Clock low timeout
-    case BUS_EV_I2C_ERR_CCL:
-      //This error does not happen too often
-      if(errors>10){
-        //reset MSP430 to clear the error
-        reset(ERR_LEV_ERROR+20,BUS_ERR_SRC_I2C,I2C_ERR_TOO_MANY_ERRORS,error);
-      }
-      errors++;
-    break;
-    //Other or unknown error
-    default:
-      //reset if a lot of these happen
-      if(errors>40){
-        //reset MSP430 to clear the error
-        reset(ERR_LEV_ERROR+20,BUS_ERR_SRC_I2C,I2C_ERR_TOO_MANY_ERRORS,error);
-      }
-      errors++;
-    break;
-  }
-  //release I2C bus
-  BUS_I2C_release();
-  //return error
-  return error;
-}
-
-//send command
-int BUS_cmd_tx(unsigned char addr,void *buff,unsigned short len,unsigned short flags){
-  unsigned int e;
-  short ret;
-  int i;
-  unsigned char resp[2];
-  //check address
-  if((ret=addr_chk(addr))!=RET_SUCCESS){
-    //return error if it occured
-    return ret;
-  }
-  //check packet length
-  if(len>BUS_I2C_MAX_PACKET_LEN){
-    return ERR_PACKET_TOO_LONG;
-  }
-  //add standard header length
-  len+=BUS_I2C_HDR_LEN;
-  //add NACK flag if requested
-  if(flags&BUS_CMD_FL_NACK){
-    //request NACK
-    ((unsigned char*)buff)[0]|=CMD_TX_NACK;
-  }else{
-    //clear NACK request
-    ((unsigned char*)buff)[0]&=~CMD_TX_NACK;
-  }
-  //calculate CRC
-  ((unsigned char*)buff)[len]=crc7(buff,len);
-  //add a byte for the CRC
-  len+=BUS_I2C_CRC_LEN;
-  //check for zero length
-  if(len==0){
-    return ERR_BAD_LEN;
-  }
-  //wait for the bus to become free
-  if(BUS_I2C_lock()){
-    //I2C bus is in use
-    return ERR_BUSY;
-  }
-  //Setup for I2C transaction  
-  //set slave address
-  UCB0I2CSA=addr;
-  //set index
-  arcBus_stat.i2c_stat.tx.idx=0;
-  //set I2C master state
-  arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_PENDING;
-  //set length
-  arcBus_stat.i2c_stat.tx.len=len;
-  //set data
-  arcBus_stat.i2c_stat.tx.ptr=(unsigned char*)buff;
-  //set to transmit mode
-  UCB0CTLW0|=UCTR;
-  //clear master I2C flags
-  ctl_events_set_clear(&arcBus_stat.events,0,BUS_EV_I2C_MASTER|BUS_EV_I2C_MASTER_START);
-  //set master mode
-  UCB0CTLW0|=UCMST;
-  //UCB0CTLW0|=UCMST|UCTR;
-  //generate start condition
-  UCB0CTL1|=UCTXSTT;
-  //wait for packet to start
-  e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&arcBus_stat.events,BUS_EV_I2C_MASTER_START,CTL_TIMEOUT_DELAY,50);
-  //check to see if there was a problem
-  if(!(e&BUS_EV_I2C_MASTER_STARTED)){
-    //clear start bit
-    UCB0CTL1&=~UCTXSTT;
-    //set I2C master state
-    arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_IDLE;
-    //chech which error happened
-    switch(e&BUS_EV_I2C_MASTER_START){
-      case 0:
-        //no event happened so timeout
-        return BUS_I2C_err_track(ERR_I2C_START_TIMEOUT);
-      case BUS_EV_I2C_NACK:
-        //I2C device did not acknowledge
-        return BUS_I2C_err_track(ERR_I2C_NACK);
-      default:
-        //error is not defined
-        return BUS_I2C_err_track(ERR_UNKNOWN);
-    }
-  }
-  //wait for transaction to complete
-  e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&arcBus_stat.events,BUS_EV_I2C_MASTER,CTL_TIMEOUT_DELAY,50);
-  //save transaction time
-  packet_time=get_ticker_time();
-  //set I2C master state
-  arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_IDLE;
-  //check which event(s) happened
-  switch(e&BUS_EV_I2C_MASTER){
-    case BUS_EV_I2C_COMPLETE:
-      //no error
-      return BUS_I2C_err_track(RET_SUCCESS);
-    case BUS_EV_I2C_NACK:
-      //I2C device did not acknowledge
-      return BUS_I2C_err_track(ERR_I2C_NACK);
-    case BUS_EV_I2C_ABORT:
-      //I2C device did not acknowledge
-      return BUS_I2C_err_track(ERR_I2C_ABORT);
-    case 0:
-      //no event happened, so time out
-      return BUS_I2C_err_track(ERR_TIMEOUT);
-    case BUS_EV_I2C_ERR_CCL:
-      //Clock low timeout
-      return BUS_I2C_err_track(ERR_I2C_CLL);
-    case BUS_EV_I2C_TX_SELF:
-      //TX to self and no one else responded
-      return BUS_I2C_err_track(ERR_I2C_TX_SELF);
-    default:
-      //error is not defined
-      return BUS_I2C_err_track(ERR_UNKNOWN);
-  }
-}
-
-//send/receive SPI data over the bus
-int BUS_SPI_txrx(unsigned char addr,void *tx,void *rx,unsigned short len){
-  unsigned char buf[10],*ptr;
-  unsigned int e;
-  short time;
-  int i,resp;
-  unsigned short crc;
-  //check address
-  if((resp=addr_chk(addr))!=RET_SUCCESS){
-    //return error if it occured
-    return resp;
-  }
-  //reject own address
-  if((resp=BUS_OA_check(addr))!=RET_SUCCESS){
-    //return error if it occured
-    return resp;
-  }
-  //reject General call address
-  if(addr==BUS_ADDR_GC){
-    return ERR_BAD_ADDR;
-  }
-  //calculate CRC
-  crc=crc16(tx,len);
-  //send CRC in Big endian order
-  ((unsigned char*)tx)[len]=crc>>8;
-  ((unsigned char*)tx)[len+1]=crc;
-  //setup SPI structure
-  arcBus_stat.spi_stat.len=len;
-  arcBus_stat.spi_stat.rx=rx;
-  arcBus_stat.spi_stat.tx=tx;
-  arcBus_stat.spi_stat.nack=0;
-  //disable DMA
-  DMA0CTL&=~DMAEN;
-  DMA1CTL&=~DMAEN;
-  DMA2CTL&=~DMAEN;
-  //Setup SPI
-  SPI_slave_setup();
-  //setup DMA for transfer
-  DMACTL0 &=~(DMA0TSEL_31|DMA1TSEL_31);
-  DMACTL0 |= (DMA0TSEL__USCIA0RX|DMA1TSEL__USCIA0TX);
-  DMACTL1 = DMA2TSEL__USCIA0TX;
-  //====[DMA channel0 used for receive]====
-  //check for omitted receive buffer
-  if(rx!=NULL){
-    // Source DMA address: receive register.
-    *((unsigned int*)&DMA0SA) = (unsigned short)(&UCA0RXBUF);
-    // Destination DMA address: rx buffer.
-    *((unsigned int*)&DMA0DA) = (unsigned short)rx;
-    // The size of the block to be transferred
-    DMA0SZ = len+BUS_SPI_CRC_LEN;
-    // Configure the DMA transfer, single byte transfer with source increment
-    DMA0CTL =DMADT_0|DMASBDB|DMAEN|DMASRCINCR_3|DMADSTINCR_0;
-  }
-  //====[DMA channel2 used for DMA9 fix]====
-  //DMA9 workaround, use a dummy channel with lower priority and the same trigger
-  //setup dummy channel: read and write from unused space in the SPI registers
-  *((unsigned int*)&DMA2SA) = EUSCI_A0_BASE + 0x02;
-  *((unsigned int*)&DMA2DA) = EUSCI_A0_BASE + 0x04;
-  // only one byte
-  DMA2SZ = 1;
-  // Configure the DMA transfer, repeated byte transfer with no increment
-  DMA2CTL = DMADT_4|DMASBDB|DMAEN|DMASRCINCR_0|DMADSTINCR_0;
-  //====[DMA channel1 used for transmit]====
-  // Destination DMA address: the transmit buffer.
-  *((unsigned int*)&DMA1DA) = (unsigned int)(&UCA0TXBUF);
-  //check for omitted transmit buffer
-  if(tx!=NULL){
-    // Source DMA address: tx buffer
-    *((unsigned int*)&DMA1SA) =((unsigned int)tx)+1;
-    // The size of the block to be transferred
-    DMA1SZ = len+BUS_SPI_CRC_LEN-1;
-    // Configure the DMA transfer, single byte transfer with destination increment
-    //enable interrupt to notify code when transfer is complete
-    DMA1CTL=DMADT_0|DMASBDB|DMASRCINCR_3|DMADSTINCR_0|DMAEN;
-    //start things off with an initial transfer
-    UCA0TXBUF=*((unsigned char*)tx);
-  }else{
-    //need to send something to receive something so setup TX for dummy bytes
-    *((unsigned int*)&DMA1SA) = (unsigned int)(&UCA0TXBUF);
-    // The size of the block to be transferred
-    DMA1SZ = len+BUS_SPI_CRC_LEN-1;
-    // Configure the DMA transfer, single byte transfer with no increment
-    DMA1CTL=DMADT_0|DMASBDB|DMASRCINCR_0|DMADSTINCR_0|DMAEN;
-    //start things off with an initial transfer
-    UCA0TXBUF=BUS_SPI_DUMMY_DATA;
-  }
-  //send SPI setup command
-  ptr=BUS_cmd_init(buf,CMD_SPI_RDY);
-  //send MSB first
-  ptr[0]=len>>8;
-  //then send LSB
-  ptr[1]=len;
-  //send command
-  resp=BUS_cmd_tx(addr,buf,2,BUS_CMD_FL_NACK);
-  //check if sent correctly
-  if(resp!=RET_SUCCESS){
-    //disable DMA
-    DMA0CTL&=~DMAEN;
-    DMA1CTL&=~DMAEN; 
-    DMA2CTL&=~DMAEN; 
-    //SPI pins back to GPIO
-    SPI_deactivate();
-    //Return Error
-    //TODO: better error code here
-    return resp;
-  }
-  //calculate wait time based on packet length
-  time=len/10;
-  if(time<=BUS_SPI_MIN_TIMEOUT){
-    time=BUS_SPI_MIN_TIMEOUT;
-  }
-  //wait for SPI complete signal from master
-  e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&arcBus_stat.events,BUS_EV_SPI_MASTER,CTL_TIMEOUT_DELAY,time);
-  //disable DMA
-  DMA0CTL&=~DMAEN;
-  DMA1CTL&=~DMAEN; 
-  DMA2CTL&=~DMAEN; 
-  //SPI pins back to GPIO
-  SPI_deactivate();
-  //Check if SPI complete event received
-  if(e&BUS_EV_SPI_COMPLETE){
-    //check for errors from the destination
-    if(arcBus_stat.spi_stat.nack!=0){
-      //error from the other system, return it
-      return arcBus_stat.spi_stat.nack;
-    }
-    //if RX is null then don't calculate CRC
-    if(rx!=NULL){
-        //check if DMA0 finished receiving 
-        if(!(DMA0CTL&DMAIFG)){
-          //Error : DMA timed out (CRC is probably bad)
-          return ERR_DMA_TIMEOUT;
-        }
-        //assemble CRC
-        crc=((unsigned char*)rx)[arcBus_stat.spi_stat.len+1];//LSB
-        crc|=(((unsigned short)((unsigned char*)rx)[arcBus_stat.spi_stat.len])<<8);//MSB
-        //check CRC
-        if(crc!=crc16(rx,arcBus_stat.spi_stat.len)){
-          //Bad CRC
-          return ERR_BAD_CRC;
-        }
-    }
-    //check if DMA1 finished transmitting
-    if(!(DMA1CTL&DMAIFG)){
-      //Error : DMA timed out (CRC is probably bad on the other end)
-      return ERR_DMA_TIMEOUT;
-    }
-    //Success!!
-    return RET_SUCCESS;
-  }else if(e&BUS_EV_SPI_NACK){
-    char tmp=arcBus_stat.spi_stat.nack;
-    //clear NACK reason
-    arcBus_stat.spi_stat.nack=0;
-    //check why NACK was sent
-    switch(tmp){
-      case ERR_PK_LEN:
-        //not sure why this could have happened
-        return ERR_INVALID_ARGUMENT;
-      break;
-      case ERR_SPI_LEN:
-        //SPI data is bigger than the buffer
-        return ERR_BAD_LEN;
-      break;
-      case ERR_SPI_BUSY:
-      case ERR_BUFFER_BUSY:
-        //the other MSP is busy
-        return ERR_BUSY;
-      break;
-      default:
-        return ERR_UNKNOWN;
-    }
-  }else{
-    //timeout occurred, send SPI abort packet
-    ptr=BUS_cmd_init(buf,CMD_SPI_ABORT);
-    resp=BUS_cmd_tx(addr,buf,0,BUS_CMD_FL_NACK);
-    //Return error, timeout occurred
-    return ERR_TIMEOUT;
-  }
-}
-
-//assert one or more interrupts on the bus
-void BUS_int_set(unsigned char set){
-    //disable interrupts for the pins
-    P1IE&=~set;
-    //set output level to high
-    P1OUT|=set;
-    //set pins to output
-    P1DIR|=set;
-#ifdef CDH_LIB
-    //if CDH set to full drive strength
-    P1REN&=~set;
-#endif        
-}
-    
-//de-assert one or more interrupts on the bus
-void BUS_int_clear(unsigned char clear){
-#ifdef CDH_LIB
-    //if CDH set to pull resistor
-    P1REN|=clear;
-#endif  
-    //set pins to input
-    P1DIR&=~clear;
-#ifdef CDH_LIB
-    //if CDH set to pull down
-    P1OUT&=~clear;
-#endif
-    //clear interrupt flag
-    P1IFG&=~clear;
-    //enable interrupts for the pins
-    P1IE|=clear;
-}
-
-//return which build is used
-int BUS_build(void){
-#ifdef CDH_LIB
-    return BUS_BUILD_CDH;
-#else
-    return BUS_BUILD_SUBSYSTEM;
-#endif
-}
-
-//timeout delay for time specified in milliseconds    
-void BUS_delay_msec(CTL_TIME_t timeout){
-  //TODO: calculate time in msec
-  //make sure timeout is greater than two
-  if(timeout<2){
-    //set timeout to minimum
-    timeout=2;
-  }
-  //wait for time to expire
-  ctl_timeout_wait(ctl_get_current_time()+timeout);
-}
-
-//timeout delay for time specified in microseconds
-void BUS_delay_usec(CTL_TIME_t timeout){
-  //calculate time in usec
-  timeout=(timeout+488)/977;
-  //make sure timeout is greater than two
-  if(timeout<2){
-    //set timeout to minimum
-    timeout=2;
-  }
-  //wait for time to expire
-  ctl_timeout_wait(ctl_get_current_time()+timeout);
-}
- 
+#include <ctl.h>
+#include <msp430.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timerA.h"
+#include "ARCbus.h"
+#include "crc.h"
+#include "spi.h"
+#include "compress.h"
+
+#include "ARCbus_internal.h"
+
+__thread unsigned char BUS_thread_addr_flags=0;
+
+//=======================================================================================
+//                                 [BUS Functions]
+//=======================================================================================
+
+//return own address
+unsigned char BUS_get_OA(void){
+  int i;
+  //base address for own I2C addresses
+  volatile unsigned int * const oa_base=&UCB0I2COA0;
+  unsigned char addr;
+  //check for default address flags
+  if(BUS_thread_addr_flags!=0){
+    //try to get thread specific address
+    addr=BUS_flags_to_addr(BUS_thread_addr_flags);
+    //check for success
+    if(!(addr&BUS_FLAGS_ADDR_MASK) && addr!=BUS_ADDR_GC){
+      //return address
+      return addr;
+    }
+    //report error
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_I2C,I2C_ERR_INVALID_FLAGS,(BUS_thread_addr_flags<<8)|(addr));
+    //reset flags to default
+    BUS_thread_addr_flags=0;
+  }
+  //Fallback loop through addresses and return the first one that is enabled
+  for(i=0;i<4;i++){
+    //check if address enabled
+    if(oa_base[i]&UCOAEN){
+      //return address
+      return (~(UCGCEN|UCOAEN))&oa_base[i];
+    }
+  }
+  //no match! return OA0
+  //TODO: report error? do something else?
+  return UCB0I2COA0;
+}//return own address
+
+
+//set own address, this is done on a per-task basis
+unsigned char BUS_set_OA(unsigned char addr){
+  unsigned char flags;
+  //get flags from address
+  flags=BUS_addr_to_flags(addr);
+  //check for error
+  switch(flags){
+    case BUS_FLAGS_ADDR_DISABLED:
+    case BUS_FLAGS_INVALID_ADDR:
+    case CMD_PARSE_GC_ADDR:
+      //return error from BUS_addr_to_flags
+      //TODO: is there a better way to do this?
+      return flags;
+    default:
+      //set flags for this task
+      BUS_thread_addr_flags=flags;
+      //return success
+      return RET_SUCCESS;
+  }
+}
+
+//enable extra I2C own address registers
+int BUS_I2C_aux_addr(unsigned char addr,unsigned char dest){
+  switch(dest){
+    case CMD_PARSE_ADDR1:
+      //check if address is enabled
+      if(UCOAEN&UCB0I2COA1){
+        //error, address is already enabled
+        return ERR_BAD_ADDR;
+      }
+      //enable interrupts for address 2
+      UCB0IE|=UCTXIE1|UCRXIE1;
+      //set and enable address 1
+      UCB0I2COA1=UCOAEN|addr;
+    break;
+    case CMD_PARSE_ADDR2:
+      //check if address is enabled
+      if(UCOAEN&UCB0I2COA2){
+        //error, address is already enabled
+        return ERR_BAD_ADDR;
+      }
+      //enable interrupts for address 2
+      UCB0IE|=UCTXIE2|UCRXIE2;
+      //set and enable address 2
+      UCB0I2COA2=UCOAEN|addr;
+    break;
+    case CMD_PARSE_ADDR3:
+      //check if address is enabled
+      if(UCOAEN&UCB0I2COA3){
+        //error, address is already enabled
+        return ERR_BAD_ADDR;
+      }
+      //enable interrupts for address 3
+      UCB0IE|=UCTXIE3|UCRXIE3;
+      //set and enable address 3
+      UCB0I2COA3=UCOAEN|addr;
+    break;
+    default:
+      //all other values are invalid
+      return ERR_INVALID_ARGUMENT;
+  }
+  return RET_SUCCESS;
+}
+
+//return I2C address based on flags
+unsigned char BUS_flags_to_addr(unsigned char flags){
+  switch(flags){
+    case CMD_PARSE_ADDR0:
+      //check if address is enabled
+      if(UCOAEN&UCB0I2COA0){
+        //return address without GCEN or OAEN bits
+        return (~(UCGCEN|UCOAEN))&UCB0I2COA0;
+      }
+    break;
+    case CMD_PARSE_ADDR1:
+      //check if address is enabled
+      if(UCOAEN&UCB0I2COA1){
+        //return address without GCEN or OAEN bits
+        return (~(UCGCEN|UCOAEN))&UCB0I2COA1;
+      }
+    break;
+    case CMD_PARSE_ADDR2:
+      //check if address is enabled
+      if(UCOAEN&UCB0I2COA2){
+        //return address without GCEN or OAEN bits
+        return (~(UCGCEN|UCOAEN))&UCB0I2COA2;
+      }
+    break;
+    case CMD_PARSE_ADDR3:
+      //check if address is enabled
+      if(UCOAEN&UCB0I2COA3){
+        //return address without GCEN or OAEN bits
+        return (~(UCGCEN|UCOAEN))&UCB0I2COA3;
+      }
+    break;
+    case CMD_PARSE_GC_ADDR:
+      return BUS_ADDR_GC;
+    default:
+      return BUS_FLAGS_INVALID_ADDR;
+  }
+  return BUS_FLAGS_ADDR_DISABLED;
+}
+
+//find flags for address, address must be enabled
+unsigned char BUS_addr_to_flags(unsigned char addr){
+  int i,disabled;
+  //base address for own I2C addresses
+  volatile unsigned int * const oa_base=&UCB0I2COA0;
+  //loop through addresses to find a match
+  for(i=0,disabled;i<4;i++){
+    //check for a match
+    if(((~(UCGCEN|UCOAEN))&oa_base[i])==addr){
+      //check if address is enabled
+      if(oa_base[i]&UCOAEN){
+        //Success!!, return flags for address
+        return CMD_PARSE_ADDR0<<i;
+      }else{
+        //disabled, set flag
+        disabled=1;
+      }
+    }
+  }
+  //TODO: are these the best error values to return??
+  //check if address was disabled
+  if(disabled){
+    //return disabled error
+    return BUS_FLAGS_ADDR_DISABLED;
+  }else{
+    //return invalid flags error
+    return BUS_FLAGS_INVALID_ADDR;
+  }
+}//return own address
+
+//Setup buffer for command 
+unsigned char *BUS_cmd_init(unsigned char *buf,unsigned char id){
+  buf[1]=id;
+  //set originator address
+  buf[0]=BUS_get_OA();
+  //start of payload
+  return buf+2;
+}
+
+//check for own address
+int BUS_OA_check(unsigned char addr){
+  int i;
+  //base address for own I2C addresses
+  volatile unsigned int * const oa_base=&UCB0I2COA0;
+  //check if addr matches any slave address
+  for(i=0;i<4;i++){
+    //skip if address disabled
+    if(!(oa_base[i]&UCOAEN))continue;
+    //check for address match
+    if(addr==((~(UCGCEN|UCOAEN))&oa_base[i])){
+      return ERR_BAD_ADDR;
+    }
+  }
+  //not a match success!
+  return RET_SUCCESS;
+}
+
+//function to check I2C addresses
+int addr_chk(unsigned char addr){
+  //check if 8th bit is set
+  if(addr&0x80){
+    return ERR_BAD_ADDR;
+  }
+  //success!
+  return RET_SUCCESS;
+}
+
+static ticker packet_time=0;
+
+static unsigned BUS_I2C_lock(void){
+  int i;
+  //try to capture mutex
+  if(0==ctl_mutex_lock(&arcBus_stat.i2c_stat.mutex,CTL_TIMEOUT_DELAY,100)){
+     return ERR_BUSY;
+  }
+  return 0;
+} 
+
+//release the I2C bus
+void BUS_I2C_release(void){
+  ctl_mutex_unlock(&arcBus_stat.i2c_stat.mutex);
+}
+
+//fastest speeds supported by this board
+BUS_SPEED BUS_speed_limit={BUS_I2C_SPEED_MAX,BUS_SPI_SPEED_MAX};
+//speeds for the helper task to set
+BUS_SPEED BUS_speed_req;
+
+//I2C prescaler values for each bus speed off of 20MHz SMCLK
+static const unsigned short BUS_I2C_brw[BUS_I2C_NUM_SPEEDS]={400,200,50,20};
+
+//number of errors in a row that may be caused by the I2C bus speed
+static short I2C_speed_errors=0;
+
+//keep track of which errors have happened
+static int BUS_I2C_err_count(int error){
+  //keep track of how many errors have happened
+  static errors=0;
+  //check which error happened
+  switch(error){
+    //I2C start timeout error happened
+    case ERR_I2C_START_TIMEOUT:
+      //This error causes problems reset after only a few errors
+      if(errors>3){
+        //reset MSP430 to clear the error
+        reset(ERR_LEV_ERROR+20,BUS_ERR_SRC_I2C,I2C_ERR_TOO_MANY_ERRORS,error);
+      }
+      errors++;
+    break;
+    //These errors happen when the device is not found or busy
+    case ERR_I2C_NACK:
+    case BUS_EV_I2C_TX_SELF:
+    case BUS_EV_I2C_ABORT:
+      //Do nothing, errors are not cleared or incremented
+    break;
+    //send successful!
+    case RET_SUCCESS:
+      //reset error count
+      errors=0;
+      //bus speed is working
+      I2C_speed_errors=0;
+    break;
+    //Clock low timeout
+    case BUS_EV_I2C_ERR_CCL:
+    case ERR_I2C_CLL:
+      //This error does not happen too often
+      if(errors>10){
+        //reset MSP430 to clear the error
+        reset(ERR_LEV_ERROR+20,BUS_ERR_SRC_I2C,I2C_ERR_TOO_MANY_ERRORS,error);
+      }
+      errors++;
+      //clock low timeouts can mean the bus is too fast
+      BUS_I2C_speed_err();
+    break;
+    //Other or unknown error
+    default:
+      //reset if a lot of these happen
+      if(errors>40){
+        //reset MSP430 to clear the error
+        reset(ERR_LEV_ERROR+20,BUS_ERR_SRC_I2C,I2C_ERR_TOO_MANY_ERRORS,error);
+      }
+      errors++;
+    break;
+  }
+  //return error
+  return error;
+}
+
+//keep track of errors and release the I2C bus
+static int BUS_I2C_err_track(int error){
+  //count error
+  BUS_I2C_err_count(error);
+  //release I2C bus
+  BUS_I2C_release();
+  //return error
+  return error;
+}
+
+//set the fastest bus speeds this board supports
+void BUS_set_speed_limit(unsigned char i2c,unsigned char spi){
+  //check I2C speed
+  if(i2c<BUS_I2C_NUM_SPEEDS){
+    BUS_speed_limit.i2c=i2c;
+  }
+  //check SPI speed
+  if(spi<BUS_SPI_NUM_SPEEDS){
+    BUS_speed_limit.spi=spi;
+  }
+}
+
+//request new bus speeds, speeds are limited to what this board supports. can be called from an ISR
+void BUS_speed_set(unsigned char i2c,unsigned char spi){
+  //limit I2C speed
+  if(i2c>BUS_speed_limit.i2c){
+    i2c=BUS_speed_limit.i2c;
+  }
+  //limit SPI speed
+  if(spi>BUS_speed_limit.spi){
+    spi=BUS_speed_limit.spi;
+  }
+  //save requested speeds
+  BUS_speed_req.i2c=i2c;
+  BUS_speed_req.spi=spi;
+  //have the helper task change the speed
+  ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_SPEED,0);
+}
+
+//count an error that may be caused by running the I2C bus too fast, can be called from an ISR
+void BUS_I2C_speed_err(void){
+  int en=ctl_global_interrupts_disable();
+  //count error and check if there have been too many
+  if(++I2C_speed_errors>=BUS_I2C_SPEED_ERRORS){
+    //reset count
+    I2C_speed_errors=0;
+    //check if there is a slower speed to use
+    if(arcBus_stat.i2c_stat.speed>BUS_I2C_SPEED_50K && BUS_speed_limit.i2c>BUS_I2C_SPEED_50K){
+      //lower speed limit so future negotiation does not raise it again
+      BUS_speed_limit.i2c=arcBus_stat.i2c_stat.speed-1;
+      //lower I2C speed, SPI stays the same
+      BUS_speed_set(BUS_speed_limit.i2c,arcBus_stat.spi_stat.speed);
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//wait for queued packets to finish and take control of the I2C master
+static int BUS_I2C_claim(void){
+  unsigned int e;
+  int en;
+  for(;;){
+    en=ctl_global_interrupts_disable();
+    //check if the master is free
+    if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IDLE){
+      //take control of the master so queued packets are not started
+      arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_CLAIMED;
+      //clear wait flag
+      arcBus_stat.i2c_stat.tx.wait=0;
+      if(en){
+        ctl_global_interrupts_enable();
+      }
+      return RET_SUCCESS;
+    }
+    //clear free event
+    ctl_events_set_clear(&arcBus_stat.events,0,BUS_EV_I2C_MASTER_FREE);
+    //tell ISR not to start more queued packets
+    arcBus_stat.i2c_stat.tx.wait=1;
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    //wait for the current queued packet to finish
+    e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&arcBus_stat.events,BUS_EV_I2C_MASTER_FREE,CTL_TIMEOUT_DELAY,BUS_I2C_TX_TIMEOUT);
+    //check for timeout
+    if(!(e&BUS_EV_I2C_MASTER_FREE)){
+      en=ctl_global_interrupts_disable();
+      //clear wait flag
+      arcBus_stat.i2c_stat.tx.wait=0;
+      //make sure the queue keeps running
+      BUS_I2C_tx_next();
+      if(en){
+        ctl_global_interrupts_enable();
+      }
+      return ERR_BUSY;
+    }
+  }
+}
+
+//give up control of the I2C master and start any queued packets
+static void BUS_I2C_unclaim(void){
+  int en=ctl_global_interrupts_disable();
+  //set I2C master state
+  arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_IDLE;
+  //start queued packets
+  BUS_I2C_tx_next();
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//change I2C master clock speed, waits for the bus to be idle
+int BUS_I2C_set_speed(unsigned char speed){
+  unsigned short ie;
+  int en,i,ret;
+  //check speed
+  if(speed>=BUS_I2C_NUM_SPEEDS){
+    return ERR_INVALID_ARGUMENT;
+  }
+  //check if speed is already set
+  if(speed==arcBus_stat.i2c_stat.speed){
+    return RET_SUCCESS;
+  }
+  //get I2C bus
+  if(BUS_I2C_lock()){
+    return ERR_BUSY;
+  }
+  //wait for queued packets and take control of the master
+  if((ret=BUS_I2C_claim())!=RET_SUCCESS){
+    BUS_I2C_release();
+    return ret;
+  }
+  //wait for slave transactions to finish
+  for(i=0,ret=ERR_BUSY;i<10 && ret!=RET_SUCCESS;i++){
+    en=ctl_global_interrupts_disable();
+    //UCB0 can only be reset when the bus is not busy
+    if(!(UCB0STATW&UCBBUSY) && arcBus_stat.i2c_stat.mode==BUS_I2C_IDLE){
+      //save interrupt enables
+      ie=UCB0IE;
+      //put UCB0 into reset state
+      UCB0CTLW0|=UCSWRST;
+      //set new baud rate
+      UCB0BRW=BUS_I2C_brw[speed];
+      //bring UCB0 out of reset state
+      UCB0CTLW0&=~UCSWRST;
+      //restore interrupts
+      UCB0IE=ie;
+      //save speed
+      arcBus_stat.i2c_stat.speed=speed;
+      ret=RET_SUCCESS;
+    }
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    //wait for the bus to be free
+    if(ret!=RET_SUCCESS){
+      ctl_timeout_wait(ctl_get_current_time()+2);
+    }
+  }
+  //let queued packets run
+  BUS_I2C_unclaim();
+  //release I2C bus
+  BUS_I2C_release();
+  return ret;
+}
+
+//start the next queued packet if the bus is free, must be called with interrupts disabled
+void BUS_I2C_tx_next(void){
+  I2C_TX_PACKET *pk;
+  //check for queued packets and if the master is free
+  if(I2C_tx_num==0 || arcBus_stat.i2c_stat.tx.stat!=BUS_I2C_MASTER_IDLE){
+    return;
+  }
+  //get next packet
+  pk=&I2C_tx_buf[I2C_tx_out];
+  //set slave address
+  UCB0I2CSA=pk->addr;
+  //set index
+  arcBus_stat.i2c_stat.tx.idx=0;
+  //set length
+  arcBus_stat.i2c_stat.tx.len=pk->len;
+  //set data
+  arcBus_stat.i2c_stat.tx.ptr=pk->dat;
+  //set I2C master state
+  arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_PENDING;
+  //packet is from the queue
+  arcBus_stat.i2c_stat.tx.async=1;
+  //set timeout
+  I2C_tx_timer=BUS_I2C_TX_TIMEOUT;
+  //set to transmit mode
+  UCB0CTLW0|=UCTR;
+  //set master mode
+  UCB0CTLW0|=UCMST;
+  //generate start condition
+  UCB0CTL1|=UCTXSTT;
+}
+
+//finish the current queued packet, called from the I2C interrupt
+void BUS_I2C_tx_done(unsigned short e){
+  I2C_TX_PACKET *pk;
+  int result;
+  //check that a queued packet is in progress
+  if(!arcBus_stat.i2c_stat.tx.async){
+    return;
+  }
+  //get result from end event
+  switch(e){
+    case BUS_EV_I2C_COMPLETE:
+      result=RET_SUCCESS;
+    break;
+    case BUS_EV_I2C_NACK:
+      result=ERR_I2C_NACK;
+    break;
+    case BUS_EV_I2C_ABORT:
+      result=ERR_I2C_ABORT;
+    break;
+    case BUS_EV_I2C_TX_SELF:
+      result=ERR_I2C_TX_SELF;
+    break;
+    case (unsigned short)ERR_I2C_CLL:
+      result=ERR_I2C_CLL;
+    break;
+    case (unsigned short)ERR_TIMEOUT:
+      result=ERR_TIMEOUT;
+    break;
+    default:
+      result=ERR_UNKNOWN;
+    break;
+  }
+  //packet is done
+  arcBus_stat.i2c_stat.tx.async=0;
+  arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_IDLE;
+  //stop timeout
+  I2C_tx_timer=0;
+  //save result, errors are counted and callbacks are run by the helper task
+  pk=&I2C_tx_buf[I2C_tx_out];
+  pk->result=result;
+  //move packet from the send queue to the finished packets, the slot is freed by the helper task
+  I2C_tx_out++;
+  //check for wraparound
+  if(I2C_tx_out>=BUS_I2C_TX_QUEUE_LEN){
+    I2C_tx_out=0;
+  }
+  I2C_tx_num--;
+  I2C_tx_fin_num++;
+  //have the helper task finish the packet
+  ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_I2C_TX_DONE,0);
+  //check if a blocking transmit is waiting
+  if(arcBus_stat.i2c_stat.tx.wait){
+    //let the waiting task have the bus
+    ctl_events_set_clear(&arcBus_stat.events,BUS_EV_I2C_MASTER_FREE,0);
+  }else{
+    //start the next packet
+    BUS_I2C_tx_next();
+  }
+}
+
+//count errors and notify for sent queued packets, called from the helper task
+void BUS_I2C_tx_finish(void){
+  I2C_TX_PACKET *pk;
+  int i,en;
+  //finished packets are not changed by the interrupt or the queue so they can be read with interrupts enabled
+  while(I2C_tx_fin_num>0){
+    //get packet
+    pk=&I2C_tx_buf[I2C_tx_fin];
+    //keep track of errors
+    BUS_I2C_err_count(pk->result);
+    //notify for each command in the packet
+    for(i=0;i<pk->num;i++){
+      //call callback
+      if(pk->notify[i].cb){
+        pk->notify[i].cb(pk->addr,pk->notify[i].cmd,pk->result);
+      }
+      //set event
+      if(pk->notify[i].e){
+        ctl_events_set_clear(pk->notify[i].e,pk->notify[i].event,0);
+      }
+    }
+    en=ctl_global_interrupts_disable();
+    //free packet
+    I2C_tx_fin++;
+    //check for wraparound
+    if(I2C_tx_fin>=BUS_I2C_TX_QUEUE_LEN){
+      I2C_tx_fin=0;
+    }
+    I2C_tx_fin_num--;
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+  }
+}
+
+//queued packet timed out, called from the timer interrupt
+void BUS_I2C_tx_timeout(void){
+  //check that a queued packet is in progress
+  if(!arcBus_stat.i2c_stat.tx.async){
+    return;
+  }
+  //stop DMA so it does not send from the packet buffer
+  BUS_I2C_DMA_stop();
+  //check if the start condition was sent
+  if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
+    //generate stop condition
+    UCB0CTL1|=UCTXSTP;
+  }else{
+    //clear start bit
+    UCB0CTL1&=~UCTXSTT;
+  }
+  //finish packet
+  BUS_I2C_tx_done((unsigned short)ERR_TIMEOUT);
+}
+
+//request waiting for a response
+typedef struct{
+  //address the request was sent to, zero if free
+  unsigned char addr;
+  unsigned char seq;
+  //set once the response is received
+  unsigned char done;
+  //result from the other board or NACK reason
+  short status;
+  //buffer for response
+  unsigned char *buf;
+  unsigned short size;
+  //length of response
+  unsigned short len;
+}BUS_RPC_PENDING;
+
+//requests waiting for a response
+static BUS_RPC_PENDING rpc_pending[BUS_RPC_PENDING_NUM];
+
+//events for pending requests
+CTL_EVENT_SET_t BUS_rpc_events;
+
+//response received for a request, called from the ARCbus task
+void BUS_rpc_done(unsigned char addr,unsigned char seq,short status,const unsigned char *dat,unsigned short len){
+  int i,en;
+  //don't let the request time out while the response is copied
+  en=ctl_global_interrupts_disable();
+  for(i=0;i<BUS_RPC_PENDING_NUM;i++){
+    //check for matching request
+    if(rpc_pending[i].addr==addr && rpc_pending[i].seq==seq && !rpc_pending[i].done){
+      //save status
+      rpc_pending[i].status=status;
+      //copy as much of the response as will fit
+      if(len>rpc_pending[i].size){
+        len=rpc_pending[i].size;
+      }
+      memcpy(rpc_pending[i].buf,dat,len);
+      rpc_pending[i].len=len;
+      //request is done
+      rpc_pending[i].done=1;
+      //wake up task
+      ctl_events_set_clear(&BUS_rpc_events,1<<i,0);
+      break;
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//request was NACKed, called from the ARCbus task
+//requests that can be read are answered with CMD_RPC_RESP so a NACK only comes when the sequence number is not known
+//the request is failed if it is the only one pending for this board, otherwise the requests time out
+void BUS_rpc_nack(unsigned char addr,unsigned char reason){
+  int i,en,found=-1;
+  en=ctl_global_interrupts_disable();
+  for(i=0;i<BUS_RPC_PENDING_NUM;i++){
+    //check for requests sent to this board
+    if(rpc_pending[i].addr==addr && !rpc_pending[i].done){
+      //check if another request was found
+      if(found>=0){
+        found=-1;
+        break;
+      }
+      found=i;
+    }
+  }
+  //check if there is one request that the NACK is for
+  if(found>=0){
+    //save status
+    rpc_pending[found].status=reason;
+    rpc_pending[found].len=0;
+    //request is done
+    rpc_pending[found].done=1;
+    //wake up task
+    ctl_events_set_clear(&BUS_rpc_events,1<<found,0);
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//send command and wait for the response, returns response length or error
+//the command is sent in a CMD_RPC packet with a sequence number that is sent back in the response
+int BUS_cmd_txrx(unsigned char addr,void *buff,unsigned short len,void *resp,unsigned short size,CTL_TIME_t timeout){
+  //sequence number to match responses with requests
+  static unsigned char seq=0;
+  unsigned char pk[BUS_I2C_HDR_LEN+BUS_I2C_MAX_PACKET_LEN+BUS_I2C_CRC_LEN],*ptr;
+  BUS_RPC_PENDING *rpc=NULL;
+  int i,en,ret;
+  //check length, request header and payload must fit in one packet
+  if(len>BUS_I2C_MAX_PACKET_LEN-BUS_RPC_HDR_LEN){
+    return ERR_PACKET_TOO_LONG;
+  }
+  //only one board can respond
+  if(addr==BUS_ADDR_GC){
+    return ERR_BAD_ADDR;
+  }
+  //find a free request
+  en=ctl_global_interrupts_disable();
+  for(i=0;i<BUS_RPC_PENDING_NUM;i++){
+    if(rpc_pending[i].addr==0){
+      rpc=&rpc_pending[i];
+      //setup request
+      rpc->addr=addr;
+      rpc->seq=++seq;
+      rpc->done=0;
+      rpc->status=0;
+      rpc->buf=resp;
+      rpc->size=(resp==NULL)?0:size;
+      rpc->len=0;
+      //clear old event
+      ctl_events_set_clear(&BUS_rpc_events,0,1<<i);
+      break;
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  //check if a request was found
+  if(rpc==NULL){
+    return ERR_BUSY;
+  }
+  //setup request packet
+  ptr=BUS_cmd_init(pk,CMD_RPC);
+  //sequence number
+  ptr[0]=rpc->seq;
+  //command
+  ptr[1]=((unsigned char*)buff)[1];
+  //copy payload
+  memcpy(ptr+BUS_RPC_HDR_LEN,((unsigned char*)buff)+BUS_I2C_HDR_LEN,len);
+  //send request, NACK is needed if the request can't be read so the waiting task is woken up
+  ret=BUS_cmd_tx(addr,pk,len+BUS_RPC_HDR_LEN,BUS_CMD_FL_NACK);
+  //check if request was sent
+  if(ret==RET_SUCCESS){
+    //wait for response
+    ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&BUS_rpc_events,1<<i,CTL_TIMEOUT_DELAY,timeout);
+  }
+  en=ctl_global_interrupts_disable();
+  //check if response was received, it can arrive after the timeout
+  if(ret==RET_SUCCESS){
+    if(!rpc->done){
+      ret=ERR_TIMEOUT;
+    }else if(rpc->status!=0){
+      //other board could not run the command
+      ret=ERR_CMD_NACK;
+    }else{
+      //return response length
+      ret=rpc->len;
+    }
+  }
+  //free request
+  rpc->addr=0;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return ret;
+}
+
+//state of sequenced commands
+enum{BUS_SEQ_FREE=0,BUS_SEQ_SENDING,BUS_SEQ_SENT,BUS_SEQ_NACK};
+
+//sequenced command that has not been accepted
+typedef struct{
+  unsigned char stat;
+  unsigned char seq;
+  //NACK reason
+  unsigned char reason;
+  //payload length including sequence header
+  unsigned char len;
+  //time that the command was sent
+  CTL_TIME_t time;
+  //packet, kept so the command can be sent again
+  unsigned char pk[BUS_I2C_HDR_LEN+BUS_I2C_MAX_PACKET_LEN+BUS_I2C_CRC_LEN];
+}BUS_SEQ_CMD;
+
+//sequenced commands for one board
+typedef struct{
+  //board address, zero if unused
+  unsigned char addr;
+  //next sequence number
+  unsigned char seq;
+  BUS_SEQ_CMD win[BUS_SEQ_WINDOW];
+}BUS_SEQ_DEST;
+
+static BUS_SEQ_DEST seq_dest[BUS_SEQ_DEST_NUM];
+
+//events for sequenced commands, one for each board. set while the board has a rejected command
+CTL_EVENT_SET_t BUS_seq_events;
+
+//update the rejected command event for a board, must be called with interrupts disabled
+//the event is not cleared by waiting tasks so every task waiting on the board sees it
+static void BUS_seq_nack_ev(BUS_SEQ_DEST *dest){
+  CTL_EVENT_SET_t e=1<<(dest-seq_dest);
+  int i;
+  for(i=0;i<BUS_SEQ_WINDOW;i++){
+    //check for rejected command
+    if(dest->win[i].stat==BUS_SEQ_NACK){
+      ctl_events_set_clear(&BUS_seq_events,e,0);
+      return;
+    }
+  }
+  //no rejected commands
+  ctl_events_set_clear(&BUS_seq_events,0,e);
+}
+
+//commands that have not been ACKed or NACKed in time are rejected, must be called with interrupts disabled
+//returns non zero if there are still commands in the window
+static int BUS_seq_expire(BUS_SEQ_DEST *dest){
+  int i,used=0,lost=0;
+  for(i=0;i<BUS_SEQ_WINDOW;i++){
+    //check for old commands
+    if(dest->win[i].stat==BUS_SEQ_SENT && (long)(ctl_get_current_time()-dest->win[i].time)>BUS_SEQ_TIMEOUT){
+      //command or its ACK was lost, the command may still have run
+      dest->win[i].stat=BUS_SEQ_NACK;
+      dest->win[i].reason=ERR_SEQ_NO_ACK;
+      lost=1;
+    }
+    //check if command is still in use
+    if(dest->win[i].stat!=BUS_SEQ_FREE){
+      used=1;
+    }
+  }
+  //wake up waiting tasks
+  if(lost){
+    BUS_seq_nack_ev(dest);
+  }
+  return used;
+}
+
+//find sequenced commands for a board, must be called with interrupts disabled
+//if alloc is non zero an unused entry is setup for the board
+static BUS_SEQ_DEST *BUS_seq_find(unsigned char addr,int alloc){
+  BUS_SEQ_DEST *free_dest=NULL;
+  int i;
+  for(i=0;i<BUS_SEQ_DEST_NUM;i++){
+    //check address
+    if(seq_dest[i].addr==addr){
+      return &seq_dest[i];
+    }
+    //remember an entry with no commands in use
+    if(free_dest==NULL && (seq_dest[i].addr==0 || !BUS_seq_expire(&seq_dest[i]))){
+      free_dest=&seq_dest[i];
+    }
+  }
+  //check if a new entry should be used
+  if(!alloc || free_dest==NULL){
+    return NULL;
+  }
+  //setup entry, keep sequence number so old NACKs don't match
+  free_dest->addr=addr;
+  return free_dest;
+}
+
+//get the time that the oldest unacknowledged command times out, must be called with interrupts disabled
+//returns zero if no commands are waiting
+static CTL_TIME_t BUS_seq_next_time(BUS_SEQ_DEST *dest){
+  CTL_TIME_t t=0;
+  int i;
+  for(i=0;i<BUS_SEQ_WINDOW;i++){
+    //check for a waiting command
+    if(dest->win[i].stat==BUS_SEQ_SENT && (t==0 || (long)(dest->win[i].time-t)<0)){
+      t=dest->win[i].time;
+    }
+  }
+  //add time to wait for ACK or NACK
+  return (t==0)?0:t+BUS_SEQ_TIMEOUT+1;
+}
+
+//sequenced command was NACKed, seq is -1 if the sequence number is not known. called from the ARCbus task
+void BUS_seq_nack(unsigned char addr,int seq,unsigned char reason){
+  BUS_SEQ_DEST *dest;
+  int i,en;
+  en=ctl_global_interrupts_disable();
+  //find board
+  if((dest=BUS_seq_find(addr,0))!=NULL){
+    for(i=0;i<BUS_SEQ_WINDOW;i++){
+      //check for commands that have been sent
+      if((dest->win[i].stat==BUS_SEQ_SENT || dest->win[i].stat==BUS_SEQ_SENDING) && (seq<0 || dest->win[i].seq==seq)){
+        //command was rejected
+        dest->win[i].stat=BUS_SEQ_NACK;
+        dest->win[i].reason=reason;
+      }
+    }
+    //wake up waiting tasks
+    BUS_seq_nack_ev(dest);
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//sequenced command was accepted, called from the ARCbus task
+void BUS_seq_ack(unsigned char addr,unsigned char seq){
+  BUS_SEQ_DEST *dest;
+  int i,en;
+  en=ctl_global_interrupts_disable();
+  //find board
+  if((dest=BUS_seq_find(addr,0))!=NULL){
+    for(i=0;i<BUS_SEQ_WINDOW;i++){
+      //check for the command, a command that is being sent again can be ACKed before BUS_cmd_tx returns
+      if((dest->win[i].stat==BUS_SEQ_SENT || dest->win[i].stat==BUS_SEQ_SENDING) && dest->win[i].seq==seq){
+        //command was accepted
+        dest->win[i].stat=BUS_SEQ_FREE;
+      }
+    }
+    //wake up waiting tasks, then put the event back to show if there are rejected commands
+    ctl_events_set_clear(&BUS_seq_events,1<<(dest-seq_dest),0);
+    BUS_seq_nack_ev(dest);
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//send command with a sequence number without waiting for earlier commands to be accepted
+//commands are accepted when the receiver sends CMD_SEQ_ACK, the caller waits if BUS_SEQ_WINDOW commands are unacknowledged
+//commands with no ACK or NACK after BUS_SEQ_TIMEOUT are rejected with ERR_SEQ_NO_ACK
+//returns ERR_CMD_NACK without sending if an earlier command was rejected
+int BUS_cmd_tx_seq(unsigned char addr,void *buff,unsigned short len,unsigned short flags,unsigned char *seq){
+  BUS_SEQ_DEST *dest;
+  BUS_SEQ_CMD *cmd;
+  unsigned char *ptr;
+  CTL_TIME_t t;
+  int i,en,resp,nack;
+  //check length, sequence header and payload must fit in one packet
+  if(len>BUS_I2C_MAX_PACKET_LEN-BUS_SEQ_HDR_LEN){
+    return ERR_PACKET_TOO_LONG;
+  }
+  //NACKs come from one board
+  if(addr==BUS_ADDR_GC){
+    return ERR_BAD_ADDR;
+  }
+  for(;;){
+    cmd=NULL;
+    nack=0;
+    en=ctl_global_interrupts_disable();
+    //find board
+    if((dest=BUS_seq_find(addr,1))==NULL){
+      if(en){
+        ctl_global_interrupts_enable();
+      }
+      return ERR_BUSY;
+    }
+    //reject commands that timed out
+    BUS_seq_expire(dest);
+    for(i=0;i<BUS_SEQ_WINDOW;i++){
+      //look for a free command
+      if(cmd==NULL && dest->win[i].stat==BUS_SEQ_FREE){
+        cmd=&dest->win[i];
+      }
+      //check for rejected commands
+      if(dest->win[i].stat==BUS_SEQ_NACK){
+        nack=1;
+      }
+    }
+    //check if a command was found
+    if(!nack && cmd!=NULL){
+      //setup command
+      cmd->stat=BUS_SEQ_SENDING;
+      cmd->seq=dest->seq++;
+    }
+    //get time that a command times out
+    t=BUS_seq_next_time(dest);
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    //check for rejected commands
+    if(nack){
+      return ERR_CMD_NACK;
+    }
+    //check if a command was found
+    if(cmd!=NULL){
+      break;
+    }
+    //window is full, wait for a command to be accepted or rejected
+    ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS,&BUS_seq_events,1<<(dest-seq_dest),(t==0)?CTL_TIMEOUT_DELAY:CTL_TIMEOUT_ABSOLUTE,(t==0)?BUS_SEQ_TIMEOUT:t);
+  }
+  //setup packet
+  ptr=BUS_cmd_init(cmd->pk,CMD_SEQ);
+  //sequence number
+  ptr[0]=cmd->seq;
+  //command
+  ptr[1]=((unsigned char*)buff)[1];
+  //copy payload
+  memcpy(ptr+BUS_SEQ_HDR_LEN,((unsigned char*)buff)+BUS_I2C_HDR_LEN,len);
+  cmd->len=len+BUS_SEQ_HDR_LEN;
+  //return sequence number
+  if(seq!=NULL){
+    *seq=cmd->seq;
+  }
+  //send command, the receiver only sends an ACK or NACK if a NACK is requested
+  resp=BUS_cmd_tx(addr,cmd->pk,cmd->len,flags|BUS_CMD_FL_NACK);
+  en=ctl_global_interrupts_disable();
+  //check if the command was sent
+  if(resp!=RET_SUCCESS){
+    //free command
+    cmd->stat=BUS_SEQ_FREE;
+  }else if(cmd->stat==BUS_SEQ_SENDING){
+    //wait for NACK
+    cmd->time=ctl_get_current_time();
+    cmd->stat=BUS_SEQ_SENT;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return resp;
+}
+
+//wait until all sequenced commands sent to addr are accepted, returns ERR_CMD_NACK if one was rejected
+int BUS_cmd_seq_wait(unsigned char addr,CTL_TIME_t timeout){
+  BUS_SEQ_DEST *dest;
+  CTL_TIME_t t,end;
+  int i,en,resp;
+  //get time to stop waiting
+  end=ctl_get_current_time()+timeout;
+  for(;;){
+    resp=RET_SUCCESS;
+    t=0;
+    en=ctl_global_interrupts_disable();
+    //find board, nothing to wait for if no commands were sent
+    if((dest=BUS_seq_find(addr,0))!=NULL && BUS_seq_expire(dest)){
+      for(i=0;i<BUS_SEQ_WINDOW;i++){
+        //check for rejected commands
+        if(dest->win[i].stat==BUS_SEQ_NACK){
+          resp=ERR_CMD_NACK;
+        }else if(dest->win[i].stat!=BUS_SEQ_FREE && resp==RET_SUCCESS){
+          resp=ERR_BUSY;
+        }
+      }
+      //get time that a command times out
+      t=BUS_seq_next_time(dest);
+    }
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    //check if done
+    if(resp!=ERR_BUSY){
+      return resp;
+    }
+    //check for timeout
+    if((long)(ctl_get_current_time()-end)>=0){
+      return ERR_TIMEOUT;
+    }
+    //wait until a command is accepted or rejected
+    if(t==0 || (long)(t-end)>0){
+      t=end;
+    }
+    ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS,&BUS_seq_events,1<<(dest-seq_dest),CTL_TIMEOUT_ABSOLUTE,t);
+  }
+}
+
+//find a rejected sequenced command, must be called with interrupts disabled
+//if seq is -1 the oldest rejected command is returned
+static BUS_SEQ_CMD *BUS_seq_find_nack(unsigned char addr,int seq){
+  BUS_SEQ_DEST *dest;
+  BUS_SEQ_CMD *cmd=NULL;
+  int i;
+  //find board
+  if((dest=BUS_seq_find(addr,0))==NULL){
+    return NULL;
+  }
+  for(i=0;i<BUS_SEQ_WINDOW;i++){
+    //check for rejected command
+    if(dest->win[i].stat!=BUS_SEQ_NACK){
+      continue;
+    }
+    //check sequence number
+    if(seq>=0){
+      if(dest->win[i].seq==seq){
+        return &dest->win[i];
+      }
+    //check if command is older, sequence numbers wrap around
+    }else if(cmd==NULL || (unsigned char)(dest->seq-dest->win[i].seq)>(unsigned char)(dest->seq-cmd->seq)){
+      cmd=&dest->win[i];
+    }
+  }
+  return cmd;
+}
+
+//get the oldest rejected sequenced command sent to addr, returns ERR_INVALID_ARGUMENT if there is none
+int BUS_cmd_seq_nack(unsigned char addr,unsigned char *seq,unsigned char *cmd,unsigned char *reason){
+  BUS_SEQ_CMD *nack;
+  int en;
+  en=ctl_global_interrupts_disable();
+  //find rejected command
+  if((nack=BUS_seq_find_nack(addr,-1))!=NULL){
+    //return command information
+    if(seq!=NULL){
+      *seq=nack->seq;
+    }
+    if(cmd!=NULL){
+      *cmd=nack->pk[BUS_I2C_HDR_LEN+1];
+    }
+    if(reason!=NULL){
+      *reason=nack->reason;
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return (nack==NULL)?ERR_INVALID_ARGUMENT:RET_SUCCESS;
+}
+
+//send a rejected sequenced command again with the same sequence number
+int BUS_cmd_seq_resend(unsigned char addr,unsigned char seq){
+  BUS_SEQ_CMD *cmd;
+  int en,resp;
+  en=ctl_global_interrupts_disable();
+  //find rejected command
+  if((cmd=BUS_seq_find_nack(addr,seq))!=NULL){
+    //command is being sent
+    cmd->stat=BUS_SEQ_SENDING;
+    //update event
+    BUS_seq_nack_ev(BUS_seq_find(addr,0));
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  //check if command was found
+  if(cmd==NULL){
+    return ERR_INVALID_ARGUMENT;
+  }
+  //send command
+  resp=BUS_cmd_tx(addr,cmd->pk,cmd->len,BUS_CMD_FL_NACK);
+  en=ctl_global_interrupts_disable();
+  //check if the command was sent
+  if(resp!=RET_SUCCESS){
+    //command is still rejected
+    cmd->stat=BUS_SEQ_NACK;
+    //update event
+    BUS_seq_nack_ev(BUS_seq_find(addr,0));
+  }else if(cmd->stat==BUS_SEQ_SENDING){
+    //wait for NACK
+    cmd->time=ctl_get_current_time();
+    cmd->stat=BUS_SEQ_SENT;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return resp;
+}
+
+//forget a rejected sequenced command
+int BUS_cmd_seq_drop(unsigned char addr,unsigned char seq){
+  BUS_SEQ_CMD *cmd;
+  int en;
+  en=ctl_global_interrupts_disable();
+  //find rejected command
+  if((cmd=BUS_seq_find_nack(addr,seq))!=NULL){
+    //free command
+    cmd->stat=BUS_SEQ_FREE;
+    //update event
+    BUS_seq_nack_ev(BUS_seq_find(addr,0));
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return (cmd==NULL)?ERR_INVALID_ARGUMENT:RET_SUCCESS;
+}
+
+//send a command that is too long for one packet as CMD_FRAG packets
+//the command and payload are split up and put back together by the receiver
+static int BUS_cmd_tx_frag(unsigned char addr,unsigned char *buff,unsigned short len,unsigned short flags){
+  //sequence number so the receiver can tell commands apart
+  static unsigned char seq=0;
+  unsigned char pk[BUS_I2C_HDR_LEN+BUS_I2C_MAX_PACKET_LEN+BUS_I2C_CRC_LEN],*ptr;
+  unsigned short i,n;
+  unsigned char idx;
+  int resp=RET_SUCCESS;
+  //check length
+  if(len>BUS_FRAG_MAX_LEN){
+    return ERR_PACKET_TOO_LONG;
+  }
+  //keep the bus so fragments from other tasks don't get mixed in
+  if(BUS_I2C_lock()){
+    return ERR_BUSY;
+  }
+  //next sequence number
+  seq++;
+  //setup fragment packet
+  ptr=BUS_cmd_init(pk,CMD_FRAG);
+  //send the command byte followed by the payload
+  buff++;
+  len++;
+  for(i=0,idx=0;i<len;i+=n,idx++){
+    //get fragment length
+    n=len-i;
+    if(n>BUS_I2C_MAX_PACKET_LEN-BUS_FRAG_HDR_LEN){
+      n=BUS_I2C_MAX_PACKET_LEN-BUS_FRAG_HDR_LEN;
+    }
+    //setup fragment header
+    ptr[0]=seq;
+    ptr[1]=idx;
+    //flag last fragment
+    if(i+n>=len){
+      ptr[1]|=BUS_FRAG_LAST;
+    }
+    //copy data
+    memcpy(ptr+BUS_FRAG_HDR_LEN,buff+i,n);
+    //send fragment
+    resp=BUS_cmd_tx(addr,pk,n+BUS_FRAG_HDR_LEN,flags);
+    //stop if fragment was not sent
+    if(resp!=RET_SUCCESS){
+      break;
+    }
+  }
+  //done with bus
+  BUS_I2C_release();
+  return resp;
+}
+
+//send command
+int BUS_cmd_tx(unsigned char addr,void *buff,unsigned short len,unsigned short flags){
+  unsigned int e;
+  short ret;
+  int i;
+  unsigned char resp[2];
+  //check address
+  if((ret=addr_chk(addr))!=RET_SUCCESS){
+    //return error if it occured
+    return ret;
+  }
+  //check packet length
+  if(len>BUS_I2C_MAX_PACKET_LEN){
+    //send as fragments
+    return BUS_cmd_tx_frag(addr,buff,len,flags);
+  }
+  //add standard header length
+  len+=BUS_I2C_HDR_LEN;
+  //add NACK flag if requested
+  if(flags&BUS_CMD_FL_NACK){
+    //request NACK
+    ((unsigned char*)buff)[0]|=CMD_TX_NACK;
+  }else{
+    //clear NACK request
+    ((unsigned char*)buff)[0]&=~CMD_TX_NACK;
+  }
+  //calculate CRC
+  ((unsigned char*)buff)[len]=crc7(buff,len);
+  //add a byte for the CRC
+  len+=BUS_I2C_CRC_LEN;
+  //check for zero length
+  if(len==0){
+    return ERR_BAD_LEN;
+  }
+  //wait for the bus to become free
+  if(BUS_I2C_lock()){
+    //I2C bus is in use
+    return ERR_BUSY;
+  }
+  //wait for queued packets to be sent
+  if(BUS_I2C_claim()){
+    //release I2C bus
+    BUS_I2C_release();
+    //queue did not empty
+    return ERR_BUSY;
+  }
+  //Setup for I2C transaction  
+  //set slave address
+  UCB0I2CSA=addr;
+  //set index
+  arcBus_stat.i2c_stat.tx.idx=0;
+  //set I2C master state
+  arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_PENDING;
+  //set length
+  arcBus_stat.i2c_stat.tx.len=len;
+  //set data
+  arcBus_stat.i2c_stat.tx.ptr=(unsigned char*)buff;
+  //set to transmit mode
+  UCB0CTLW0|=UCTR;
+  //clear master I2C flags
+  ctl_events_set_clear(&arcBus_stat.events,0,BUS_EV_I2C_MASTER|BUS_EV_I2C_MASTER_START);
+  //set master mode
+  UCB0CTLW0|=UCMST;
+  //UCB0CTLW0|=UCMST|UCTR;
+  //generate start condition, CMD_SUB_STAT packets are stamped by the I2C interrupt
+  UCB0CTL1|=UCTXSTT;
+  //wait for packet to start
+  e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&arcBus_stat.events,BUS_EV_I2C_MASTER_START,CTL_TIMEOUT_DELAY,50);
+  //check to see if there was a problem
+  if(!(e&BUS_EV_I2C_MASTER_STARTED)){
+    //clear start bit
+    UCB0CTL1&=~UCTXSTT;
+    //set I2C master state and start queued packets
+    BUS_I2C_unclaim();
+    //chech which error happened
+    switch(e&BUS_EV_I2C_MASTER_START){
+      case 0:
+        //no event happened so timeout
+        return BUS_I2C_err_track(ERR_I2C_START_TIMEOUT);
+      case BUS_EV_I2C_NACK:
+        //I2C device did not acknowledge
+        return BUS_I2C_err_track(ERR_I2C_NACK);
+      default:
+        //error is not defined
+        return BUS_I2C_err_track(ERR_UNKNOWN);
+    }
+  }
+  //wait for transaction to complete
+  e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&arcBus_stat.events,BUS_EV_I2C_MASTER,CTL_TIMEOUT_DELAY,50);
+  //save transaction time
+  packet_time=get_ticker_time();
+  //make sure DMA is not still reading from the buffer
+  BUS_I2C_DMA_stop();
+  //set I2C master state and start queued packets
+  BUS_I2C_unclaim();
+  //check which event(s) happened
+  switch(e&BUS_EV_I2C_MASTER){
+    case BUS_EV_I2C_COMPLETE:
+      //no error
+      return BUS_I2C_err_track(RET_SUCCESS);
+    case BUS_EV_I2C_NACK:
+      //I2C device did not acknowledge
+      return BUS_I2C_err_track(ERR_I2C_NACK);
+    case BUS_EV_I2C_ABORT:
+      //I2C device did not acknowledge
+      return BUS_I2C_err_track(ERR_I2C_ABORT);
+    case 0:
+      //no event happened, so time out
+      return BUS_I2C_err_track(ERR_TIMEOUT);
+    case BUS_EV_I2C_ERR_CCL:
+      //Clock low timeout
+      return BUS_I2C_err_track(ERR_I2C_CLL);
+    case BUS_EV_I2C_TX_SELF:
+      //TX to self and no one else responded
+      return BUS_I2C_err_track(ERR_I2C_TX_SELF);
+    default:
+      //error is not defined
+      return BUS_I2C_err_track(ERR_UNKNOWN);
+  }
+}
+
+//add a command to the last packet queued for the same address, must be called with interrupts disabled
+//commands are combined into a CMD_MULTI frame, the receiver parses each one separately
+//returns the packet that the command was added to or NULL if the command could not be added
+static I2C_TX_PACKET *BUS_I2C_tx_merge(unsigned char addr,const unsigned char *buff,unsigned short len){
+  I2C_TX_PACKET *pk;
+  unsigned char *ptr;
+  short i,idx,plen;
+  //commands that request a NACK are always sent alone
+  if(buff[0]&CMD_TX_NACK || buff[1]==CMD_MULTI){
+    return NULL;
+  }
+  //search the queue from the newest packet to the oldest
+  for(i=I2C_tx_num-1;i>=0;i--){
+    //get packet index
+    idx=I2C_tx_out+i;
+    //check for wraparound
+    if(idx>=BUS_I2C_TX_QUEUE_LEN){
+      idx-=BUS_I2C_TX_QUEUE_LEN;
+    }
+    pk=&I2C_tx_buf[idx];
+    //check address
+    if(pk->addr==addr){
+      break;
+    }
+  }
+  //check if a packet was found
+  if(i<0){
+    return NULL;
+  }
+  //can't change the packet that is being sent
+  if(i==0 && arcBus_stat.i2c_stat.tx.async){
+    return NULL;
+  }
+  //check for room for notification and same source address and flags
+  if(pk->num>=BUS_I2C_TX_MULTI_MAX || pk->dat[0]!=buff[0]){
+    return NULL;
+  }
+  //get payload length of queued packet
+  plen=pk->len-BUS_I2C_HDR_LEN-BUS_I2C_CRC_LEN;
+  //check if the packet is a single command
+  if(pk->dat[1]!=CMD_MULTI){
+    //check if both commands will fit
+    if(plen+len+2*BUS_MULTI_HDR_LEN>BUS_I2C_MAX_PACKET_LEN){
+      return NULL;
+    }
+    //move payload to make room for the command header
+    memmove(pk->dat+BUS_I2C_HDR_LEN+BUS_MULTI_HDR_LEN,pk->dat+BUS_I2C_HDR_LEN,plen);
+    //setup command header
+    pk->dat[BUS_I2C_HDR_LEN]=pk->dat[1];
+    pk->dat[BUS_I2C_HDR_LEN+1]=plen;
+    //change packet to a multiple command frame
+    pk->dat[1]=CMD_MULTI;
+    plen+=BUS_MULTI_HDR_LEN;
+  }else if(plen+len+BUS_MULTI_HDR_LEN>BUS_I2C_MAX_PACKET_LEN){
+    //command will not fit
+    return NULL;
+  }
+  //point to the end of the payload
+  ptr=pk->dat+BUS_I2C_HDR_LEN+plen;
+  //setup command header
+  ptr[0]=buff[1];
+  ptr[1]=len;
+  //copy payload
+  memcpy(ptr+BUS_MULTI_HDR_LEN,buff+BUS_I2C_HDR_LEN,len);
+  //calculate new length
+  pk->len=BUS_I2C_HDR_LEN+plen+BUS_MULTI_HDR_LEN+len;
+  //calculate CRC
+  pk->dat[pk->len]=crc7(pk->dat,pk->len);
+  //add a byte for the CRC
+  pk->len+=BUS_I2C_CRC_LEN;
+  return pk;
+}
+
+//queue command to be sent, returns without waiting for the packet to be sent
+//commands without BUS_CMD_FL_NACK may be combined with other queued commands for the same address
+//when the packet is done cb is called from the ARCbus helper task and then event is set in e
+int BUS_cmd_tx_async(unsigned char addr,void *buff,unsigned short len,unsigned short flags,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event,cmd_tx_Callback cb){
+  I2C_TX_PACKET *pk;
+  short ret;
+  int en;
+  //check address
+  if((ret=addr_chk(addr))!=RET_SUCCESS){
+    //return error if it occured
+    return ret;
+  }
+  //check packet length
+  if(len>BUS_I2C_MAX_PACKET_LEN){
+    return ERR_PACKET_TOO_LONG;
+  }
+  //add standard header length
+  len+=BUS_I2C_HDR_LEN;
+  //add NACK flag if requested
+  if(flags&BUS_CMD_FL_NACK){
+    //request NACK
+    ((unsigned char*)buff)[0]|=CMD_TX_NACK;
+  }else{
+    //clear NACK request
+    ((unsigned char*)buff)[0]&=~CMD_TX_NACK;
+  }
+  //calculate CRC
+  ((unsigned char*)buff)[len]=crc7(buff,len);
+  //add a byte for the CRC
+  len+=BUS_I2C_CRC_LEN;
+  en=ctl_global_interrupts_disable();
+  //try to add the command to a packet that is already queued
+  pk=BUS_I2C_tx_merge(addr,buff,len-BUS_I2C_HDR_LEN-BUS_I2C_CRC_LEN);
+  if(pk==NULL){
+    //check for space in the queue, sent packets use a slot until the helper task finishes them
+    if(I2C_tx_num+I2C_tx_fin_num>=BUS_I2C_TX_QUEUE_LEN){
+      if(en){
+        ctl_global_interrupts_enable();
+      }
+      //queue is full
+      return ERR_BUSY;
+    }
+    //get packet
+    pk=&I2C_tx_buf[I2C_tx_in];
+    //setup packet
+    pk->addr=addr;
+    pk->len=len;
+    pk->num=0;
+    memcpy(pk->dat,buff,len);
+    //add packet to the queue
+    I2C_tx_in++;
+    //check for wraparound
+    if(I2C_tx_in>=BUS_I2C_TX_QUEUE_LEN){
+      I2C_tx_in=0;
+    }
+    I2C_tx_num++;
+  }
+  //setup notification for the command
+  pk->notify[pk->num].cmd=((unsigned char*)buff)[1];
+  pk->notify[pk->num].e=e;
+  pk->notify[pk->num].event=event;
+  pk->notify[pk->num].cb=cb;
+  pk->num++;
+  //start packet if the bus is free
+  BUS_I2C_tx_next();
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return RET_SUCCESS;
+}
+
+//send/receive SPI data over the bus
+//check SPI destination address
+static int BUS_SPI_addr_chk(unsigned char addr){
+  int resp;
+  //check address
+  if((resp=addr_chk(addr))!=RET_SUCCESS){
+    //return error if it occured
+    return resp;
+  }
+  //reject own address
+  if((resp=BUS_OA_check(addr))!=RET_SUCCESS){
+    //return error if it occured
+    return resp;
+  }
+  //reject General call address
+  if(addr==BUS_ADDR_GC){
+    return ERR_BAD_ADDR;
+  }
+  return RET_SUCCESS;
+}
+
+//stop SPI slave transfer and release the SPI pins
+static void BUS_SPI_slave_stop(void){
+  //disable DMA
+  DMA0CTL&=~DMAEN;
+  DMA1CTL&=~DMAEN; 
+  DMA2CTL&=~DMAEN; 
+  //SPI pins back to GPIO
+  SPI_deactivate();
+}
+
+//setup SPI as slave and arm DMA so the master can clock out size bytes
+static void BUS_SPI_slave_arm(void *tx,void *rx,unsigned short size){
+  //disable DMA
+  DMA0CTL&=~DMAEN;
+  DMA1CTL&=~DMAEN;
+  DMA2CTL&=~DMAEN;
+  //Setup SPI
+  SPI_slave_setup();
+  //setup DMA for transfer
+  DMACTL0 &=~(DMA0TSEL_31|DMA1TSEL_31);
+  DMACTL0 |= (DMA0TSEL__USCIA0RX|DMA1TSEL__USCIA0TX);
+  DMACTL1 = DMA2TSEL__USCIA0TX;
+  //====[DMA channel0 used for receive]====
+  //check for omitted receive buffer
+  if(rx!=NULL){
+    // Source DMA address: receive register.
+    *((unsigned int*)&DMA0SA) = (unsigned short)(&UCA0RXBUF);
+    // Destination DMA address: rx buffer.
+    *((unsigned int*)&DMA0DA) = (unsigned short)rx;
+    // The size of the block to be transferred
+    DMA0SZ = size;
+    // Configure the DMA transfer, single byte transfer with source increment
+    DMA0CTL =DMADT_0|DMASBDB|DMAEN|DMASRCINCR_3|DMADSTINCR_0;
+  }
+  //====[DMA channel2 used for DMA9 fix]====
+  //DMA9 workaround, use a dummy channel with lower priority and the same trigger
+  //setup dummy channel: read and write from unused space in the SPI registers
+  *((unsigned int*)&DMA2SA) = EUSCI_A0_BASE + 0x02;
+  *((unsigned int*)&DMA2DA) = EUSCI_A0_BASE + 0x04;
+  // only one byte
+  DMA2SZ = 1;
+  // Configure the DMA transfer, repeated byte transfer with no increment
+  DMA2CTL = DMADT_4|DMASBDB|DMAEN|DMASRCINCR_0|DMADSTINCR_0;
+  //====[DMA channel1 used for transmit]====
+  // Destination DMA address: the transmit buffer.
+  *((unsigned int*)&DMA1DA) = (unsigned int)(&UCA0TXBUF);
+  //check for omitted transmit buffer
+  if(tx!=NULL){
+    // Source DMA address: tx buffer
+    *((unsigned int*)&DMA1SA) =((unsigned int)tx)+1;
+    // The size of the block to be transferred
+    DMA1SZ = size-1;
+    // Configure the DMA transfer, single byte transfer with destination increment
+    //enable interrupt to notify code when transfer is complete
+    DMA1CTL=DMADT_0|DMASBDB|DMASRCINCR_3|DMADSTINCR_0|DMAEN;
+    //start things off with an initial transfer
+    UCA0TXBUF=*((unsigned char*)tx);
+  }else{
+    //need to send something to receive something so setup TX for dummy bytes
+    *((unsigned int*)&DMA1SA) = (unsigned int)(&UCA0TXBUF);
+    // The size of the block to be transferred
+    DMA1SZ = size-1;
+    // Configure the DMA transfer, single byte transfer with no increment
+    DMA1CTL=DMADT_0|DMASBDB|DMASRCINCR_0|DMADSTINCR_0|DMAEN;
+    //start things off with an initial transfer
+    UCA0TXBUF=BUS_SPI_DUMMY_DATA;
+  }
+}
+
+//setup SPI slave transfer, send CMD_SPI_RDY and wait for the master to clock out the data
+//size is the number of bytes sent including CRCs, rdy is the CMD_SPI_RDY payload
+//time is the extra time to wait on top of the time for the data
+static int BUS_SPI_slave_xfer(unsigned char addr,void *tx,void *rx,unsigned short size,const unsigned char *rdy,unsigned short rdy_len,short time){
+  unsigned char buf[10],*ptr;
+  unsigned int e;
+  int resp;
+  //calculate wait time based on packet length
+  time+=size/10;
+  if(time<=BUS_SPI_MIN_TIMEOUT){
+    time=BUS_SPI_MIN_TIMEOUT;
+  }
+  for(;;){
+    //get ready for the master
+    BUS_SPI_slave_arm(tx,rx,size);
+    //clear old queue events
+    ctl_events_set_clear(&arcBus_stat.events,0,BUS_EV_SPI_QUEUED|BUS_EV_SPI_GO);
+    //send SPI setup command
+    ptr=BUS_cmd_init(buf,CMD_SPI_RDY);
+    //copy payload
+    memcpy(ptr,rdy,rdy_len);
+    //send command
+    resp=BUS_cmd_tx(addr,buf,rdy_len,BUS_CMD_FL_NACK);
+    //check if sent correctly
+    if(resp!=RET_SUCCESS){
+      //stop transfer
+      BUS_SPI_slave_stop();
+      //Return Error
+      //TODO: better error code here
+      return resp;
+    }
+    //wait for SPI complete signal from master or for the transfer to be queued
+    e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&arcBus_stat.events,BUS_EV_SPI_MASTER|BUS_EV_SPI_QUEUED,CTL_TIMEOUT_DELAY,time);
+    //check if the master is busy with another transfer
+    if(!(e&BUS_EV_SPI_MASTER) && e&BUS_EV_SPI_QUEUED){
+      //stop driving the SPI bus while waiting
+      BUS_SPI_slave_stop();
+      //wait for the master to be ready
+      e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&arcBus_stat.events,BUS_EV_SPI_GO,CTL_TIMEOUT_DELAY,BUS_SPI_QUEUE_TIMEOUT);
+      //check if it is this board's turn
+      if(e&BUS_EV_SPI_GO){
+        //send CMD_SPI_RDY again
+        continue;
+      }
+      //timeout occurred, send SPI abort packet so the master forgets the transfer
+      ptr=BUS_cmd_init(buf,CMD_SPI_ABORT);
+      resp=BUS_cmd_tx(addr,buf,0,BUS_CMD_FL_NACK);
+      //Return error, timeout occurred
+      return ERR_TIMEOUT;
+    }
+    break;
+  }
+  //stop transfer
+  BUS_SPI_slave_stop();
+  //Check if SPI complete event received
+  if(e&BUS_EV_SPI_COMPLETE){
+    //check for errors from the destination
+    if(arcBus_stat.spi_stat.nack!=0){
+      //error from the other system, return it
+      return arcBus_stat.spi_stat.nack;
+    }
+    //check if DMA0 finished receiving 
+    if(rx!=NULL && !(DMA0CTL&DMAIFG)){
+      //Error : DMA timed out (CRC is probably bad)
+      return ERR_DMA_TIMEOUT;
+    }
+    //check if DMA1 finished transmitting
+    if(!(DMA1CTL&DMAIFG)){
+      //Error : DMA timed out (CRC is probably bad on the other end)
+      return ERR_DMA_TIMEOUT;
+    }
+    //Success!!
+    return RET_SUCCESS;
+  }else if(e&BUS_EV_SPI_NACK){
+    char tmp=arcBus_stat.spi_stat.nack;
+    //clear NACK reason
+    arcBus_stat.spi_stat.nack=0;
+    //check why NACK was sent
+    switch(tmp){
+      case ERR_PK_LEN:
+        //not sure why this could have happened
+        return ERR_INVALID_ARGUMENT;
+      break;
+      case ERR_SPI_LEN:
+        //SPI data is bigger than the buffer
+        return ERR_BAD_LEN;
+      break;
+      case ERR_SPI_BUSY:
+      case ERR_BUFFER_BUSY:
+        //the other MSP is busy
+        return ERR_BUSY;
+      break;
+      default:
+        return ERR_UNKNOWN;
+    }
+  }else{
+    //timeout occurred, send SPI abort packet
+    ptr=BUS_cmd_init(buf,CMD_SPI_ABORT);
+    resp=BUS_cmd_tx(addr,buf,0,BUS_CMD_FL_NACK);
+    //Return error, timeout occurred
+    return ERR_TIMEOUT;
+  }
+}
+
+int BUS_SPI_txrx(unsigned char addr,void *tx,void *rx,unsigned short len){
+  unsigned char rdy[BUS_SPI_DUPLEX_RDY_LEN];
+  int resp;
+  unsigned short crc;
+  //check address
+  if((resp=BUS_SPI_addr_chk(addr))!=RET_SUCCESS){
+    //return error if it occured
+    return resp;
+  }
+  //calculate CRC
+  crc=crc16(tx,len);
+  //send CRC in Big endian order
+  ((unsigned char*)tx)[len]=crc>>8;
+  ((unsigned char*)tx)[len+1]=crc;
+  //setup SPI structure
+  arcBus_stat.spi_stat.len=len;
+  arcBus_stat.spi_stat.rx=rx;
+  arcBus_stat.spi_stat.tx=tx;
+  arcBus_stat.spi_stat.nack=0;
+  //assume the master sends a full length reply
+  arcBus_stat.spi_stat.rx_len=len;
+  //send MSB first
+  rdy[0]=len>>8;
+  //then send LSB
+  rdy[1]=len;
+  //first byte is the data type, receiver uses it to find a registered buffer
+  rdy[2]=((unsigned char*)tx)[0];
+  //tell the master how much data it can send back, MSB first
+  rdy[3]=len>>8;
+  rdy[4]=len;
+  //send data, leave out type if there is no data and receive length if there is nowhere to receive
+  resp=BUS_SPI_slave_xfer(addr,tx,rx,len+BUS_SPI_CRC_LEN,rdy,(len==0)?2:((rx==NULL)?3:BUS_SPI_DUPLEX_RDY_LEN),0);
+  //check for errors
+  if(resp!=RET_SUCCESS){
+    return resp;
+  }
+  //if RX is null or the master sent nothing back then don't calculate CRC
+  if(rx!=NULL && arcBus_stat.spi_stat.rx_len!=0){
+    //assemble CRC
+    crc=((unsigned char*)rx)[arcBus_stat.spi_stat.len+1];//LSB
+    crc|=(((unsigned short)((unsigned char*)rx)[arcBus_stat.spi_stat.len])<<8);//MSB
+    //check CRC
+    if(crc!=crc16(rx,arcBus_stat.spi_stat.len)){
+      //Bad CRC
+      return ERR_BAD_CRC;
+    }
+    //return length of data sent back
+    return arcBus_stat.spi_stat.rx_len;
+  }
+  //Success!! nothing was received
+  return RET_SUCCESS;
+}
+
+//return the buffer size needed to send len bytes with a CRC for each chunk or zero if len is too long
+static unsigned short BUS_SPI_frame_size(unsigned short len,unsigned short chunk){
+  unsigned long size;
+  //add a CRC for each chunk
+  size=len+(((unsigned long)len+chunk-1)/chunk)*BUS_SPI_CRC_LEN;
+  //size must fit in the DMA size register
+  if(size>0xFFFF){
+    return 0;
+  }
+  return size;
+}
+
+//return the buffer size needed to stream len bytes or zero if len is too long
+unsigned short BUS_SPI_stream_size(unsigned short len){
+  return BUS_SPI_frame_size(len,BUS_SPI_STREAM_CHUNK_LEN);
+}
+
+//return the buffer size needed to send len bytes with BUS_SPI_tx_chunked or zero if len is too long
+unsigned short BUS_SPI_chunked_size(unsigned short len){
+  //check number of chunks
+  if(((unsigned long)len+BUS_SPI_CHUNK_LEN-1)/BUS_SPI_CHUNK_LEN>BUS_SPI_CHUNK_MAX){
+    return 0;
+  }
+  return BUS_SPI_frame_size(len,BUS_SPI_CHUNK_LEN);
+}
+
+//get length of chunk idx
+static unsigned short BUS_SPI_chunk_len(unsigned short len,unsigned short chunk,unsigned short idx){
+  unsigned short clen;
+  //last chunk can be short
+  clen=len-idx*chunk;
+  if(clen>chunk){
+    clen=chunk;
+  }
+  return clen;
+}
+
+//add a CRC after each chunk of data, data is moved to make room for the CRCs
+//buffer must be at least BUS_SPI_frame_size(len,chunk) bytes
+static void BUS_SPI_frame(unsigned char *buf,unsigned short len,unsigned short chunk){
+  unsigned short n,src,dst,clen,crc;
+  //get number of chunks
+  n=((unsigned long)len+chunk-1)/chunk;
+  //start with the last chunk so data is not overwritten
+  for(;n>0;n--){
+    //offset of chunk data
+    src=(n-1)*chunk;
+    //offset of framed chunk, the CRCs of the chunks before this one come first
+    dst=src+(n-1)*BUS_SPI_CRC_LEN;
+    //get chunk length, last chunk can be short
+    clen=BUS_SPI_chunk_len(len,chunk,n-1);
+    //move chunk into place
+    memmove(buf+dst,buf+src,clen);
+    //calculate CRC
+    crc=crc16(buf+dst,clen);
+    //send CRC in Big endian order
+    buf[dst+clen]=crc>>8;
+    buf[dst+clen+1]=crc;
+  }
+}
+
+//compress data and send it over SPI, data is sent uncompressed if it does not get smaller
+//buffer must have room for the CRC after the data
+int BUS_SPI_tx_compress(unsigned char addr,void *buf,unsigned short len){
+  unsigned char rdy[3],*lz;
+  unsigned short clen,crc,max;
+  int resp;
+  //check address
+  if((resp=BUS_SPI_addr_chk(addr))!=RET_SUCCESS){
+    //return error if it occured
+    return resp;
+  }
+  //check length, data must fit in the buffer on the other end when decompressed
+  if(len==0 || len>BUS_get_buffer_size()){
+    return ERR_BAD_LEN;
+  }
+  //get buffer for compressed data
+  lz=BUS_buffer_alloc(CTL_TIMEOUT_NOW,0);
+  //send uncompressed if there is no buffer
+  if(lz==NULL){
+    return BUS_SPI_txrx(addr,buf,NULL,len);
+  }
+  //compressed data must be smaller and leave room for the CRC
+  max=BUS_get_buffer_size()-BUS_SPI_CRC_LEN;
+  if(max>=len){
+    max=len-1;
+  }
+  //compress data
+  clen=lz_compress(buf,len,lz,max);
+  //check if data got smaller
+  if(clen==0){
+    //done with buffer
+    BUS_buffer_free(lz);
+    //send uncompressed
+    return BUS_SPI_txrx(addr,buf,NULL,len);
+  }
+  //calculate CRC over compressed data
+  crc=crc16(lz,clen);
+  //send CRC in Big endian order
+  lz[clen]=crc>>8;
+  lz[clen+1]=crc;
+  //setup SPI structure
+  arcBus_stat.spi_stat.len=clen;
+  arcBus_stat.spi_stat.rx=NULL;
+  arcBus_stat.spi_stat.tx=lz;
+  //send compressed length MSB first
+  rdy[0]=clen>>8;
+  rdy[1]=clen;
+  //send data type with compression flag
+  rdy[2]=((unsigned char*)buf)[0]|BUS_SPI_TYPE_LZ;
+  //send data
+  resp=BUS_SPI_slave_xfer(addr,lz,NULL,clen+BUS_SPI_CRC_LEN,rdy,sizeof(rdy),0);
+  //done with buffer
+  BUS_buffer_free(lz);
+  return resp;
+}
+
+//send data larger than the SPI buffer on the other end with a single CMD_SPI_RDY
+//data is sent in chunks with a CRC for each chunk, buffer must be at least BUS_SPI_stream_size(len) bytes
+int BUS_SPI_tx_stream(unsigned char addr,void *buf,unsigned short len){
+  unsigned char rdy[4];
+  unsigned short size;
+  int resp;
+  //check address
+  if((resp=BUS_SPI_addr_chk(addr))!=RET_SUCCESS){
+    //return error if it occured
+    return resp;
+  }
+  //get size with CRCs
+  size=BUS_SPI_stream_size(len);
+  //check length
+  if(len==0 || size==0){
+    return ERR_BAD_LEN;
+  }
+  //add CRCs
+  BUS_SPI_frame(buf,len,BUS_SPI_STREAM_CHUNK_LEN);
+  //setup SPI structure
+  arcBus_stat.spi_stat.len=len;
+  arcBus_stat.spi_stat.rx=NULL;
+  arcBus_stat.spi_stat.tx=buf;
+  arcBus_stat.spi_stat.nack=0;
+  //send length MSB first
+  rdy[0]=len>>8;
+  rdy[1]=len;
+  //send chunk length MSB first
+  rdy[2]=BUS_SPI_STREAM_CHUNK_LEN>>8;
+  rdy[3]=BUS_SPI_STREAM_CHUNK_LEN&0xFF;
+  //send data, allow time for the other end to process each chunk
+  return BUS_SPI_slave_xfer(addr,buf,NULL,size,rdy,sizeof(rdy),(size/BUS_SPI_STREAM_CHUNK_LEN+1)*BUS_SPI_STREAM_CHUNK_TIME);
+}
+
+//get chunk map from a packet, sent MSB first
+unsigned long BUS_SPI_map_get(const unsigned char *ptr){
+  return (((unsigned long)ptr[0])<<24)|(((unsigned long)ptr[1])<<16)|(((unsigned short)ptr[2])<<8)|ptr[3];
+}
+
+//put chunk map into a packet, sent MSB first
+void BUS_SPI_map_put(unsigned char *ptr,unsigned long map){
+  ptr[0]=map>>24;
+  ptr[1]=map>>16;
+  ptr[2]=map>>8;
+  ptr[3]=map;
+}
+
+//send data with a CRC for each chunk, only chunks with bad CRCs are sent again
+//buffer must be at least BUS_SPI_chunked_size(len) bytes, buffer contents are changed
+int BUS_SPI_tx_chunked(unsigned char addr,void *buf,unsigned short len){
+  unsigned char rdy[BUS_SPI_CHUNK_RDY_LEN],*ptr=buf;
+  unsigned short n,i,size,pos,dst,flen;
+  unsigned long map,bit;
+  int resp,try;
+  //check address
+  if((resp=BUS_SPI_addr_chk(addr))!=RET_SUCCESS){
+    //return error if it occured
+    return resp;
+  }
+  //check length
+  if(len==0 || BUS_SPI_chunked_size(len)==0){
+    return ERR_BAD_LEN;
+  }
+  //get number of chunks
+  n=(len+BUS_SPI_CHUNK_LEN-1)/BUS_SPI_CHUNK_LEN;
+  //add CRCs
+  BUS_SPI_frame(ptr,len,BUS_SPI_CHUNK_LEN);
+  //setup SPI structure
+  arcBus_stat.spi_stat.len=len;
+  arcBus_stat.spi_stat.rx=NULL;
+  arcBus_stat.spi_stat.tx=ptr;
+  //send length MSB first
+  rdy[0]=len>>8;
+  rdy[1]=len;
+  //first byte is the data type
+  rdy[2]=ptr[0];
+  //chunk length
+  rdy[3]=BUS_SPI_CHUNK_LEN;
+  //send all chunks first
+  map=0xFFFFFFFFUL>>(BUS_SPI_CHUNK_MAX-n);
+  for(try=0;try<BUS_SPI_CHUNK_TRIES;try++){
+    //get size of the chunks being sent
+    for(i=0,size=0,bit=1;i<n;i++,bit<<=1){
+      if(map&bit){
+        size+=BUS_SPI_chunk_len(len,BUS_SPI_CHUNK_LEN,i)+BUS_SPI_CRC_LEN;
+      }
+    }
+    //send map of chunks
+    BUS_SPI_map_put(rdy+4,map);
+    //send data
+    resp=BUS_SPI_slave_xfer(addr,ptr,NULL,size,rdy,sizeof(rdy),0);
+    //check if data was sent
+    if(resp==RET_SUCCESS){
+      return RET_SUCCESS;
+    }
+    //check for bad chunks, only chunks that were sent can be bad
+    if(arcBus_stat.spi_stat.nack!=(unsigned char)ERR_BAD_CRC || arcBus_stat.spi_stat.bad==0 || arcBus_stat.spi_stat.bad&~map){
+      return resp;
+    }
+    //move bad chunks to the front of the buffer, chunks are in order so this does not overwrite anything
+    for(i=0,pos=0,dst=0,bit=1;i<n;i++,bit<<=1){
+      //check if chunk was sent
+      if(!(map&bit)){
+        continue;
+      }
+      //get framed chunk length
+      flen=BUS_SPI_chunk_len(len,BUS_SPI_CHUNK_LEN,i)+BUS_SPI_CRC_LEN;
+      //check if chunk was bad
+      if(arcBus_stat.spi_stat.bad&bit){
+        //move chunk
+        memmove(ptr+dst,ptr+pos,flen);
+        dst+=flen;
+      }
+      pos+=flen;
+    }
+    //send bad chunks
+    map=arcBus_stat.spi_stat.bad;
+  }
+  //too many tries
+  return ERR_BAD_CRC;
+}
+
+//assert one or more interrupts on the bus
+void BUS_int_set(unsigned char set){
+    //disable interrupts for the pins
+    P1IE&=~set;
+    //set output level to high
+    P1OUT|=set;
+    //set pins to output
+    P1DIR|=set;
+#ifdef CDH_LIB
+    //if CDH set to full drive strength
+    P1REN&=~set;
+#endif        
+}
+    
+//de-assert one or more interrupts on the bus
+void BUS_int_clear(unsigned char clear){
+#ifdef CDH_LIB
+    //if CDH set to pull resistor
+    P1REN|=clear;
+#endif  
+    //set pins to input
+    P1DIR&=~clear;
+#ifdef CDH_LIB
+    //if CDH set to pull down
+    P1OUT&=~clear;
+#endif
+    //clear interrupt flag
+    P1IFG&=~clear;
+    //enable interrupts for the pins
+    P1IE|=clear;
+}
+
+//return which build is used
+int BUS_build(void){
+#ifdef CDH_LIB
+    return BUS_BUILD_CDH;
+#else
+    return BUS_BUILD_SUBSYSTEM;
+#endif
+}
+
+//timeout delay for time specified in milliseconds    
+void BUS_delay_msec(CTL_TIME_t timeout){
+  //TODO: calculate time in msec
+  //make sure timeout is greater than two
+  if(timeout<2){
+    //set timeout to minimum
+    timeout=2;
+  }
+  //wait for time to expire
+  ctl_timeout_wait(ctl_get_current_time()+timeout);
+}
+
+//events for short delays using TA1CCR2
+CTL_EVENT_SET_t BUS_delay_events;
+//mutex for TA1CCR2, only one task can use it at a time
+CTL_MUTEX_t BUS_delay_mutex;
+
+//busy wait for a number of microseconds
+static void BUS_delay_spin(unsigned short us){
+  while(us--){
+    __delay_cycles(BUS_DELAY_LOOP_CYCLES);
+  }
+}
+
+//get 32.768kHz timer counts since startup
+static unsigned long long BUS_time_counts(void){
+  unsigned long long t;
+  unsigned short sub;
+  t=BUS_time_ticks(&sub);
+  return (t<<5)+sub;
+}
+
+//wait a number of timer counts shorter than a few ticks using TA1CCR2
+static void BUS_delay_counts(unsigned short counts){
+  unsigned short t;
+  int en;
+  //check if the delay is too short to setup the timer, this polls for at most about 90us
+  if(counts<BUS_DELAY_CCR_MIN){
+    //poll the timer
+    t=readTA1()+counts;
+    while((short)(t-readTA1())>0);
+    return;
+  }
+  //check if another task is using the timer
+  if(!ctl_mutex_lock(&BUS_delay_mutex,CTL_TIMEOUT_NOW,0)){
+    //sleep to the next tick after the delay instead of spinning, the delay can be up to a tick long
+    ctl_timeout_wait(ctl_get_current_time()+counts/32+1);
+    return;
+  }
+  //clear event
+  ctl_events_set_clear(&BUS_delay_events,0,BUS_DELAY_EV_DONE);
+  en=ctl_global_interrupts_disable();
+  //set compare time and enable interrupt
+  TA1CCR2=readTA1()+counts;
+  TA1CCTL2=CCIE;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  //wait for timer, timeout in case the compare was missed
+  ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&BUS_delay_events,BUS_DELAY_EV_DONE,CTL_TIMEOUT_DELAY,counts/32+2);
+  //make sure interrupt is disabled
+  TA1CCTL2=0;
+  //done with timer
+  ctl_mutex_unlock(&BUS_delay_mutex);
+}
+
+//wait until a time in timer counts since startup, returns ERR_TIMEOUT if the time has already passed
+static int BUS_delay_counts_until(unsigned long long target){
+  unsigned long long now,d;
+  //check if time has passed
+  if((now=BUS_time_counts())>=target){
+    return ERR_TIMEOUT;
+  }
+  do{
+    //get time left
+    d=target-now;
+    //check if the time is longer than a few ticks
+    if(d>BUS_DELAY_TICKS_MIN*32){
+      //sleep for whole ticks and use the timer for the rest
+      ctl_timeout_wait(ctl_get_current_time()+(CTL_TIME_t)(d/32)-1);
+    }else{
+      //wait for the rest of the time with the timer
+      BUS_delay_counts(d);
+    }
+  }while((now=BUS_time_counts())<target);
+  return RET_SUCCESS;
+}
+
+//timeout delay for time specified in microseconds
+//short delays busy wait, medium delays use TA1CCR2 and long delays sleep for whole ticks before using TA1CCR2
+void BUS_delay_usec(CTL_TIME_t timeout){
+  //busy wait for short delays
+  if(timeout<BUS_DELAY_SPIN_MAX){
+    BUS_delay_spin(timeout);
+    return;
+  }
+  //convert to timer counts rounding up, 32768/1000000=512/15625
+  BUS_delay_counts_until(BUS_time_counts()+((unsigned long long)timeout*512+15624)/15625);
+}
+
+//wait until period microseconds after the last wake time and update the wake time
+//wake should be set from BUS_time_now_us before the first call, returns ERR_TIMEOUT if the wake time had already passed
+int BUS_delay_until(unsigned long long *wake,unsigned long period){
+  //next wake time, set from the last wake time so delays don't add up
+  *wake+=period;
+  //convert to timer counts rounding up and wait
+  return BUS_delay_counts_until((*wake*512+15624)/15625);
+}
+ 
@@ -1,321 +1,562 @@
-#ifndef __ARC_BUS_H
-#define __ARC_BUS_H
-
-#include <ctl.h>
-
-//Error source definitions
-enum{ERR_SRC_ARCBUS=0,ERR_SRC_SUBSYSTEM=50};
-
-//Macros for watchdog interaction
-#define WDT_KICK()        (WDTCTL=WDTPW|WDTCNTCL|WDTSSEL_1|WDTIS_3)
-//#define WDT_KICK          WDT_STOP
-#define WDT_STOP()        (WDTCTL=WDTPW|WDTHOLD|WDTCNTCL)
-
-//thread priorities
-enum{BUS_PRI_EXTRA_LOW=20,BUS_PRI_LOW=50,BUS_PRI_NORMAL=80,BUS_PRI_HIGH=110,BUS_PRI_EXTRA_HIGH=140,BUS_PRI_EXTREME=170,BUS_PRI_CRITICAL=200};
-
-//priority for main arcbus task
-#define BUS_PRI_ARCBUS        (BUS_PRI_EXTRA_HIGH+20)
-//priority for arcbus helper task
-#define BUS_PRI_ARCBUS_HELPER (BUS_PRI_EXTRA_HIGH+18)
-
-
-//Flags for events handled by BUS functions (ex BUS_cmd_tx)
-enum{BUS_EV_CMD_NACK=(1<<0),BUS_EV_I2C_COMPLETE=(1<<1),BUS_EV_I2C_NACK=(1<<2),BUS_EV_SPI_COMPLETE=(1<<3),BUS_EV_I2C_ABORT=(1<<4),BUS_EV_SPI_NACK=(1<<5),BUS_EV_I2C_ERR_CCL=(1<<6),BUS_EV_I2C_MASTER_STARTED=(1<<7),BUS_EV_I2C_TX_SELF=1<<8};
-//all events for SPI master
-#define BUS_EV_SPI_MASTER           (BUS_EV_SPI_COMPLETE|BUS_EV_SPI_NACK)
-//all events created by master transactions
-#define BUS_EV_I2C_MASTER           (BUS_EV_I2C_COMPLETE|BUS_EV_I2C_NACK|BUS_EV_I2C_ABORT|BUS_EV_I2C_TX_SELF)
-//start events created by master transactions
-#define BUS_EV_I2C_MASTER_START     (BUS_EV_I2C_MASTER_STARTED|BUS_EV_I2C_NACK)
-
-//flags for events handled by the subsystem
-enum{SUB_EV_PWR_OFF=(1<<0),SUB_EV_PWR_ON=(1<<1),SUB_EV_SEND_STAT=(1<<2),SUB_EV_SPI_DAT=(1<<3),
-     SUB_EV_SPI_ERR_CRC=(1<<4),SUB_EV_SPI_ERR_BUSY=(1<<5),SUB_EV_ASYNC_OPEN=(1<<6),SUB_EV_ASYNC_CLOSE=(1<<7),
-     SUB_EV_INT_0=(1<< 8),SUB_EV_INT_1=(1<< 9),SUB_EV_INT_2=(1<<10),SUB_EV_INT_3=(1<<11),
-     SUB_EV_INT_4=(1<<12),SUB_EV_INT_5=(1<<13),SUB_EV_INT_6=(1<<14),SUB_EV_INT_7=(1<<15)
-     };
-//shift to apply to interrupt flags
-#define SUB_EV_INT_SHIFT        8
-
-//all subsystem events
-#define SUB_EV_ALL                  (SUB_EV_PWR_OFF|SUB_EV_PWR_ON|SUB_EV_SEND_STAT|SUB_EV_SPI_DAT|SUB_EV_SPI_ERR_CRC|SUB_EV_INT_0|SUB_EV_INT_1|SUB_EV_INT_2|SUB_EV_INT_3|SUB_EV_INT_4|SUB_EV_INT_5|SUB_EV_INT_6|SUB_EV_INT_7)
-//all subsystem events but pin interrupts
-#define SUB_EV_NO_INT               (SUB_EV_PWR_OFF|SUB_EV_PWR_ON|SUB_EV_SEND_STAT|SUB_EV_SPI_DAT|SUB_EV_SPI_ERR_CRC)
-//only pin interrupts
-#define SUB_EV_INT                  (SUB_EV_INT_0|SUB_EV_INT_1|SUB_EV_INT_2|SUB_EV_INT_3|SUB_EV_INT_4|SUB_EV_INT_5|SUB_EV_INT_6|SUB_EV_INT_7)
-//only SPI subsystem events
-#define SUB_EV_SPI                  (SUB_EV_SPI_DAT|SUB_EV_SPI_ERR_CRC|SUB_EV_SPI_ERR_BUSY)
-
-
-//command table for ARCBUS commands
-enum{CMD_PING=7,CMD_NACK=51,CMD_SPI_COMPLETE,CMD_SPI_RDY,CMD_SUB_ON,CMD_SUB_OFF,CMD_SUB_POWERUP,CMD_RESET,CMD_SUB_STAT,
-     CMD_SPI_CLEAR,CMD_EPS_STAT,CMD_LEDL_STAT,CMD_ACDS_STAT,CMD_COMM_STAT,CMD_IMG_STAT,CMD_ASYNC_SETUP,
-     CMD_ASYNC_DAT,CMD_SPI_DATA_ACTION,CMD_MAG_DATA,CMD_MAG_SAMPLE_CONFIG,CMD_ERR_REQ,CMD_IMG_READ_PIC,
-     CMD_IMG_TAKE_TIMED_PIC,CMD_IMG_TAKE_PIC_NOW,CMD_GS_DATA,CMD_TEST_MODE,CMD_BEACON_ON,CMD_ACDS_CONFIG,
-     CMD_IMG_CLEARPIC,CMD_LEDL_READ_BLOCK,CMD_ACDS_READ_BLOCK,CMD_EPS_SEND,CMD_LEDL_BLOW_FUSE,CMD_SPI_ABORT};
-
-//bit to allow NACK to be sent
-#define CMD_TX_NACK                 (0x80)
-//mask for address in command
-#define CMD_ADDR_MASK               (0x7F)
-
-//length of SPI CRC
-#define BUS_SPI_CRC_LEN             (2)
-//length of I2C CRC
-#define BUS_I2C_CRC_LEN             (1)
-//length of I2C packet header
-#define BUS_I2C_HDR_LEN             (2)
-
-//maximum packet length that can fit in the receive buffer
-#define BUS_I2C_MAX_PACKET_LEN      (30)
-
-//version constants
-#define BUS_INVALID_MAJOR_VER       (0xFFFF)
-#define BUS_INVALID_MINOR_VER       (0xFFFF)
-#define BUS_VER_DIRTY               (1)         //local, uncommited, changes when library compiled
-#define BUS_VER_CLEAN               (0)         //all changes commited when library compiled
-
-//Return values from bus functions
-enum{RET_SUCCESS=0,ERR_BAD_LEN=-1,ERR_CMD_NACK=-2,ERR_I2C_NACK=-3,ERR_UNKNOWN=-4,ERR_BAD_ADDR=-5,ERR_BAD_CRC=-6,ERR_TIMEOUT=-7,ERR_BUSY=-8,ERR_INVALID_ARGUMENT=-9,ERR_PACKET_TOO_LONG=-10,ERR_I2C_ABORT=-11,ERR_TIME_INVALID=-12,ERR_TIME_TOO_OLD=-13,ERR_I2C_CLL=-14,ERR_I2C_START_TIMEOUT=-15,ERR_I2C_TX_SELF=-16,ERR_DMA_TIMEOUT=-17};
-
-//command response values these will be send as part of the NACK packet
-enum{ERR_PK_LEN=1,ERR_UNKNOWN_CMD=2,ERR_SPI_LEN=3,ERR_BAD_PK=4,ERR_SPI_BUSY=5,ERR_BUFFER_BUSY=6,ERR_ILLEAGLE_COMMAND=7,ERR_SPI_NOT_RUNNING=8,ERR_SPI_WRONG_ADDR=9,ERR_PK_BAD_PARM=10};
-
-//table of board addresses
-//BUS_ADDR_GC is general call address which every board will acknowledge for receiving
-enum{BUS_ADDR_LEDL=0x11,BUS_ADDR_ACDS=0x12,BUS_ADDR_COMM=0x13,BUS_ADDR_IMG=0x14,BUS_ADDR_CDH=0x15,BUS_ADDR_GC=0};
-    
-//data to be sent over I2C when there is no data to transmit
-#define BUS_I2C_DUMMY_DATA  (0xFF)
-
-//data to be sent over SPI when there is no data to transmit
-#define BUS_SPI_DUMMY_DATA  (0xFF)
-
-//flags for BUS_cmd_tx
-enum{BUS_CMD_FL_NACK=0x02};
-
-//Power states
-enum{SUB_PWR_OFF=0,SUB_PWR_ON};
-
-//I2C modes
-enum {BUS_I2C_IDLE=0,BUS_I2C_TX=1,BUS_I2C_RX};
-
-//I2C master states
-enum{BUS_I2C_MASTER_IDLE=0,BUS_I2C_MASTER_PENDING=1,BUS_I2C_MASTER_IN_PROGRESS};
-
-//SPI modes
-enum{BUS_SPI_IDLE=0,BUS_SPI_SLAVE,BUS_SPI_MASTER};
-    
-//SPI data actions
-enum{SPI_DAT_ACTION_INVALID=0,SPI_DAT_ACTION_SD_WRITE,SPI_DAT_ACTION_NULL,SPI_DAT_ACTION_PRINT};
-
-//SPI Data types
-enum{SPI_BEACON_DAT='B',SPI_IMG_DAT='I',SPI_LEDL_DAT='L',SPI_ERROR_DAT='E',SPI_ACDS_DAT='A'};
-    
-//error request types
-enum{ERR_REQ_REPLAY=0};
-    
-//Alarm numbers for BUS alarms
-enum{BUS_ALARM_0=0,BUS_ALARM_1,BUS_NUM_ALARMS};
-
-//return values for BUS_build
-enum{BUS_BUILD_CDH,BUS_BUILD_SUBSYSTEM};
-
-//command parse flags
-enum{CMD_PARSE_ADDR0=(1<<0),CMD_PARSE_ADDR1=(1<<1),CMD_PARSE_ADDR2=(1<<2),CMD_PARSE_ADDR3=(1<<3),CMD_PARSE_GC_ADDR=(1<<7)};
-
-//return values for BUS_flags_to_addr
-enum{BUS_FLAGS_INVALID_ADDR=0xFF,BUS_FLAGS_ADDR_DISABLED=0xFE,BUS_FLAGS_ADDR_MASK=0x80};
-
-//ticker for time keeping
-typedef unsigned long ticker;
-
-//struct for I2C status
-typedef struct{
-  struct {
-    unsigned char *ptr;
-    short len,idx;
-  }rx;
-  struct {
-    const unsigned char *ptr;
-    short len,idx;
-    unsigned short stat;
-  }tx;
-  unsigned short mode;
-  CTL_MUTEX_t mutex;
-}BUS_I2C_STAT;
-
-//struct for SPI status
-typedef struct{
-  unsigned char *tx,*rx;
-  unsigned short len;
-  unsigned short mode;
-  unsigned char nack;
-}BUS_SPI_STAT;
-
-//struct for BUS status
-typedef struct{
-  BUS_I2C_STAT i2c_stat;
-  BUS_SPI_STAT spi_stat;
-  CTL_EVENT_SET_t events;
-}BUS_STAT;
-
-//callback to parse subsystem commands
-typedef int (*cmd_parse_Callback)(unsigned char src,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char flags);
-
-//bus status
-extern BUS_STAT arcBus_stat;
-
-//callback information for linked list
-typedef struct cp_cb{
-  //function to call
-  cmd_parse_Callback cb;
-  //flags for addresses used
-  unsigned char flags;
-  //priority, determines sort order
-  unsigned char priority;
-  //next in the list
-  struct cp_cb *next;
-}CMD_PARSE_DAT;
-
-//version structure
-typedef struct{
-  //numerical version
-  unsigned short major,minor;
-  unsigned short commits;
-  //version dirty flag
-  unsigned short dty;
-  //version hash
-  char hash[];
-}BUS_VERSION;
-
-//events for subsystems
-extern CTL_EVENT_SET_t SUB_events;
-
-//keep track of power status
-extern unsigned short powerState;
-
-//ARClib version string
-extern const char ARClib_version[];
-//ARClib version struct
-extern const BUS_VERSION ARClib_vstruct;
-
-//setup clocks and low tasking stuff for ARC
-void ARC_setup(void);
-
-//setup the ARC bus
-void initARCbus(unsigned char addr);
-
-//Enter the Idle loop. Start the ARCbus tasks and drop idle tasks to lowest priority
-void mainLoop(void);
-//main loop testing function, start ARC_Bus task then enter Idle task
-void mainLoop_testing(void (*cb)(void));
-
-//send packet over the bus
-int BUS_cmd_tx(unsigned char addr,void *buff,unsigned short len,unsigned short flags);
-//Send data over SPI
-int BUS_SPI_txrx(unsigned char addr,void *tx,void *rx,unsigned short len);
-//Setup buffer for command 
-unsigned char *BUS_cmd_init(unsigned char *buf,unsigned char id);
-
-//get current time
-ticker get_ticker_time(void);
-//set current time
-void set_ticker_time(ticker nt);
-//set and get current time
-ticker setget_ticker_time(ticker nt);
-
-//get and lock buffer
-void* BUS_get_buffer(CTL_TIMEOUT_t t, CTL_TIME_t timeout);
-//unlock buffer
-void BUS_free_buffer(void);
-//get buffer when it was locked by an ARCbus event
-void* BUS_get_buffer_from_event(void);
-//free buffer that was locked by an ARCbus event
-void BUS_free_buffer_from_event(void);
-//get the size of the buffer
-const unsigned int BUS_get_buffer_size(void);
-
-
-
-//check if communicating with a board
-int async_isOpen(void);
-
-//Open asynchronous communications with a board
-int async_open(unsigned char addr);
-
-//close current connection
-int async_close(void);
-
-//transmit a charecter
-int async_TxChar(unsigned char c);
-int async_Getc(void);
-int async_CheckKey(void);
-//setup events for byte queue
-void async_setup_events(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t txnotfull,CTL_EVENT_SET_t rxnotempty);
-//setup closed event
-void async_setup_close_event(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t closed);
-//send a chunk of async data from the queue
-int async_send_data(void);
-
-void reset_bor(unsigned char level,unsigned short source,int err, unsigned short argument);
-void reset_por(unsigned char level,unsigned short source,int err, unsigned short argument);
-#define reset reset_bor
-
-
-//get error string for bus errors
-const char *BUS_error_str(int error);
-//get string for command name
-const char* BUS_cmdtostr(unsigned char cmd);
-//get error string for command responses
-const char* BUS_cmd_resptostr(unsigned char resp);
-
-//stop global interrupts from happening 
-int BUS_stop_interrupts(void);
-
-//gracefully restart global interrupts
-void BUS_restart_interrupts(int int_stat);
-
-//set alarm to give an event at the given time
-int BUS_set_alarm(unsigned char num,ticker time,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event);
-//get the time an alarm will happen
-ticker BUS_get_alarm_time(unsigned char num);
-//check if an alarm is free
-int BUS_alarm_is_free(unsigned char num);
-
-//free a timer
-void BUS_free_alarm(unsigned char num);
-
-//assert one or more interrupts on the bus
-void BUS_int_set(unsigned char set);
-//de-assert one or more interrupts on the bus
-void BUS_int_clear(unsigned char clear);
-
-//check for own address
-int BUS_OA_check(unsigned char addr);
-//return own address
-unsigned char BUS_get_OA(void);
-//set own address
-unsigned char BUS_set_OA(unsigned char addr);
-
-//return which build is used
-int BUS_build(void);
-
-//register command parse callback
-void BUS_register_cmd_callback(CMD_PARSE_DAT *cb_dat);
-
-//enable extra I2C own address registers
-int BUS_I2C_aux_addr(unsigned char addr,unsigned char dest);
-//return I2C address based on flags
-unsigned char BUS_flags_to_addr(unsigned char flags);
-//find flags for address, address must be enabled
-unsigned char BUS_addr_to_flags(unsigned char addr);
-
-//timeout delay for time specified in milliseconds    
-void BUS_delay_msec(CTL_TIME_t timeout);
-
-//timeout delay for time specified in microseconds
-void BUS_delay_usec(CTL_TIME_t timeout);
-
-#endif
+#ifndef __ARC_BUS_H
+#define __ARC_BUS_H
+
+#include <ctl.h>
+
+//Error source definitions
+enum{ERR_SRC_ARCBUS=0,ERR_SRC_SUBSYSTEM=50};
+
+//Macros for watchdog interaction
+#define WDT_KICK()        (WDTCTL=WDTPW|WDTCNTCL|WDTSSEL_1|WDTIS_3)
+//#define WDT_KICK          WDT_STOP
+#define WDT_STOP()        (WDTCTL=WDTPW|WDTHOLD|WDTCNTCL)
+
+//thread priorities
+enum{BUS_PRI_EXTRA_LOW=20,BUS_PRI_LOW=50,BUS_PRI_NORMAL=80,BUS_PRI_HIGH=110,BUS_PRI_EXTRA_HIGH=140,BUS_PRI_EXTREME=170,BUS_PRI_CRITICAL=200};
+
+//priority for main arcbus task
+#define BUS_PRI_ARCBUS        (BUS_PRI_EXTRA_HIGH+20)
+//priority for arcbus helper task
+#define BUS_PRI_ARCBUS_HELPER (BUS_PRI_EXTRA_HIGH+18)
+
+
+//Flags for events handled by BUS functions (ex BUS_cmd_tx)
+enum{BUS_EV_CMD_NACK=(1<<0),BUS_EV_I2C_COMPLETE=(1<<1),BUS_EV_I2C_NACK=(1<<2),BUS_EV_SPI_COMPLETE=(1<<3),BUS_EV_I2C_ABORT=(1<<4),BUS_EV_SPI_NACK=(1<<5),BUS_EV_I2C_ERR_CCL=(1<<6),BUS_EV_I2C_MASTER_STARTED=(1<<7),BUS_EV_I2C_TX_SELF=1<<8,BUS_EV_I2C_MASTER_FREE=1<<9,BUS_EV_SPI_QUEUED=1<<10,BUS_EV_SPI_GO=1<<11};
+//all events for SPI master
+#define BUS_EV_SPI_MASTER           (BUS_EV_SPI_COMPLETE|BUS_EV_SPI_NACK)
+//all events created by master transactions
+#define BUS_EV_I2C_MASTER           (BUS_EV_I2C_COMPLETE|BUS_EV_I2C_NACK|BUS_EV_I2C_ABORT|BUS_EV_I2C_TX_SELF)
+//start events created by master transactions
+#define BUS_EV_I2C_MASTER_START     (BUS_EV_I2C_MASTER_STARTED|BUS_EV_I2C_NACK)
+
+//flags for events handled by the subsystem
+//SUB_EV_SPI_ERR_BUSY is set when SPI data is dropped because there was no buffer or compressed data could not be expanded
+//arcBus_stat.spi_stat.nack has the reason for SPI errors
+enum{SUB_EV_PWR_OFF=(1<<0),SUB_EV_PWR_ON=(1<<1),SUB_EV_SEND_STAT=(1<<2),SUB_EV_SPI_DAT=(1<<3),
+     SUB_EV_SPI_ERR_CRC=(1<<4),SUB_EV_SPI_ERR_BUSY=(1<<5),SUB_EV_ASYNC_OPEN=(1<<6),SUB_EV_ASYNC_CLOSE=(1<<7),
+     SUB_EV_INT_0=(1<< 8),SUB_EV_INT_1=(1<< 9),SUB_EV_INT_2=(1<<10),SUB_EV_INT_3=(1<<11),
+     SUB_EV_INT_4=(1<<12),SUB_EV_INT_5=(1<<13),SUB_EV_INT_6=(1<<14),SUB_EV_INT_7=(1<<15)
+     };
+//shift to apply to interrupt flags
+#define SUB_EV_INT_SHIFT        8
+
+//all subsystem events
+#define SUB_EV_ALL                  (SUB_EV_PWR_OFF|SUB_EV_PWR_ON|SUB_EV_SEND_STAT|SUB_EV_SPI_DAT|SUB_EV_SPI_ERR_CRC|SUB_EV_INT_0|SUB_EV_INT_1|SUB_EV_INT_2|SUB_EV_INT_3|SUB_EV_INT_4|SUB_EV_INT_5|SUB_EV_INT_6|SUB_EV_INT_7)
+//all subsystem events but pin interrupts
+#define SUB_EV_NO_INT               (SUB_EV_PWR_OFF|SUB_EV_PWR_ON|SUB_EV_SEND_STAT|SUB_EV_SPI_DAT|SUB_EV_SPI_ERR_CRC)
+//only pin interrupts
+#define SUB_EV_INT                  (SUB_EV_INT_0|SUB_EV_INT_1|SUB_EV_INT_2|SUB_EV_INT_3|SUB_EV_INT_4|SUB_EV_INT_5|SUB_EV_INT_6|SUB_EV_INT_7)
+//only SPI subsystem events
+#define SUB_EV_SPI                  (SUB_EV_SPI_DAT|SUB_EV_SPI_ERR_CRC|SUB_EV_SPI_ERR_BUSY)
+
+
+//command table for ARCBUS commands
+enum{CMD_PING=7,CMD_NACK=51,CMD_SPI_COMPLETE,CMD_SPI_RDY,CMD_SUB_ON,CMD_SUB_OFF,CMD_SUB_POWERUP,CMD_RESET,CMD_SUB_STAT,
+     CMD_SPI_CLEAR,CMD_EPS_STAT,CMD_LEDL_STAT,CMD_ACDS_STAT,CMD_COMM_STAT,CMD_IMG_STAT,CMD_ASYNC_SETUP,
+     CMD_ASYNC_DAT,CMD_SPI_DATA_ACTION,CMD_MAG_DATA,CMD_MAG_SAMPLE_CONFIG,CMD_ERR_REQ,CMD_IMG_READ_PIC,
+     CMD_IMG_TAKE_TIMED_PIC,CMD_IMG_TAKE_PIC_NOW,CMD_GS_DATA,CMD_TEST_MODE,CMD_BEACON_ON,CMD_ACDS_CONFIG,
+     CMD_IMG_CLEARPIC,CMD_LEDL_READ_BLOCK,CMD_ACDS_READ_BLOCK,CMD_EPS_SEND,CMD_LEDL_BLOW_FUSE,CMD_SPI_ABORT,CMD_MULTI,CMD_BUS_SPEED,CMD_SPI_QUEUED,CMD_SPI_GO,CMD_FRAG,CMD_RPC,CMD_RPC_RESP,CMD_SEQ,CMD_SEQ_NACK,CMD_SEQ_ACK};
+
+//bit to allow NACK to be sent
+#define CMD_TX_NACK                 (0x80)
+//mask for address in command
+#define CMD_ADDR_MASK               (0x7F)
+
+//length of SPI CRC
+#define BUS_SPI_CRC_LEN             (2)
+//length of data in each chunk of an SPI stream, chunk and CRC fit in half of the SPI buffer
+#define BUS_SPI_STREAM_CHUNK_LEN    (512)
+//length of data in each chunk of a chunked SPI transfer
+#define BUS_SPI_CHUNK_LEN           (64)
+//maximum number of chunks in a chunked SPI transfer, one bit for each in the chunk map
+#define BUS_SPI_CHUNK_MAX           (32)
+//length of chunk map
+#define BUS_SPI_CHUNK_MAP_LEN       (4)
+//length of I2C CRC
+#define BUS_I2C_CRC_LEN             (1)
+//length of I2C packet header
+#define BUS_I2C_HDR_LEN             (2)
+//length of command header in a multiple command frame
+#define BUS_MULTI_HDR_LEN           (2)
+//length of fragment header in a CMD_FRAG packet
+#define BUS_FRAG_HDR_LEN            (2)
+//longest payload that BUS_cmd_tx can send as fragments
+#define BUS_FRAG_MAX_LEN            (256)
+//flag set in the fragment index of the last fragment
+#define BUS_FRAG_LAST               (0x80)
+//length of request header in a CMD_RPC packet
+#define BUS_RPC_HDR_LEN             (2)
+//length of response header in a CMD_RPC_RESP packet, sequence number and 16-bit status sent MSB first
+#define BUS_RPC_RESP_HDR_LEN        (3)
+//longest response that can be sent back
+#define BUS_RPC_RESP_MAX            (BUS_I2C_MAX_PACKET_LEN-BUS_RPC_RESP_HDR_LEN)
+//length of sequence header in a CMD_SEQ packet
+#define BUS_SEQ_HDR_LEN             (2)
+//length of sequence number, command and reason triplet in a CMD_SEQ_NACK packet
+#define BUS_SEQ_NACK_LEN            (3)
+//length of each sequence number in a CMD_SEQ_ACK packet
+#define BUS_SEQ_ACK_LEN             (1)
+//length of CMD_SUB_STAT time with timer counts since the tick
+#define BUS_SUB_STAT_LEN            (6)
+//length of CMD_SUB_STAT time from older CDH boards that only send the ticker time
+#define BUS_SUB_STAT_OLD_LEN        (4)
+
+//maximum packet length that can fit in the receive buffer
+#define BUS_I2C_MAX_PACKET_LEN      (30)
+
+//version constants
+#define BUS_INVALID_MAJOR_VER       (0xFFFF)
+#define BUS_INVALID_MINOR_VER       (0xFFFF)
+#define BUS_VER_DIRTY               (1)         //local, uncommited, changes when library compiled
+#define BUS_VER_CLEAN               (0)         //all changes commited when library compiled
+
+//Return values from bus functions
+enum{RET_SUCCESS=0,ERR_BAD_LEN=-1,ERR_CMD_NACK=-2,ERR_I2C_NACK=-3,ERR_UNKNOWN=-4,ERR_BAD_ADDR=-5,ERR_BAD_CRC=-6,ERR_TIMEOUT=-7,ERR_BUSY=-8,ERR_INVALID_ARGUMENT=-9,ERR_PACKET_TOO_LONG=-10,ERR_I2C_ABORT=-11,ERR_TIME_INVALID=-12,ERR_TIME_TOO_OLD=-13,ERR_I2C_CLL=-14,ERR_I2C_START_TIMEOUT=-15,ERR_I2C_TX_SELF=-16,ERR_DMA_TIMEOUT=-17};
+
+//command response values these will be send as part of the NACK packet
+enum{ERR_PK_LEN=1,ERR_UNKNOWN_CMD=2,ERR_SPI_LEN=3,ERR_BAD_PK=4,ERR_SPI_BUSY=5,ERR_BUFFER_BUSY=6,ERR_ILLEAGLE_COMMAND=7,ERR_SPI_NOT_RUNNING=8,ERR_SPI_WRONG_ADDR=9,ERR_PK_BAD_PARM=10,ERR_SPI_LZ=11,ERR_SEQ_NO_ACK=12};
+
+//table of board addresses
+//BUS_ADDR_GC is general call address which every board will acknowledge for receiving
+enum{BUS_ADDR_LEDL=0x11,BUS_ADDR_ACDS=0x12,BUS_ADDR_COMM=0x13,BUS_ADDR_IMG=0x14,BUS_ADDR_CDH=0x15,BUS_ADDR_GC=0};
+    
+//data to be sent over I2C when there is no data to transmit
+#define BUS_I2C_DUMMY_DATA  (0xFF)
+
+//data to be sent over SPI when there is no data to transmit
+#define BUS_SPI_DUMMY_DATA  (0xFF)
+
+//flag set in the SPI data type when data is compressed
+#define BUS_SPI_TYPE_LZ     (0x80)
+
+//flags for BUS_cmd_tx
+enum{BUS_CMD_FL_NACK=0x02};
+
+//Power states
+enum{SUB_PWR_OFF=0,SUB_PWR_ON};
+
+//I2C modes
+enum {BUS_I2C_IDLE=0,BUS_I2C_TX=1,BUS_I2C_RX};
+
+//I2C master states
+enum{BUS_I2C_MASTER_IDLE=0,BUS_I2C_MASTER_PENDING=1,BUS_I2C_MASTER_IN_PROGRESS,BUS_I2C_MASTER_CLAIMED};
+
+//SPI modes
+enum{BUS_SPI_IDLE=0,BUS_SPI_SLAVE,BUS_SPI_MASTER};
+    
+//SPI data actions
+enum{SPI_DAT_ACTION_INVALID=0,SPI_DAT_ACTION_SD_WRITE,SPI_DAT_ACTION_NULL,SPI_DAT_ACTION_PRINT};
+
+//SPI Data types
+enum{SPI_BEACON_DAT='B',SPI_IMG_DAT='I',SPI_LEDL_DAT='L',SPI_ERROR_DAT='E',SPI_ACDS_DAT='A'};
+    
+//error request types
+enum{ERR_REQ_REPLAY=0};
+    
+//sections that are profiled when the library is built with BUS_PROFILE defined
+enum{BUS_PROF_I2C_ISR=0,BUS_PROF_DMA_ISR,BUS_PROF_CMD_PARSE,BUS_PROF_CRC_DMA,BUS_PROF_NUM};
+
+//Alarm numbers for BUS alarms
+enum{BUS_ALARM_0=0,BUS_ALARM_1,BUS_NUM_ALARMS};
+//maximum number of alarms that can be armed at once, including numbered alarms
+#define BUS_ALARM_MAX               16
+
+//return values for BUS_build
+enum{BUS_BUILD_CDH,BUS_BUILD_SUBSYSTEM};
+
+//command parse flags
+enum{CMD_PARSE_ADDR0=(1<<0),CMD_PARSE_ADDR1=(1<<1),CMD_PARSE_ADDR2=(1<<2),CMD_PARSE_ADDR3=(1<<3),CMD_PARSE_GC_ADDR=(1<<7)};
+//flag for command callbacks and handlers that should be run from a worker task instead of the ARCbus task
+//commands sent with CMD_SEQ or BUS_cmd_txrx still run in the ARCbus task because the result is sent back
+//callbacks in the list without this flag are checked in the ARCbus task before a command is handed to a worker
+//workers only run deferred callbacks, a deferred handler that returns ERR_UNKNOWN_CMD only falls through to deferred callbacks
+#define CMD_PARSE_DEFERRED          (1<<6)
+
+//return values for BUS_flags_to_addr
+enum{BUS_FLAGS_INVALID_ADDR=0xFF,BUS_FLAGS_ADDR_DISABLED=0xFE,BUS_FLAGS_ADDR_MASK=0x80};
+
+//ticker for time keeping
+typedef unsigned long ticker;
+
+//SMCLK cycle counts for a profiled section
+typedef struct{
+  //number of times the section ran
+  unsigned long count;
+  //total and longest cycles
+  unsigned long total;
+  unsigned short max;
+}BUS_PROF_STAT;
+
+//alarm that gives an event at a given time, the structure is owned by the caller and used as the handle
+typedef struct{
+  //time of the next expiry
+  ticker time;
+  //ticks between expiries, zero for one shot alarms
+  ticker period;
+  //event to set when the alarm expires
+  CTL_EVENT_SET_t *e;
+  CTL_EVENT_SET_t event;
+  //position in the alarm heap plus one, zero if not armed so a zeroed alarm is not armed
+  short pos;
+}BUS_ALARM;
+
+//I2C bus speeds, boards advertise the fastest speed they support at power up
+enum{BUS_I2C_SPEED_50K=0,BUS_I2C_SPEED_100K,BUS_I2C_SPEED_400K,BUS_I2C_SPEED_1M,BUS_I2C_NUM_SPEEDS};
+//SPI bus speeds
+enum{BUS_SPI_SPEED_250K=0,BUS_SPI_SPEED_1M,BUS_SPI_SPEED_4M,BUS_SPI_SPEED_10M,BUS_SPI_NUM_SPEEDS};
+
+//classes of received packets, control packets are parsed first and have buffers saved for them
+enum{BUS_I2C_RX_CTL=0,BUS_I2C_RX_BULK,BUS_I2C_RX_NUM_CLASS};
+
+//struct for I2C status
+typedef struct{
+  struct {
+    unsigned char *ptr;
+    short len,idx;
+    //running CRC of the packet being received
+    unsigned char crc;
+    //number of packets dropped by the receive interrupt because of a bad CRC or length
+    unsigned short drop;
+    //number of packets dropped because the buffers for their class were full
+    unsigned short class_drop[BUS_I2C_RX_NUM_CLASS];
+    //number of packets dropped before their class was known because all buffers were full
+    unsigned short full_drop;
+  }rx;
+  struct {
+    const unsigned char *ptr;
+    short len,idx;
+    unsigned short stat;
+    //set when the current master transaction came from the transmit queue
+    unsigned char async;
+    //set when a blocking transmit is waiting for the transmit queue
+    unsigned char wait;
+    //set when DMA is feeding the transmit buffer
+    unsigned char dma;
+  }tx;
+  unsigned short mode;
+  //current master clock speed
+  unsigned char speed;
+  CTL_MUTEX_t mutex;
+}BUS_I2C_STAT;
+
+//struct for SPI status
+typedef struct{
+  unsigned char *tx,*rx;
+  unsigned short len;
+  unsigned short mode;
+  unsigned char nack;
+  //chunks with bad CRCs from the last chunked transfer
+  unsigned long bad;
+  //length of data received from the master in the last full duplex transfer
+  unsigned short rx_len;
+  //master clock speed, used when the next transaction is started
+  unsigned char speed;
+}BUS_SPI_STAT;
+
+//buffer pool counters
+typedef struct{
+  //number of blocks in use
+  unsigned char used;
+  //most blocks ever in use at once
+  unsigned char high;
+  //number of times a block could not be allocated
+  unsigned short fail;
+}BUS_BUFFER_STAT;
+
+//states for registered SPI receive buffers
+enum{BUS_SPI_RX_IDLE=0,BUS_SPI_RX_ARMED,BUS_SPI_RX_BUSY,BUS_SPI_RX_DONE};
+
+//match any source address or data type when registering a SPI receive buffer
+#define BUS_SPI_RX_ANY_ADDR     (0xFF)
+#define BUS_SPI_RX_ANY_TYPE     (0)
+
+//caller owned buffer that SPI data is received directly into
+typedef struct spi_rx_dest{
+  //buffer to receive into, must have room for the data and CRC
+  unsigned char *buf;
+  unsigned short size;
+  //source address and data type to accept
+  unsigned char addr,type;
+  //event to set when data is received
+  CTL_EVENT_SET_t *e;
+  CTL_EVENT_SET_t event;
+  //length of received data
+  volatile unsigned short len;
+  //buffer state
+  volatile unsigned char stat;
+  //next in the list
+  struct spi_rx_dest *next;
+}BUS_SPI_RX_DEST;
+
+//struct for BUS status
+typedef struct{
+  BUS_I2C_STAT i2c_stat;
+  BUS_SPI_STAT spi_stat;
+  CTL_EVENT_SET_t events;
+}BUS_STAT;
+
+//callback to parse subsystem commands
+typedef int (*cmd_parse_Callback)(unsigned char src,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char flags);
+
+//callback for completion of queued commands, this is called from the ARCbus helper task so it should not wait for long
+typedef void (*cmd_tx_Callback)(unsigned char addr,unsigned char cmd,int result);
+
+//callback to answer a request from BUS_cmd_txrx, up to BUS_RPC_RESP_MAX bytes are written to resp
+typedef int (*cmd_rpc_Callback)(unsigned char src,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char *resp,unsigned short *resp_len);
+
+//bus status
+extern BUS_STAT arcBus_stat;
+
+//callback information for linked list
+typedef struct cp_cb{
+  //function to call
+  cmd_parse_Callback cb;
+  //flags for addresses used
+  unsigned char flags;
+  //priority, determines sort order
+  unsigned char priority;
+  //next in the list
+  struct cp_cb *next;
+}CMD_PARSE_DAT;
+
+//version structure
+typedef struct{
+  //numerical version
+  unsigned short major,minor;
+  unsigned short commits;
+  //version dirty flag
+  unsigned short dty;
+  //version hash
+  char hash[];
+}BUS_VERSION;
+
+//events for subsystems
+extern CTL_EVENT_SET_t SUB_events;
+
+//keep track of power status
+extern unsigned short powerState;
+
+//ARClib version string
+extern const char ARClib_version[];
+//ARClib version struct
+extern const BUS_VERSION ARClib_vstruct;
+
+//setup clocks and low tasking stuff for ARC
+void ARC_setup(void);
+
+//setup the ARC bus
+void initARCbus(unsigned char addr);
+
+//Enter the Idle loop. Start the ARCbus tasks and drop idle tasks to lowest priority
+void mainLoop(void);
+//main loop testing function, start ARC_Bus task then enter Idle task
+void mainLoop_testing(void (*cb)(void));
+
+//send packet over the bus, payloads longer than BUS_I2C_MAX_PACKET_LEN are sent as fragments
+//the packet is sent by itself and is never combined with other commands, use BUS_cmd_tx_async to have commands combined
+int BUS_cmd_tx(unsigned char addr,void *buff,unsigned short len,unsigned short flags);
+//queue packet to be sent over the bus, returns without waiting for the packet to be sent
+//commands without BUS_CMD_FL_NACK are combined into a CMD_MULTI frame with other commands queued for the same address
+int BUS_cmd_tx_async(unsigned char addr,void *buff,unsigned short len,unsigned short flags,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event,cmd_tx_Callback cb);
+//send command and wait for the response, returns response length or error. must not be called from the ARCbus task
+int BUS_cmd_txrx(unsigned char addr,void *buff,unsigned short len,void *resp,unsigned short size,CTL_TIME_t timeout);
+//send command with a sequence number without waiting for earlier commands to be accepted, waits if too many are unacknowledged
+//the receiver sends CMD_SEQ_ACK or CMD_SEQ_NACK for every command. a command with neither after BUS_SEQ_TIMEOUT ticks is rejected
+//with ERR_SEQ_NO_ACK, it may still have run. the timeout is longer than the worst case ACK latency so this only happens if packets are lost
+int BUS_cmd_tx_seq(unsigned char addr,void *buff,unsigned short len,unsigned short flags,unsigned char *seq);
+//wait until all sequenced commands sent to addr are accepted, returns ERR_CMD_NACK if one was rejected
+int BUS_cmd_seq_wait(unsigned char addr,CTL_TIME_t timeout);
+//get the oldest rejected sequenced command sent to addr, returns ERR_INVALID_ARGUMENT if there is none
+int BUS_cmd_seq_nack(unsigned char addr,unsigned char *seq,unsigned char *cmd,unsigned char *reason);
+//send a rejected sequenced command again
+int BUS_cmd_seq_resend(unsigned char addr,unsigned char seq);
+//forget a rejected sequenced command
+int BUS_cmd_seq_drop(unsigned char addr,unsigned char seq);
+//Send data over SPI, if rx is not NULL the master can send up to len bytes back
+//returns the number of bytes received in rx, zero if the master sent nothing back and rx was not filled, or a negative error
+int BUS_SPI_txrx(unsigned char addr,void *tx,void *rx,unsigned short len);
+//get buffer size needed to stream len bytes over SPI, returns zero if len is too long
+unsigned short BUS_SPI_stream_size(unsigned short len);
+//set priority for SPI transfers from addr when they have to wait, higher priority transfers go first
+int BUS_SPI_set_priority(unsigned char addr,unsigned char pri);
+//compress data and send it over SPI, data is sent uncompressed if it does not get smaller. buf must have room for the CRC
+int BUS_SPI_tx_compress(unsigned char addr,void *buf,unsigned short len);
+//get buffer size needed to send len bytes with BUS_SPI_tx_chunked, returns zero if len is too long
+unsigned short BUS_SPI_chunked_size(unsigned short len);
+//send data with a CRC for each chunk so only bad chunks are sent again, buf must be BUS_SPI_chunked_size(len) bytes long
+int BUS_SPI_tx_chunked(unsigned char addr,void *buf,unsigned short len);
+//send data larger than the SPI buffer in chunks, buf must be BUS_SPI_stream_size(len) bytes long
+int BUS_SPI_tx_stream(unsigned char addr,void *buf,unsigned short len);
+//set the fastest bus speeds this board supports, must be called before mainLoop to be sent at power up
+void BUS_set_speed_limit(unsigned char i2c,unsigned char spi);
+//Setup buffer for command 
+unsigned char *BUS_cmd_init(unsigned char *buf,unsigned char id);
+
+//get current time
+ticker get_ticker_time(void);
+//set current time
+void set_ticker_time(ticker nt);
+//set and get current time
+ticker setget_ticker_time(ticker nt);
+//get ticks since startup, sub is set to 32.768kHz timer counts since the last tick if it is not NULL. does not disable interrupts
+unsigned long long BUS_time_ticks(unsigned short *sub);
+//get microseconds since startup, does not disable interrupts
+unsigned long long BUS_time_now_us(void);
+//put the current time into a CMD_SUB_STAT packet, the I2C interrupt stamps it again when it wins the bus
+//CMD_SUB_STAT must be sent by itself, receivers ignore it inside CMD_MULTI, fragments, sequenced commands and RPC
+void BUS_time_stamp(unsigned char *ptr);
+//get the last measured time offset in timer counts and the drift estimate in timer counts per 65536 ticks
+void BUS_time_sync_stat(long *ofs,long *drift);
+//get cycle counts for a profiled section, returns ERR_INVALID_ARGUMENT if the library was not built with BUS_PROFILE
+int BUS_prof_get(unsigned char id,BUS_PROF_STAT *st);
+//clear cycle counts for all profiled sections
+void BUS_prof_clear(void);
+//use DMA for I2C master packets, used to compare cycles with and without DMA. only works if the library was built with BUS_PROFILE
+void BUS_prof_i2c_dma(int en);
+//parse a command as if it was received from addr, used to measure dispatch time without a second board
+//returns the parse result or ERR_INVALID_ARGUMENT if the library was not built with BUS_PROFILE
+int BUS_prof_parse(unsigned char addr,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char flags);
+
+//enable or disable tickless idle, when enabled the tick interrupt is skipped while idle until the next deadline
+void BUS_tickless(int en);
+//catch up time skipped while idle, interrupts outside of ARClib that wake tasks should call this before setting events when tickless idle is used
+void BUS_tick_resync(void);
+//get number of tick interrupts since startup, used to measure wakeups per second
+unsigned long BUS_tick_wakeups(void);
+
+//allocate a block from the buffer pool
+void* BUS_buffer_alloc(CTL_TIMEOUT_t t, CTL_TIME_t timeout);
+//add a reference to a buffer pool block
+int BUS_buffer_ref(void *buf);
+//remove a reference to a buffer pool block, block is freed when the last reference is removed
+int BUS_buffer_free(void *buf);
+//get buffer pool counters
+void BUS_buffer_stat(BUS_BUFFER_STAT *stat);
+//get and lock buffer
+void* BUS_get_buffer(CTL_TIMEOUT_t t, CTL_TIME_t timeout);
+//unlock buffer
+void BUS_free_buffer(void);
+//get buffer when it was locked by an ARCbus event
+void* BUS_get_buffer_from_event(void);
+//free buffer that was locked by an ARCbus event
+void BUS_free_buffer_from_event(void);
+//get the size of the buffer
+const unsigned int BUS_get_buffer_size(void);
+//register a buffer to receive SPI data from addr with data type type, buffer is owned by the caller again once event is set
+int BUS_SPI_rx_register(BUS_SPI_RX_DEST *dest,unsigned char addr,unsigned char type,void *buf,unsigned short size,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event);
+//stop receiving SPI data into a registered buffer
+int BUS_SPI_rx_unregister(BUS_SPI_RX_DEST *dest);
+//get next received SPI stream chunk, returns NULL if no chunk is ready
+unsigned char *BUS_SPI_stream_get(unsigned short *len,int *last);
+//done with SPI stream chunk, lets the next chunk be received
+void BUS_SPI_stream_release(void);
+//send data back to addr the next time it sends SPI data, buf must not change until event is set
+int BUS_SPI_reply(unsigned char addr,const void *buf,unsigned short len,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event);
+//cancel data waiting to be sent back to addr
+int BUS_SPI_reply_cancel(unsigned char addr);
+
+
+
+//check if communicating with a board
+int async_isOpen(void);
+
+//Open asynchronous communications with a board
+int async_open(unsigned char addr);
+
+//close current connection
+int async_close(void);
+
+//transmit a charecter
+int async_TxChar(unsigned char c);
+int async_Getc(void);
+int async_CheckKey(void);
+//setup events for byte queue
+void async_setup_events(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t txnotfull,CTL_EVENT_SET_t rxnotempty);
+//setup closed event
+void async_setup_close_event(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t closed);
+//send a chunk of async data from the queue
+int async_send_data(void);
+
+void reset_bor(unsigned char level,unsigned short source,int err, unsigned short argument);
+void reset_por(unsigned char level,unsigned short source,int err, unsigned short argument);
+#define reset reset_bor
+
+
+//get error string for bus errors
+const char *BUS_error_str(int error);
+//get string for command name
+const char* BUS_cmdtostr(unsigned char cmd);
+//get error string for command responses
+const char* BUS_cmd_resptostr(unsigned char resp);
+
+//stop global interrupts from happening 
+int BUS_stop_interrupts(void);
+
+//gracefully restart global interrupts
+void BUS_restart_interrupts(int int_stat);
+
+//set alarm to give an event at the given time
+int BUS_set_alarm(unsigned char num,ticker time,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event);
+//get the time an alarm will happen
+ticker BUS_get_alarm_time(unsigned char num);
+//check if an alarm is free
+int BUS_alarm_is_free(unsigned char num);
+
+//free a timer
+void BUS_free_alarm(unsigned char num);
+
+//setup an alarm to give an event, the alarm must not be armed
+void BUS_alarm_init(BUS_ALARM *a,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event);
+//arm an alarm to go off at the given time, then every period ticks if period is not zero
+int BUS_alarm_at(BUS_ALARM *a,ticker time,ticker period);
+//arm an alarm to go off in delay ticks, then every period ticks if period is not zero
+int BUS_alarm_in(BUS_ALARM *a,ticker delay,ticker period);
+//stop an alarm, returns ERR_BUSY if the alarm was not armed
+int BUS_alarm_cancel(BUS_ALARM *a);
+//check if an alarm is armed
+int BUS_alarm_armed(const BUS_ALARM *a);
+
+//assert one or more interrupts on the bus
+void BUS_int_set(unsigned char set);
+//de-assert one or more interrupts on the bus
+void BUS_int_clear(unsigned char clear);
+
+//check for own address
+int BUS_OA_check(unsigned char addr);
+//return own address
+unsigned char BUS_get_OA(void);
+//set own address
+unsigned char BUS_set_OA(unsigned char addr);
+
+//return which build is used
+int BUS_build(void);
+
+//register command parse callback
+void BUS_register_cmd_callback(CMD_PARSE_DAT *cb_dat);
+//register a handler for a single command, looked up directly instead of searching the callback list
+int BUS_register_cmd_handler(unsigned char cmd,unsigned char flags,cmd_parse_Callback fn);
+//register a handler that answers requests for a command sent with BUS_cmd_txrx, runs in the ARCbus task
+int BUS_register_rpc_handler(unsigned char cmd,cmd_rpc_Callback fn);
+//set the receive class for a command, bulk commands are parsed after control commands
+int BUS_I2C_rx_class(unsigned char cmd,unsigned char cl);
+//set the priority of a worker task that runs deferred command callbacks
+int BUS_worker_priority(unsigned char worker,unsigned char pri);
+
+//enable extra I2C own address registers
+int BUS_I2C_aux_addr(unsigned char addr,unsigned char dest);
+//return I2C address based on flags
+unsigned char BUS_flags_to_addr(unsigned char flags);
+//find flags for address, address must be enabled
+unsigned char BUS_addr_to_flags(unsigned char addr);
+
+//timeout delay for time specified in milliseconds    
+void BUS_delay_msec(CTL_TIME_t timeout);
+
+//timeout delay for time specified in microseconds
+//if another task is in a delay that uses TA1CCR2 the end of the delay can be up to a tick late
+void BUS_delay_usec(CTL_TIME_t timeout);
+//wait until period microseconds after the last wake time and update the wake time, used for periodic loops
+//wake should be set from BUS_time_now_us before the first call, returns ERR_TIMEOUT if the wake time had already passed
+int BUS_delay_until(unsigned long long *wake,unsigned long period);
+
+#endif
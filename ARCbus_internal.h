@@ -1,170 +1,417 @@
-#ifndef __ARC_BUS_INTERNAL_H
-#define __ARC_BUS_INTERNAL_H
-  #include <stddef.h>
-  #include <Error.h>
-  #include <ctl.h>
- 
-  #include "ARCbus.h"
-  
-  //define serial pins
-  #define BUS_PIN_SDA       BIT1
-  #define BUS_PIN_SCL       BIT0
-  
-  #define BUS_PINS_I2C      (BUS_PIN_SDA|BUS_PIN_SCL)
-  
-  #define BUS_PIN_SCK       BIT2
-  #define BUS_PIN_SOMI      BIT3
-  #define BUS_PIN_SIMO      BIT4
-    
-  #define BUS_PINS_SPI      (BUS_PIN_SOMI|BUS_PIN_SIMO|BUS_PIN_SCK)
-  
-  //ARCbus error sources
-  enum{BUS_ERR_SRC_CTL=ERR_SRC_ARCBUS,BUS_ERR_SRC_MAIN_LOOP,BUS_ERR_SRC_STARTUP,BUS_ERR_SRC_ASYNC,BUS_ERR_SRC_SETUP,BUS_ERR_SRC_ALARMS,BUS_ERR_SRC_ERR_REQ,BUS_ERR_SRC_I2C,
-      BUS_ERR_SRC_VERSION,BUS_NUM_ERR};
-
-  #define BUS_MAX_ERR       (BUS_NUM_ERR-1)
-  #define BUS_MIN_ERR       (ERR_SRC_ARCBUS)
-  
-  //error codes for CTL
-  enum{CTL_ERR_HANDLER};
-    
-  //error codes for main loop
-  enum{MAIN_LOOP_ERR_RESET,MAIN_LOOP_ERR_CMD_CRC,MAIN_LOOP_ERR_BAD_CMD,MAIN_LOOP_ERR_NACK_REC,MAIN_LOOP_ERR_SPI_COMPLETE_FAIL,
-      MAIN_LOOP_ERR_SPI_CLEAR_FAIL,MAIN_LOOP_ERR_MUTIPLE_CDH,MAIN_LOOP_ERR_CDH_NOT_FOUND,MAIN_LOOP_ERR_RX_BUF_STAT,MAIN_LOOP_ERR_I2C_RX_BUSY,
-      MAIN_LOOP_ERR_I2C_ARB_LOST,MAIN_LOOP_CDH_SUB_STAT_REC,MAIN_LOOP_RESET_FAIL,MAIN_LOOP_ERR_SVML,MAIN_LOOP_ERR_SVMH,MAIN_LOOP_SPI_ABORT,
-      MAIN_LOOP_ERR_SUBSYSTEM_VERSION_MISMATCH,MAIN_LOOP_ERR_NACK_BUSY,MAIN_LOOP_ERR_TX_NACK_FAIL,MAIN_LOOP_ERR_UNEXPECTED_NACK_EV};
-      
-  //error codes for startup code
-  enum{STARTUP_ERR_RESET_UNKNOWN,STARTUP_ERR_MAIN_RETURN,STARTUP_ERR_WDT_RESET,STARTUP_ERR_WDT_PW_RESET,STARTUP_ERR_BOR,STARTUP_ERR_RESET_PIN,STARTUP_ERR_RESET_FLASH_KEYV,
-       STARTUP_ERR_RESET_SVSL,STARTUP_ERR_RESET_SVSH,STARTUP_ERR_RESET_FLLUL,STARTUP_ERR_RESET_PERF,STARTUP_ERR_RESET_PMMKEY,STARTUP_ERR_RESET_SECYV,STARTUP_ERR_RESET_INVALID,
-       STARTUP_ERR_RESET_UNHANDLED,STARTUP_ERR_UNEXPECTED_DOBOR,STARTUP_ERR_UNEXPECTED_DOPOR,STARTUP_ERR_PMM_VCORE,STARTUP_ERR_SVM_UNEXPECTED_VCORE,STARTUP_ERR_NO_ERROR};
-        
-  //error codes for async
-  enum{ASYNC_ERR_CLOSE_WRONG_ADDR,ASYNC_ERR_OPEN_ADDR,ASYNC_ERR_OPEN_BUSY,ASYNC_ERR_CLOSE_FAIL,ASYNC_ERR_DATA_FAIL};
-          
-  //error codes for setup 
-  enum{SETUP_ERR_DCO_MISSING_CAL};
-  
-  //error codes for alarms
-  enum{ALARMS_INVALID_TIME_UPDATE,ALARMS_REV_TIME_UPDATE,ALARMS_FWD_TIME_UPDATE,ALARMS_ADJ_TRIGGER};
-      
-  //error codes for error request
-  enum{ERR_REQ_ERR_SPI_SEND,ERR_REQ_ERR_BUFFER_BUSY,ERR_REQ_ERR_MUTEX_TIMEOUT};
-
-  //error codes for I2C
-  enum{I2C_ERR_INVALID_FLAGS,I2C_ERR_TOO_MANY_ERRORS};
-
-  //error codes for version comparison
-  enum{VERSION_ERR_INVALID_MAJOR,VERSION_ERR_MAJOR_REV_NEWER,VERSION_ERR_MAJOR_REV_OLDER,VERSION_ERR_INVALID_MINOR,VERSION_ERR_MINOR_REV_NEWER,
-       VERSION_ERR_MINOR_REV_OLDER,VERSION_ERR_DIRTY_REV,VERSION_ERR_HASH_MISMATCH,VERSION_ERR_COMMIT_MISMATCH};
-
-  //define constants for invalid errors
-  #define VERSION_ERR_INVALID_OTHER             (0xFF00)
-  #define VERSION_ERR_INVALID_MINE              (0x00FF)
-  
-  #define BUS_ERR_LEV_ROUTINE_RST   (ERR_LEV_DEBUG+3)
-  
-  //flags for internal BUS events
-  enum{BUS_INT_EV_I2C_CMD_RX=(1<<0),BUS_INT_EV_SPI_COMPLETE=(1<<1),BUS_INT_EV_BUFF_UNLOCK=(1<<2),BUS_INT_EV_RELEASE_MUTEX=(1<<3),BUS_INT_EV_I2C_RX_BUSY=(1<<4),BUS_INT_EV_I2C_ARB_LOST=(1<<5),BUS_INT_EV_SVML=(1<<6),BUS_INT_EV_SVMH=(1<<7)};
-
-  //values for async setup command
-  enum{ASYNC_OPEN,ASYNC_CLOSE};
-
-  //version comparison return values
-  enum{BUS_VER_SAME=0,BUS_VER_INVALID_MAJOR_REV=-1,BUS_VER_MAJOR_REV_OLDER=-2,BUS_VER_MAJOR_REV_NEWER=-3,BUS_VER_INVALID_MINOR_REV=-4,BUS_VER_MINOR_REV_OLDER=-5,
-       BUS_VER_MINOR_REV_NEWER=-6,BUS_VER_DIRTY_REV=-7,BUS_VER_HASH_MISMATCH=-8,BUS_VER_COMMIT_MISMATCH=-9,BUS_VER_LENGTH=-10};
-
-  //all events for ARCBUS internal commands
-  #define BUS_INT_EV_ALL    (BUS_INT_EV_I2C_CMD_RX|BUS_INT_EV_SPI_COMPLETE|BUS_INT_EV_BUFF_UNLOCK|BUS_INT_EV_RELEASE_MUTEX|BUS_INT_EV_I2C_RX_BUSY|BUS_INT_EV_I2C_ARB_LOST|BUS_INT_EV_SVML|BUS_INT_EV_SVMH)
-
-  //flags for bus helper events
-  enum{BUS_HELPER_EV_ASYNC_TIMEOUT=1<<0,BUS_HELPER_EV_SPI_COMPLETE_CMD=1<<1,BUS_HELPER_EV_SPI_CLEAR_CMD=1<<2,BUS_HELPER_EV_ASYNC_CLOSE=1<<3,BUS_HELPER_EV_ERR_REQ=1<<4,BUS_HELPER_EV_NACK=1<<5};
-  
-  //flags for I2C_PACKET structures
-  enum{I2C_PACKET_STAT_EMPTY,I2C_PACKET_STAT_IN_PROGRESS,I2C_PACKET_STAT_COMPLETE};
-  
-  //size of I2C packet queue
-  #define BUS_I2C_PACKET_QUEUE_LEN      10
-
-  //time to wait to retry an I2C packet in 32.768 kHz clocks
-  #define BUS_I2C_WAIT_TIME             25          // (about 0.7 ms or about the length of a 4 byte packet at 50kb/s)
-
-  //minimum timeout for SPI transaction
-  #define  BUS_SPI_MIN_TIMEOUT    (20)
-
-  //all helper task events
-  #define BUS_HELPER_EV_ALL (BUS_HELPER_EV_ASYNC_TIMEOUT|BUS_HELPER_EV_SPI_COMPLETE_CMD|BUS_HELPER_EV_SPI_CLEAR_CMD|BUS_HELPER_EV_ASYNC_CLOSE|BUS_HELPER_EV_ERR_REQ|BUS_HELPER_EV_NACK)
-  
-  //task structure for idle task and ARC bus task
-  extern CTL_TASK_t idle_task,ARC_bus_task;
-  
-    //type for keeping track of errors
-  typedef struct{
-    int magic;
-    unsigned short source;
-    int err;
-    unsigned short argument;
-    unsigned char level;
-  }RESET_ERROR;
-  
-  //structure for receiving I2C data
-  typedef struct{
-    unsigned char stat;
-    unsigned char len;
-    unsigned char flags;
-    unsigned char dat[BUS_I2C_HDR_LEN+BUS_I2C_MAX_PACKET_LEN+BUS_I2C_CRC_LEN];
-  }I2C_PACKET;
-
-  extern RESET_ERROR saved_error;
-  
-  //stack for ARC bus task
-  extern unsigned BUS_stack[256];
-  
-  extern BUS_STAT arcBus_stat;
-  
-  //buffer for ISR command receive
-  extern I2C_PACKET I2C_rx_buf[BUS_I2C_PACKET_QUEUE_LEN];
-  //queue indexes
-  extern short I2C_rx_in,I2C_rx_out;
-  
-  //power status
-  extern unsigned short powerState;
-  
-  
-  //task structures
-  extern CTL_TASK_t ARC_bus_task;
-  
-  //events for subsystems
-  extern CTL_EVENT_SET_t SUB_events,BUS_helper_events,BUS_INT_events;
-
-  //setup stuff for buffer usage
-  void BUS_init_buffer(void);
-  
-  //address for async communications
-  extern unsigned char async_addr;
-  extern unsigned short async_timer;
-  //queues for async communications
-  extern CTL_BYTE_QUEUE_t async_txQ;
-  extern CTL_BYTE_QUEUE_t async_rxQ;
-  //close current connection
-  int async_close_remote(void);
-  //Open asynchronous when asked to by a board
-  void async_open_remote(unsigned char addr);
-  
-  void BUS_I2C_release(void);
-  
-  void BUS_timer_timeout_check(void);
-  //trigger alarms that may have been updated over
-  void BUS_alarm_ticker_update(ticker newt,ticker oldt);
-  //read timer while it is running 
-  short readTA1(void);
-
-  //return error string for bus flags errors
-  const char* bus_flags_tostr(unsigned char flags);
-  //return error string for version errors
-  const char * bus_version_err_tostr(signed char resp);
-
-  //error decode function
-  const char *err_decode_arcbus(char buf[150], unsigned short source,int err, unsigned short argument);
-
-#endif
+#ifndef __ARC_BUS_INTERNAL_H
+#define __ARC_BUS_INTERNAL_H
+  #include <stddef.h>
+  #include <Error.h>
+  #include <ctl.h>
+ 
+  #include "ARCbus.h"
+  
+  //define serial pins
+  #define BUS_PIN_SDA       BIT1
+  #define BUS_PIN_SCL       BIT0
+  
+  #define BUS_PINS_I2C      (BUS_PIN_SDA|BUS_PIN_SCL)
+  
+  #define BUS_PIN_SCK       BIT2
+  #define BUS_PIN_SOMI      BIT3
+  #define BUS_PIN_SIMO      BIT4
+    
+  #define BUS_PINS_SPI      (BUS_PIN_SOMI|BUS_PIN_SIMO|BUS_PIN_SCK)
+  
+  //ARCbus error sources
+  enum{BUS_ERR_SRC_CTL=ERR_SRC_ARCBUS,BUS_ERR_SRC_MAIN_LOOP,BUS_ERR_SRC_STARTUP,BUS_ERR_SRC_ASYNC,BUS_ERR_SRC_SETUP,BUS_ERR_SRC_ALARMS,BUS_ERR_SRC_ERR_REQ,BUS_ERR_SRC_I2C,
+      BUS_ERR_SRC_VERSION,BUS_NUM_ERR};
+
+  #define BUS_MAX_ERR       (BUS_NUM_ERR-1)
+  #define BUS_MIN_ERR       (ERR_SRC_ARCBUS)
+  
+  //error codes for CTL
+  enum{CTL_ERR_HANDLER};
+    
+  //error codes for main loop
+  enum{MAIN_LOOP_ERR_RESET,MAIN_LOOP_ERR_CMD_CRC,MAIN_LOOP_ERR_BAD_CMD,MAIN_LOOP_ERR_NACK_REC,MAIN_LOOP_ERR_SPI_COMPLETE_FAIL,
+      MAIN_LOOP_ERR_SPI_CLEAR_FAIL,MAIN_LOOP_ERR_MUTIPLE_CDH,MAIN_LOOP_ERR_CDH_NOT_FOUND,MAIN_LOOP_ERR_RX_BUF_STAT,MAIN_LOOP_ERR_I2C_RX_BUSY,
+      MAIN_LOOP_ERR_I2C_ARB_LOST,MAIN_LOOP_CDH_SUB_STAT_REC,MAIN_LOOP_RESET_FAIL,MAIN_LOOP_ERR_SVML,MAIN_LOOP_ERR_SVMH,MAIN_LOOP_SPI_ABORT,
+      MAIN_LOOP_ERR_SUBSYSTEM_VERSION_MISMATCH,MAIN_LOOP_ERR_NACK_BUSY,MAIN_LOOP_ERR_TX_NACK_FAIL,MAIN_LOOP_ERR_UNEXPECTED_NACK_EV,MAIN_LOOP_ERR_SPEED_TX_FAIL,
+      MAIN_LOOP_ERR_SPI_GO_TIMEOUT,MAIN_LOOP_ERR_SPI_QUEUE_TX_FAIL,MAIN_LOOP_ERR_FRAG_DROP,MAIN_LOOP_ERR_RPC_RESP_FAIL,MAIN_LOOP_ERR_SPI_LZ};
+      
+  //error codes for startup code
+  enum{STARTUP_ERR_RESET_UNKNOWN,STARTUP_ERR_MAIN_RETURN,STARTUP_ERR_WDT_RESET,STARTUP_ERR_WDT_PW_RESET,STARTUP_ERR_BOR,STARTUP_ERR_RESET_PIN,STARTUP_ERR_RESET_FLASH_KEYV,
+       STARTUP_ERR_RESET_SVSL,STARTUP_ERR_RESET_SVSH,STARTUP_ERR_RESET_FLLUL,STARTUP_ERR_RESET_PERF,STARTUP_ERR_RESET_PMMKEY,STARTUP_ERR_RESET_SECYV,STARTUP_ERR_RESET_INVALID,
+       STARTUP_ERR_RESET_UNHANDLED,STARTUP_ERR_UNEXPECTED_DOBOR,STARTUP_ERR_UNEXPECTED_DOPOR,STARTUP_ERR_PMM_VCORE,STARTUP_ERR_SVM_UNEXPECTED_VCORE,STARTUP_ERR_NO_ERROR};
+        
+  //error codes for async
+  enum{ASYNC_ERR_CLOSE_WRONG_ADDR,ASYNC_ERR_OPEN_ADDR,ASYNC_ERR_OPEN_BUSY,ASYNC_ERR_CLOSE_FAIL,ASYNC_ERR_DATA_FAIL};
+          
+  //error codes for setup 
+  enum{SETUP_ERR_DCO_MISSING_CAL};
+  
+  //error codes for alarms
+  enum{ALARMS_INVALID_TIME_UPDATE,ALARMS_REV_TIME_UPDATE,ALARMS_FWD_TIME_UPDATE,ALARMS_ADJ_TRIGGER,ALARMS_ADJ_TRIGGER_COUNT};
+      
+  //error codes for error request
+  enum{ERR_REQ_ERR_SPI_SEND,ERR_REQ_ERR_BUFFER_BUSY,ERR_REQ_ERR_MUTEX_TIMEOUT};
+
+  //error codes for I2C
+  enum{I2C_ERR_INVALID_FLAGS,I2C_ERR_TOO_MANY_ERRORS,I2C_ERR_SPEED_CHANGE,I2C_ERR_SPEED_FAIL};
+
+  //error codes for version comparison
+  enum{VERSION_ERR_INVALID_MAJOR,VERSION_ERR_MAJOR_REV_NEWER,VERSION_ERR_MAJOR_REV_OLDER,VERSION_ERR_INVALID_MINOR,VERSION_ERR_MINOR_REV_NEWER,
+       VERSION_ERR_MINOR_REV_OLDER,VERSION_ERR_DIRTY_REV,VERSION_ERR_HASH_MISMATCH,VERSION_ERR_COMMIT_MISMATCH};
+
+  //define constants for invalid errors
+  #define VERSION_ERR_INVALID_OTHER             (0xFF00)
+  #define VERSION_ERR_INVALID_MINE              (0x00FF)
+  
+  #define BUS_ERR_LEV_ROUTINE_RST   (ERR_LEV_DEBUG+3)
+  
+  //flags for internal BUS events
+  //events for short delays
+  enum{BUS_DELAY_EV_DONE=(1<<0)};
+  enum{BUS_INT_EV_I2C_CMD_RX=(1<<0),BUS_INT_EV_SPI_COMPLETE=(1<<1),BUS_INT_EV_BUFF_UNLOCK=(1<<2),BUS_INT_EV_RELEASE_MUTEX=(1<<3),BUS_INT_EV_I2C_RX_BUSY=(1<<4),BUS_INT_EV_I2C_ARB_LOST=(1<<5),BUS_INT_EV_SVML=(1<<6),BUS_INT_EV_SVMH=(1<<7),BUS_INT_EV_SPI_CHUNK_FREE=(1<<8),BUS_INT_EV_SPI_NEXT=(1<<9)};
+
+  //values for async setup command
+  enum{ASYNC_OPEN,ASYNC_CLOSE};
+
+  //version comparison return values
+  enum{BUS_VER_SAME=0,BUS_VER_INVALID_MAJOR_REV=-1,BUS_VER_MAJOR_REV_OLDER=-2,BUS_VER_MAJOR_REV_NEWER=-3,BUS_VER_INVALID_MINOR_REV=-4,BUS_VER_MINOR_REV_OLDER=-5,
+       BUS_VER_MINOR_REV_NEWER=-6,BUS_VER_DIRTY_REV=-7,BUS_VER_HASH_MISMATCH=-8,BUS_VER_COMMIT_MISMATCH=-9,BUS_VER_LENGTH=-10};
+
+  //all events for ARCBUS internal commands
+  #define BUS_INT_EV_ALL    (BUS_INT_EV_I2C_CMD_RX|BUS_INT_EV_SPI_COMPLETE|BUS_INT_EV_BUFF_UNLOCK|BUS_INT_EV_RELEASE_MUTEX|BUS_INT_EV_I2C_RX_BUSY|BUS_INT_EV_I2C_ARB_LOST|BUS_INT_EV_SVML|BUS_INT_EV_SVMH|BUS_INT_EV_SPI_CHUNK_FREE|BUS_INT_EV_SPI_NEXT)
+
+  //flags for bus helper events
+  enum{BUS_HELPER_EV_ASYNC_TIMEOUT=1<<0,BUS_HELPER_EV_SPI_COMPLETE_CMD=1<<1,BUS_HELPER_EV_SPI_CLEAR_CMD=1<<2,BUS_HELPER_EV_ASYNC_CLOSE=1<<3,BUS_HELPER_EV_ERR_REQ=1<<4,BUS_HELPER_EV_NACK=1<<5,BUS_HELPER_EV_SPEED=1<<6,BUS_HELPER_EV_I2C_TX_DONE=1<<7};
+  
+  //flags for I2C_PACKET structures
+  enum{I2C_PACKET_STAT_EMPTY,I2C_PACKET_STAT_IN_PROGRESS,I2C_PACKET_STAT_COMPLETE};
+  
+  //size of I2C packet queue
+  #define BUS_I2C_PACKET_QUEUE_LEN      10
+  //number of I2C packet buffers that only control packets can use
+  #define BUS_I2C_RX_CTL_RESERVED       3
+
+  //size of I2C master transmit queue
+  #define BUS_I2C_TX_QUEUE_LEN          4
+
+  //time to wait for a queued packet to complete in ticks
+  #define BUS_I2C_TX_TIMEOUT            50
+
+  //number of worker tasks for deferred command callbacks
+  #define BUS_WORKER_NUM                2
+  //number of deferred commands that can be waiting or running
+  #define BUS_WORKER_PK_NUM             4
+  //stack size for worker tasks
+  #define BUS_WORKER_STACK_SIZE         256
+
+  //number of BUS_cmd_txrx requests that can wait for a response at once
+  #define BUS_RPC_PENDING_NUM           4
+  //number of commands that can have a request handler
+  #define BUS_RPC_HANDLER_NUM           8
+
+  //number of boards that sequenced commands can be sent to at once
+  #define BUS_SEQ_DEST_NUM              4
+  //number of unacknowledged sequenced commands for each board
+  #define BUS_SEQ_WINDOW                4
+  //time to wait for an ACK or NACK before a sequenced command is rejected with ERR_SEQ_NO_ACK
+  //ACKs are sent by the helper task after the command is parsed, this covers slow inline handlers and a busy bus
+  #define BUS_SEQ_TIMEOUT               256
+
+  //number of fragmented commands that can be reassembled at once
+  #define BUS_FRAG_BUF_NUM              2
+  //time to wait for the next fragment before a reassembly buffer can be reused
+  #define BUS_FRAG_TIMEOUT              100
+
+  //longest time in ticks to sleep with tickless idle, TA1 counts 32 per tick so this must be less than 2048
+  #define BUS_TICKLESS_MAX              1024
+  //timer counts needed to set TA1CCR0 before the next tick
+  #define BUS_TICKLESS_MARGIN           4
+
+  //time offset in ticks where the time is stepped instead of slewed
+  #define BUS_TIME_STEP_MAX             1024
+  //shortest and longest time in ticks between syncs used to measure drift
+  #define BUS_TIME_DRIFT_MIN            1024
+  #define BUS_TIME_DRIFT_MAX            (60*60*1024L)
+  //largest offset in timer counts used to measure drift
+  #define BUS_TIME_DRIFT_OFS_MAX        1024
+  //fraction of the measured drift added to the drift estimate
+  #define BUS_TIME_DRIFT_GAIN           4
+  //limit for the drift estimate in timer counts per 65536 ticks, about 1000ppm
+  #define BUS_TIME_DRIFT_LIMIT          2048
+
+  //delays shorter than this in microseconds are busy waits
+  #define BUS_DELAY_SPIN_MAX            100
+  //cycles to delay in each microsecond of a busy wait at 20MHz, the loop takes the other cycles
+  //this is an estimate for the loop overhead, check it with bench_delay in bench/bus_bench.c when the compiler or clock changes
+  #define BUS_DELAY_LOOP_CYCLES         14
+  //shortest delay in timer counts that uses TA1CCR2, shorter delays poll the timer
+  #define BUS_DELAY_CCR_MIN             3
+  //delays longer than this many ticks sleep for whole ticks first
+  #define BUS_DELAY_TICKS_MIN           2
+
+  //minimum I2C master packet length sent with DMA, shorter packets are sent from the I2C interrupt
+  #define BUS_I2C_DMA_MIN_LEN           4
+
+  //time to wait to retry an I2C packet in 32.768 kHz clocks
+  #define BUS_I2C_WAIT_TIME             25          // (about 0.7 ms or about the length of a 4 byte packet at 50kb/s)
+
+  //size of each buffer pool block, must fit a 1 KB SPI packet and CRC
+  #ifndef BUS_BUFFER_BLOCK_SIZE
+    #define BUS_BUFFER_BLOCK_SIZE       (1024+4)
+  #endif
+  //number of buffer pool blocks
+  #ifndef BUS_BUFFER_BLOCK_NUM
+    #define BUS_BUFFER_BLOCK_NUM        (2)
+  #endif
+
+  //number of SPI transfers that can wait for the SPI master
+  #define BUS_SPI_QUEUE_LEN             4
+  //time for a board to start a queued SPI transfer after CMD_SPI_GO is sent
+  #define BUS_SPI_GO_TIMEOUT            100
+  //time to wait for CMD_SPI_GO after a transfer is queued
+  #define BUS_SPI_QUEUE_TIMEOUT         3000
+
+  //length of CMD_SPI_RDY payload for chunked transfers
+  #define BUS_SPI_CHUNK_RDY_LEN         (4+BUS_SPI_CHUNK_MAP_LEN)
+  //number of times to send chunked SPI data
+  #define BUS_SPI_CHUNK_TRIES           3
+
+  //length of CMD_SPI_RDY payload for full duplex transfers
+  #define BUS_SPI_DUPLEX_RDY_LEN        5
+  //number of SPI replies that can wait to be sent
+  #define BUS_SPI_REPLY_NUM             4
+
+  //minimum timeout for SPI transaction
+  #define  BUS_SPI_MIN_TIMEOUT    (20)
+  //time allowed for the receiver to process each SPI stream chunk
+  #define  BUS_SPI_STREAM_CHUNK_TIME    (50)
+
+  //bus speeds used at power up and for boards that do not send speed capabilities
+  #define BUS_I2C_SPEED_DEFAULT         BUS_I2C_SPEED_50K
+  #define BUS_SPI_SPEED_DEFAULT         BUS_SPI_SPEED_4M
+
+  //fastest bus speeds advertised unless BUS_set_speed_limit is called
+  #ifndef BUS_I2C_SPEED_MAX
+    #define BUS_I2C_SPEED_MAX           BUS_I2C_SPEED_400K
+  #endif
+  #ifndef BUS_SPI_SPEED_MAX
+    #define BUS_SPI_SPEED_MAX           BUS_SPI_SPEED_4M
+  #endif
+
+  //length of speed capabilities in CMD_SUB_POWERUP and CMD_BUS_SPEED
+  #define BUS_SPEED_CAPS_LEN            (2)
+
+  //number of clock low timeouts or lost arbitrations in a row before the I2C speed is lowered
+  #define BUS_I2C_SPEED_ERRORS          5
+
+  //all helper task events
+  #define BUS_HELPER_EV_ALL (BUS_HELPER_EV_ASYNC_TIMEOUT|BUS_HELPER_EV_SPI_COMPLETE_CMD|BUS_HELPER_EV_SPI_CLEAR_CMD|BUS_HELPER_EV_ASYNC_CLOSE|BUS_HELPER_EV_ERR_REQ|BUS_HELPER_EV_NACK|BUS_HELPER_EV_SPEED|BUS_HELPER_EV_I2C_TX_DONE)
+  
+  //task structure for idle task and ARC bus task
+  extern CTL_TASK_t idle_task,ARC_bus_task;
+  
+    //type for keeping track of errors
+  typedef struct{
+    int magic;
+    unsigned short source;
+    int err;
+    unsigned short argument;
+    unsigned char level;
+  }RESET_ERROR;
+  
+  //CRC check result for received I2C packets
+  enum{I2C_PACKET_CRC_BAD=0,I2C_PACKET_CRC_GOOD};
+
+  //structure for receiving I2C data
+  typedef struct{
+    unsigned char stat;
+    unsigned char len;
+    unsigned char flags;
+    //result of CRC check done in the receive interrupt
+    unsigned char crc;
+    //time and timer counts since the tick when the packet started
+    ticker t_tick;
+    unsigned short t_sub;
+    unsigned char dat[BUS_I2C_HDR_LEN+BUS_I2C_MAX_PACKET_LEN+BUS_I2C_CRC_LEN];
+  }I2C_PACKET;
+
+  //queue of received packets, entries are indexes into I2C_rx_buf
+  typedef struct{
+    unsigned char idx[BUS_I2C_PACKET_QUEUE_LEN];
+    unsigned char in,out,num;
+  }I2C_RX_QUEUE;
+
+  //maximum number of commands that can be combined into one queued packet
+  #define BUS_I2C_TX_MULTI_MAX          4
+
+  //notification info for a queued command
+  typedef struct{
+    unsigned char cmd;
+    CTL_EVENT_SET_t *e;
+    CTL_EVENT_SET_t event;
+    cmd_tx_Callback cb;
+  }I2C_TX_NOTIFY;
+
+  //structure for queued I2C master packets
+  typedef struct{
+    unsigned char addr;
+    unsigned char len;
+    //number of commands in the packet
+    unsigned char num;
+    //result of the packet, saved in the interrupt for the helper task
+    int result;
+    //notification info for when the packet is done
+    I2C_TX_NOTIFY notify[BUS_I2C_TX_MULTI_MAX];
+    unsigned char dat[BUS_I2C_HDR_LEN+BUS_I2C_MAX_PACKET_LEN+BUS_I2C_CRC_LEN];
+  }I2C_TX_PACKET;
+
+  //I2C and SPI bus speeds
+  typedef struct{
+    unsigned char i2c,spi;
+  }BUS_SPEED;
+
+  extern RESET_ERROR saved_error;
+  
+  //stack for ARC bus task
+  extern unsigned BUS_stack[256];
+  
+  extern BUS_STAT arcBus_stat;
+  
+  //buffer for ISR command receive
+  extern I2C_PACKET I2C_rx_buf[BUS_I2C_PACKET_QUEUE_LEN];
+  //packet being received and packet being parsed
+  extern short I2C_rx_in,I2C_rx_out;
+  //queues of received packets for each class
+  extern I2C_RX_QUEUE I2C_rx_queue[BUS_I2C_RX_NUM_CLASS];
+  //commands that go in the bulk queue, one bit for each command
+  extern unsigned char I2C_rx_bulk[256/8];
+  //empty receive buffers and queues, must be called with interrupts disabled
+  void BUS_I2C_rx_init(void);
+
+  //queue for master transmit packets
+  extern I2C_TX_PACKET I2C_tx_buf[BUS_I2C_TX_QUEUE_LEN];
+  //queue indexes and number of queued packets
+  extern short I2C_tx_in,I2C_tx_out,I2C_tx_num;
+  //oldest sent packet waiting for the helper task and number of sent packets waiting
+  extern short I2C_tx_fin,I2C_tx_fin_num;
+  //timeout for the current queued packet
+  extern unsigned short I2C_tx_timer;
+
+  //fastest speeds supported by this board and speeds requested for the helper task to set
+  extern BUS_SPEED BUS_speed_limit,BUS_speed_req;
+  
+  //power status
+  extern unsigned short powerState;
+  
+  
+  //task structures
+  extern CTL_TASK_t ARC_bus_task;
+  
+  //events for subsystems
+  extern CTL_EVENT_SET_t SUB_events,BUS_helper_events,BUS_INT_events;
+
+  //setup stuff for buffer usage
+  void BUS_init_buffer(void);
+  //buffer received by the ARCbus task and passed to the subsystem
+  extern void *BUS_event_buffer;
+  
+  //address for async communications
+  extern unsigned char async_addr;
+  extern unsigned short async_timer;
+  //queues for async communications
+  extern CTL_BYTE_QUEUE_t async_txQ;
+  extern CTL_BYTE_QUEUE_t async_rxQ;
+  //close current connection
+  int async_close_remote(void);
+  //Open asynchronous when asked to by a board
+  void async_open_remote(unsigned char addr);
+  
+  void BUS_I2C_release(void);
+  //check that an I2C address is a 7-bit address
+  int addr_chk(unsigned char addr);
+
+  //start the next queued packet if the bus is free, must be called with interrupts disabled
+  void BUS_I2C_tx_next(void);
+  //finish the current queued packet, called from the I2C interrupt
+  void BUS_I2C_tx_done(unsigned short e);
+  //count errors and notify for sent queued packets, called from the helper task
+  void BUS_I2C_tx_finish(void);
+  //queued packet timed out, called from the timer interrupt
+  void BUS_I2C_tx_timeout(void);
+
+  //stop I2C master DMA and finish the packet from the I2C interrupt, called when SPI needs DMA2 or the packet is stopped
+  void BUS_I2C_DMA_stop(void);
+
+  //start worker tasks for deferred command callbacks
+  void BUS_worker_init(void);
+  //hand a command to a worker task, returns ERR_BUSY if no worker packets are free
+  int BUS_cmd_defer(unsigned char addr,unsigned char cmd,const unsigned char *dat,unsigned short len,unsigned char flags,unsigned char nack,cmd_parse_Callback cb,CMD_PARSE_DAT *next);
+  //passed with the NACK flag when parsing to run deferred callbacks in the ARCbus task, used by CMD_SEQ and CMD_RPC which need the result
+  #define BUS_PARSE_INLINE    (0x01)
+  //queue a NACK to be sent by the helper task, can be called from the ARCbus task or a worker task
+  void BUS_nack_post(unsigned char addr,unsigned char cmd,unsigned char resp);
+
+  //events for requests waiting for a response, one for each pending request
+  extern CTL_EVENT_SET_t BUS_rpc_events;
+  //events for sequenced commands, one for each board. set while the board has a rejected command
+  extern CTL_EVENT_SET_t BUS_seq_events;
+  //events for short delays using TA1CCR2
+  extern CTL_EVENT_SET_t BUS_delay_events;
+  //mutex for TA1CCR2
+  extern CTL_MUTEX_t BUS_delay_mutex;
+  //response received for a request, called from the ARCbus task
+  void BUS_rpc_done(unsigned char addr,unsigned char seq,short status,const unsigned char *dat,unsigned short len);
+  //request was NACKed, called from the ARCbus task
+  void BUS_rpc_nack(unsigned char addr,unsigned char reason);
+  //sequenced command was NACKed, seq is -1 if the sequence number is not known. called from the ARCbus task
+  void BUS_seq_nack(unsigned char addr,int seq,unsigned char reason);
+  //sequenced command was accepted, called from the ARCbus task
+  void BUS_seq_ack(unsigned char addr,unsigned char seq);
+
+  //request new bus speeds, speeds are limited to what this board supports. can be called from an ISR
+  void BUS_speed_set(unsigned char i2c,unsigned char spi);
+  //count an error that may be caused by running the I2C bus too fast, can be called from an ISR
+  void BUS_I2C_speed_err(void);
+  //change I2C master clock speed, waits for the bus to be idle
+  int BUS_I2C_set_speed(unsigned char speed);
+
+  //get chunk map from a packet, sent MSB first
+  unsigned long BUS_SPI_map_get(const unsigned char *ptr);
+  //put chunk map into a packet, sent MSB first
+  void BUS_SPI_map_put(unsigned char *ptr,unsigned long map);
+  
+  #ifdef BUS_PROFILE
+    //timer counting SMCLK cycles for profiling
+    #define BUS_PROF_TIMER    TA2R
+    //start profiling timer
+    void BUS_prof_init(void);
+    //add cycles for a profiled section, can be called from an ISR
+    void BUS_prof_add(unsigned char id,unsigned short cycles);
+    //set to use DMA for I2C master packets
+    extern unsigned char BUS_prof_dma_en;
+  #endif
+
+  //trigger alarms that have expired, called from the timer interrupt
+  void BUS_timer_timeout_check(void);
+  //get ticks from now until the next alarm, 0 if no alarms are set
+  ticker BUS_alarm_next(ticker now);
+  //program TA1CCR0 for the next deadline if tickless idle is enabled and go to low power mode, called from the idle task
+  void BUS_tick_sleep(void);
+  //trigger alarms that may have been updated over
+  void BUS_alarm_ticker_update(ticker newt,ticker oldt);
+  //extra timer counts for the next tick to slew the time, called from the tick interrupt after n ticks
+  short BUS_time_slew_step(unsigned short n);
+  //update time from a time received from CDH, rt and rsub is the remote time and lt and lsub is the local time when it was received
+  void BUS_time_sync(ticker rt,unsigned short rsub,ticker lt,unsigned short lsub);
+  //read timer while it is running 
+  short readTA1(void);
+
+  //return error string for bus flags errors
+  const char* bus_flags_tostr(unsigned char flags);
+  //return error string for version errors
+  const char * bus_version_err_tostr(signed char resp);
+
+  //error decode function
+  const char *err_decode_arcbus(char buf[150], unsigned short source,int err, unsigned short argument);
+
+#endif
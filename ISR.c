@@ -1,485 +1,916 @@
-#include <ctl.h>
-#include <msp430.h>
-#include <stdlib.h>
-#include "timerA.h"
-#include "ARCbus.h"
-#include "spi.h"
-#include "DMA.h"
-
-#include "ARCbus_internal.h"
-
-//buffer for ISR command receive
-I2C_PACKET I2C_rx_buf[BUS_I2C_PACKET_QUEUE_LEN];
-//queue indexes
-short I2C_rx_in,I2C_rx_out;
-
-//DMA events
-CTL_EVENT_SET_t DMA_events;
-
-//=======================================================================================
-//                      [Interrupt Service Routines]
-//=======================================================================================
-
-void bus_I2C_isr(void) __ctl_interrupt[USCI_B0_VECTOR]{
-  static unsigned short end_e=0;
-  switch(UCB0IV){
-    case USCI_I2C_UCALIFG:    //Arbitration lost
-      //Check if packet was in progress
-      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
-        //set index
-        arcBus_stat.i2c_stat.tx.idx=0;
-        //set I2C master state
-        arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_PENDING;
-        //set timer to attempt to send later
-        TA1CCR1=readTA1()+BUS_I2C_WAIT_TIME;
-        //setup TA1CCR1 interrupt
-        TA1CCTL1=CCIE;
-      }
-      //set flag to indicate condition
-      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_ARB_LOST,0);
-      //check if running
-      if(arcBus_stat.i2c_stat.mode!=BUS_I2C_IDLE){
-        //set status to idle
-        arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
-      }
-      //reset rx buffer status if in progress
-      if(I2C_rx_buf[I2C_rx_in].stat==I2C_PACKET_STAT_IN_PROGRESS){
-        //reset packet flags
-        I2C_rx_buf[I2C_rx_in].stat=I2C_PACKET_STAT_EMPTY;
-        //decrement packet index
-      }
-    break;
-    case USCI_I2C_UCNACKIFG:    //NACK interrupt  
-      //Acknowledge expected but not received  
-      //generate stop condition
-      UCB0CTL1|=UCTXSTP; 
-      //check if we have written more than a byte to the TX buffer
-      //one byte is always written after the start condition is sent
-      if(arcBus_stat.i2c_stat.tx.idx>1){
-          //check if end_e is set
-          if(end_e==0){
-            //set ABORT as the end event
-            end_e=BUS_EV_I2C_ABORT;
-          }
-      }else{
-          //set NACK as end event
-          end_e=BUS_EV_I2C_NACK;
-      }
-    break;
-    case USCI_I2C_UCSTTIFG:    //start condition received
-      //check if we are master
-      if(UCB0CTLW0&UCMST){
-        //clear NACK IFG
-        UCB0IFG&=~UCNACKIFG;
-        //no processing necessary
-        break;
-      }
-      //check status
-      //This is to fix the issue where the start condition happens before the stop can be processed
-      if(arcBus_stat.i2c_stat.mode==BUS_I2C_RX){
-        //set flag to notify 
-        ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_CMD_RX,0);
-        //set state to idle
-        arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
-      }
-      //Check if transmitting or receiving
-      if(UCB0CTL1&UCTR){   
-        //zero index
-        arcBus_stat.i2c_stat.tx.idx=0;
-        //An I2C slave should always be the receiver
-        arcBus_stat.i2c_stat.tx.ptr=NULL;
-        arcBus_stat.i2c_stat.tx.len=-1;
-        //set mode to Tx
-        arcBus_stat.i2c_stat.mode=BUS_I2C_TX;
-        //send first byte to save time
-        UCB0TXBUF=BUS_I2C_DUMMY_DATA;
-      }else{
-        //check buffer status
-        if(I2C_rx_buf[I2C_rx_in].stat!=I2C_PACKET_STAT_EMPTY){
-          //buffer is in-use transmit NACK
-          UCB0CTL1|=UCTXNACK;
-          //set flag to indicate an error
-          ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_RX_BUSY,0);
-        }else{
-          //setup receive status
-          arcBus_stat.i2c_stat.rx.ptr=I2C_rx_buf[I2C_rx_in].dat;
-          arcBus_stat.i2c_stat.rx.len=sizeof(I2C_rx_buf[0].dat);
-          arcBus_stat.i2c_stat.rx.idx=0;
-          //set mode to Rx
-          arcBus_stat.i2c_stat.mode=BUS_I2C_RX;
-          //set buffer status
-          I2C_rx_buf[I2C_rx_in].stat=I2C_PACKET_STAT_IN_PROGRESS;
-          //check if this is a general call packet
-          if(UCB0STATW&UCGC){
-            //set that general call address was received 
-            I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_GC_ADDR;
-          }else{
-            //received address is not known yet
-            I2C_rx_buf[I2C_rx_in].flags=0;
-          }
-        }
-      }
-    break;
-    case USCI_I2C_UCSTPIFG:    //Stop condition received
-      //check if we are master
-      if(UCB0CTLW0&UCMST){
-        //set saved event and clear TX self event
-        ctl_events_set_clear(&arcBus_stat.events,end_e,0);
-        //clear saved event
-        end_e=0;
-        //set state to idle
-        arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
-      }else{
-        //clear start condition interrupt
-        UCB0IFG&=~UCSTTIFG;
-        //check if transaction was a command
-        if(arcBus_stat.i2c_stat.mode==BUS_I2C_RX){
-          //set packet length
-          I2C_rx_buf[I2C_rx_in].len=arcBus_stat.i2c_stat.rx.idx;
-          //zero rx index
-          arcBus_stat.i2c_stat.rx.idx=0;
-          //set buffer status to complete
-          I2C_rx_buf[I2C_rx_in].stat=I2C_PACKET_STAT_COMPLETE;
-          //increment index
-          I2C_rx_in++;
-          //check for wraparound
-          if(I2C_rx_in>=BUS_I2C_PACKET_QUEUE_LEN){
-            I2C_rx_in=0;
-          }
-          //set flag to notify 
-          ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_CMD_RX,0);
-        }
-        //set state to idle
-        arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
-        //check master status to see if a command is pending
-        if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_PENDING){          
-          //transmision interrupted, start again
-          //set to transmit mode
-          UCB0CTLW0|=UCTR;
-          //clear master I2C flags
-          ctl_events_set_clear(&arcBus_stat.events,0,BUS_EV_I2C_MASTER|BUS_EV_I2C_MASTER_START);
-          //set master mode
-          UCB0CTLW0|=UCMST;
-          //clear saved event
-          end_e=0; 
-          //generate start condition
-          UCB0CTL1|=UCTXSTT;
-        }
-      }
-    break;
-    case USCI_I2C_UCRXIFG3:    //Slave3 RXIFG
-      //check if master transaction is in progress
-      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
-        //master transaction, nack as a slave
-        UCB0CTL1|=UCTXNACK;
-        //set send to self event
-        end_e=BUS_EV_I2C_TX_SELF;
-        break;
-      }  
-      //check buffer size
-      if(arcBus_stat.i2c_stat.rx.idx>=sizeof(I2C_rx_buf[0].dat)){
-        //receive buffer is full, send NACK
-        UCB0CTL1|=UCTXNACK;
-      }else{
-        //receive data
-        arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx++]=UCB0RXBUF;
-      }
-      //check if flags have been set
-      if(I2C_rx_buf[I2C_rx_in].flags==0){
-        //set flag for addr3
-        I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_ADDR3;
-      }
-    break;
-    case USCI_I2C_UCTXIFG3:    //Slave 3 TXIFG
-        //no data to send so send dummy data
-        UCB0TXBUF=BUS_I2C_DUMMY_DATA;
-    break;
-    case USCI_I2C_UCRXIFG2:    //Slave 2 RXIFG
-      //check if master transaction is in progress
-      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
-        //master transaction, nack as a slave
-        UCB0CTL1|=UCTXNACK;
-        //set send to self event
-        end_e=BUS_EV_I2C_TX_SELF;
-        break;
-      }  
-      //check buffer size
-      if(arcBus_stat.i2c_stat.rx.idx>=sizeof(I2C_rx_buf[0].dat)){
-        //receive buffer is full, send NACK
-        UCB0CTL1|=UCTXNACK;
-      }else{
-        //receive data
-        arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx++]=UCB0RXBUF;
-      }
-      //check if flags have been set
-      if(I2C_rx_buf[I2C_rx_in].flags==0){
-        //set flag for addr2
-        I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_ADDR2;
-      }
-    break;
-    case USCI_I2C_UCTXIFG2:    //Slave 2 TXIFG
-        //no data to send so send dummy data
-        UCB0TXBUF=BUS_I2C_DUMMY_DATA;
-    break;
-    case USCI_I2C_UCRXIFG1:    //Slave 1 RXIFG
-      //check if master transaction is in progress
-      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
-        //master transaction, nack as a slave
-        UCB0CTL1|=UCTXNACK;
-        //set send to self event
-        end_e=BUS_EV_I2C_TX_SELF;
-        break;
-      }  
-      //check buffer size
-      if(arcBus_stat.i2c_stat.rx.idx>=sizeof(I2C_rx_buf[0].dat)){
-        //receive buffer is full, send NACK
-        UCB0CTL1|=UCTXNACK;
-      }else{
-        //receive data
-        arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx++]=UCB0RXBUF;
-      }
-      //check if flags have been set
-      if(I2C_rx_buf[I2C_rx_in].flags==0){
-        //set flag for addr1
-        I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_ADDR1;
-      }
-    break;
-    case USCI_I2C_UCTXIFG1:    //Slave 1 TXIFG
-    break;
-    case USCI_I2C_UCRXIFG0:    //Data receive in master mode and Slave 0 RXIFG
-      //check if master transaction is in progress
-      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
-        //master transaction, nack as a slave
-        UCB0CTL1|=UCTXNACK;
-        //set send to self event
-        end_e=BUS_EV_I2C_TX_SELF;
-        break;
-      }  
-      //check buffer size
-      if(arcBus_stat.i2c_stat.rx.idx>=sizeof(I2C_rx_buf[0].dat)){
-        //receive buffer is full, send NACK
-        UCB0CTL1|=UCTXNACK;
-      }else{
-        //receive data
-        arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx++]=UCB0RXBUF;
-      }
-      //check if flags have been set
-      if(I2C_rx_buf[I2C_rx_in].flags==0){
-        //set flag for addr0
-        I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_ADDR0;
-      }
-    break;
-    case USCI_I2C_UCTXIFG0:    //Data transmit in master mode and Slave 0 TXIFG
-      //check master status 
-      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_PENDING){
-        //set I2C master state
-        arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_IN_PROGRESS;
-        //set state to tx
-        arcBus_stat.i2c_stat.mode=BUS_I2C_TX;
-        //set flag to notify 
-        ctl_events_set_clear(&arcBus_stat.events,BUS_EV_I2C_MASTER_STARTED,0);
-      }
-      //check if there are more bytes
-      if(arcBus_stat.i2c_stat.tx.len>arcBus_stat.i2c_stat.tx.idx){
-        //transmit data
-        UCB0TXBUF=arcBus_stat.i2c_stat.tx.ptr[arcBus_stat.i2c_stat.tx.idx++];
-      }else{//nothing left to send
-        if(!(UCB0CTLW0&UCMST)){//slave mode
-          //no more data to send so send dummy data
-          UCB0TXBUF=BUS_I2C_DUMMY_DATA;
-        }else{//Master Mode
-          //generate stop condition
-          UCB0CTL1|=UCTXSTP;
-          //set end event
-          end_e=BUS_EV_I2C_COMPLETE;
-          //set state to idle
-          arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
-        }
-      }
-    break;
-    case USCI_I2C_UCBCNTIFG:    //Byte Counter Zero
-    break;
-    case USCI_I2C_UCCLTOIFG:    //Cock low timeout
-      //check if master or slave
-      if(UCB0CTLW0&UCMST){
-        //master mode, generate stop condition
-        UCB0CTL1|=UCTXSTP;
-        //set end event
-        end_e=ERR_I2C_CLL;
-      }else{
-        //slave mode, send NACK
-        UCB0CTL1|=UCTXNACK;
-      }
-      //set event
-      ctl_events_set_clear(&arcBus_stat.events,BUS_EV_I2C_ERR_CCL,0);
-    break;
-    case USCI_I2C_UCBIT9IFG:    //9th bit interrupt
-    break;
-  }
-}
-
-
-
-//=================[SPI handler]=============================
-void bus_SPI_isr(void) __ctl_interrupt[USCI_A0_VECTOR]{
-  int tmp;
-  //DUMMY ISR, not used
-  tmp=UCA0IV;
-}
-
-//=================[Port pin Handler]=============================
-void bus_int(void) __ctl_interrupt[PORT2_VECTOR]{
-  switch(P2IV){
-    case P1IV_P1IFG0:
-      //set events for flags
-      ctl_events_set_clear(&SUB_events,SUB_EV_INT_0,0);
-    return;
-    case P1IV_P1IFG1:
-      //set events for flags
-      ctl_events_set_clear(&SUB_events,SUB_EV_INT_1,0);
-    return;
-    case P1IV_P1IFG2:
-      //set events for flags
-      ctl_events_set_clear(&SUB_events,SUB_EV_INT_2,0);
-    return;
-    case P1IV_P1IFG3:
-      //set events for flags
-      ctl_events_set_clear(&SUB_events,SUB_EV_INT_3,0);
-    return;
-    case P1IV_P1IFG4:
-      //set events for flags
-      ctl_events_set_clear(&SUB_events,SUB_EV_INT_4,0);
-    return;
-    case P1IV_P1IFG5:
-      //set events for flags
-      ctl_events_set_clear(&SUB_events,SUB_EV_INT_5,0);
-    return;
-    case P1IV_P1IFG6:
-      //set events for flags
-      ctl_events_set_clear(&SUB_events,SUB_EV_INT_6,0);
-    return;
-    case P1IV_P1IFG7:
-      //set events for flags
-      ctl_events_set_clear(&SUB_events,SUB_EV_INT_7,0);
-    return;
-  }
-  //unknown interrupt
-}
-
-
-//================[DMA Transfer Complete]=========================
-void DMA_int(void) __ctl_interrupt[DMA_VECTOR]{
-  switch(DMAIV){
-    case DMAIV_DMA0IFG:
-      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SPI_COMPLETE,0);
-    break;
-    case DMAIV_DMA1IFG:
-      ctl_events_set_clear(&DMA_events,DMA_EV_SD_SPI,0);
-    break;
-    case DMAIV_DMA2IFG:
-      ctl_events_set_clear(&DMA_events,DMA_EV_USER,0);
-    break;
-  }
-}
-
-//================[Time Tick interrupt]=========================
-void task_tick(void) __ctl_interrupt[TIMER1_A0_VECTOR]{
-  extern ticker ticker_time;
-  //set rate to 1024Hz
-  TA1CCR0+=32;
-  //update ticker time
-  ticker_time++;
-  //increment timer
-  ctl_increment_tick_from_isr();
-
-  if(async_timer){
-    async_timer--;
-    if(!async_timer){
-      ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ASYNC_TIMEOUT,0);
-    }
-  }
-  BUS_timer_timeout_check();
-}
-
-//================[I2C timeout interrupt]=========================
-void bus_resend(void) __ctl_interrupt[TIMER1_A1_VECTOR]{
-  switch(TA1IV){
-    case TA1IV_TA1CCR1:
-      //check master status to see if a command is pending
-      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_PENDING){          
-        //transmision interrupted, start again
-        //set to transmit mode
-        UCB0CTLW0|=UCTR;
-        //clear master I2C flags
-        ctl_events_set_clear(&arcBus_stat.events,0,BUS_EV_I2C_MASTER|BUS_EV_I2C_MASTER_START);
-        //set master mode
-        UCB0CTLW0|=UCMST;
-        //generate start condition
-        UCB0CTL1|=UCTXSTT;
-        //set next timeout
-        TA1CCR1+=BUS_I2C_WAIT_TIME;
-      }else{
-        //disable interrupts
-        TA1CCTL1&=~CCIE;
-      }
-    break;
-  }
-}
-
-//================[System NMI Interrupt]=========================
-void SYS_NMI(void)__ctl_interrupt[SYSNMI_VECTOR]{
-  switch(SYSSNIV){
-    //core supply voltage monitor interrupt
-    case SYSSNIV_SVMLIFG:
-      //event to report error
-      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SVML,0);
-    break;
-    //input supply voltage monitor interrupt
-    case SYSSNIV_SVMHIFG:
-      //event to report error
-      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SVMH,0);
-    break;
-    //core supply voltage monitor delay interrupt
-    case SYSSNIV_DLYLIFG:
-    break;
-    //interrupt supply voltage monitor delay interrupt
-    case SYSSNIV_DLYHIFG:
-    break;
-    //Vacant memory access interrupt
-    case SYSSNIV_VMAIFG:
-    break;
-    //JTAG mailbox in interrupt
-    case SYSSNIV_JMBINIFG:
-    break;
-    //JTAG mailbox out interrupt
-    case SYSSNIV_JMBOUTIFG:
-    break;
-    //SVMLVLRIFGSVMHVLRIFG
-    case SYSSNIV_VLRLIFG:
-      //clear interrupt flag bits
-      //unlock PMM
-      PMMCTL0_H=PMMPW_H;
-      //clear interrupt flags
-      PMMIFG&=~(SVMLIFG|SVMLVLRIFG);
-      //setup interrupt enables
-      PMMRIE|=SVMLIE|SVMHIE|SVMHVLRIE|SVMLVLRIE;
-      //lock PMM
-      PMMCTL0_H=0;
-    break;
-    //SVMHVLRIFGSVMHVLRIFG
-    case SYSSNIV_VLRHIFG:
-      //clear interrupt flag bits
-      //unlock PMM
-      PMMCTL0_H=PMMPW_H;
-      //clear interrupt flags
-      PMMIFG&=~(SVMHIFG|SVMHVLRIFG);
-      //setup interrupt enables
-      PMMRIE|=SVMLIE|SVMHIE|SVMHVLRIE|SVMLVLRIE;
-      //lock PMM
-      PMMCTL0_H=0;
-    break;
-  }
-}
-
-
-
+#include <ctl.h>
+#include <msp430.h>
+#include <stdlib.h>
+#include "timerA.h"
+#include "ARCbus.h"
+#include "spi.h"
+#include "DMA.h"
+#include "crc.h"
+
+#include "ARCbus_internal.h"
+
+//buffer for ISR command receive
+I2C_PACKET I2C_rx_buf[BUS_I2C_PACKET_QUEUE_LEN];
+//packet being received and packet being parsed
+short I2C_rx_in,I2C_rx_out;
+//queues of received packets for each class
+I2C_RX_QUEUE I2C_rx_queue[BUS_I2C_RX_NUM_CLASS];
+//commands that go in the bulk queue, one bit for each command
+unsigned char I2C_rx_bulk[256/8];
+
+//empty receive buffers and queues, must be called with interrupts disabled
+void BUS_I2C_rx_init(void){
+  int i;
+  //initialize I2C packet buffers to empty state
+  for(i=0;i<BUS_I2C_PACKET_QUEUE_LEN;i++){
+    I2C_rx_buf[i].stat=I2C_PACKET_STAT_EMPTY;
+  }
+  //initialize queues
+  for(i=0;i<BUS_I2C_RX_NUM_CLASS;i++){
+    I2C_rx_queue[i].in=I2C_rx_queue[i].out=I2C_rx_queue[i].num=0;
+  }
+  //initialize I2C packet pointers
+  I2C_rx_in=I2C_rx_out=0;
+}
+
+//find an empty buffer to receive a packet into, called from the I2C interrupt
+//returns -1 if all buffers are in use
+static short I2C_rx_find(void){
+  short i;
+  //start after the last buffer used
+  for(i=I2C_rx_in+1;i<BUS_I2C_PACKET_QUEUE_LEN;i++){
+    if(I2C_rx_buf[i].stat==I2C_PACKET_STAT_EMPTY){
+      return i;
+    }
+  }
+  for(i=0;i<=I2C_rx_in;i++){
+    if(I2C_rx_buf[i].stat==I2C_PACKET_STAT_EMPTY){
+      return i;
+    }
+  }
+  return -1;
+}
+
+//NACK a bulk packet as soon as its command byte is received if the bulk queue is full, called from the I2C interrupt
+//the sender sees the NACK and can send the packet again instead of it being dropped after it was acknowledged
+static void I2C_rx_cmd_check(void){
+  unsigned char cmd;
+  //the command is the second byte
+  if(arcBus_stat.i2c_stat.rx.idx!=2){
+    return;
+  }
+  cmd=I2C_rx_buf[I2C_rx_in].dat[1];
+  //check class and if the bulk queue has room
+  if(!(I2C_rx_bulk[cmd>>3]&(1<<(cmd&0x07))) || I2C_rx_queue[BUS_I2C_RX_BULK].num<BUS_I2C_PACKET_QUEUE_LEN-BUS_I2C_RX_CTL_RESERVED){
+    return;
+  }
+  //no room, send NACK
+  UCB0CTL1|=UCTXNACK;
+  //count dropped packet
+  arcBus_stat.i2c_stat.rx.class_drop[BUS_I2C_RX_BULK]++;
+  //free buffer, the packet is not finished when the stop is received
+  I2C_rx_buf[I2C_rx_in].stat=I2C_PACKET_STAT_EMPTY;
+  arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
+  //set flag to indicate an error
+  ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_RX_BUSY,0);
+}
+
+//finish receiving a packet and add it to the queue for its class, called from the I2C interrupt
+static void I2C_rx_done(void){
+  I2C_RX_QUEUE *q;
+  unsigned char cl;
+  short len;
+  //get packet length
+  len=arcBus_stat.i2c_stat.rx.idx;
+  //set packet length
+  I2C_rx_buf[I2C_rx_in].len=len;
+  //zero rx index
+  arcBus_stat.i2c_stat.rx.idx=0;
+  //check length and CRC, the CRC is the last byte
+  if(len>=BUS_I2C_HDR_LEN+BUS_I2C_CRC_LEN && (arcBus_stat.i2c_stat.rx.crc|1)==I2C_rx_buf[I2C_rx_in].dat[len-1]){
+    I2C_rx_buf[I2C_rx_in].crc=I2C_PACKET_CRC_GOOD;
+  }else{
+    I2C_rx_buf[I2C_rx_in].crc=I2C_PACKET_CRC_BAD;
+  }
+  //drop bad packets here unless the sender asked for a NACK
+  if(I2C_rx_buf[I2C_rx_in].crc==I2C_PACKET_CRC_BAD && (len<BUS_I2C_HDR_LEN+BUS_I2C_CRC_LEN || !(I2C_rx_buf[I2C_rx_in].dat[0]&CMD_TX_NACK))){
+    //count dropped packet
+    arcBus_stat.i2c_stat.rx.drop++;
+    //free buffer
+    I2C_rx_buf[I2C_rx_in].stat=I2C_PACKET_STAT_EMPTY;
+    return;
+  }
+  //get class from command
+  cl=(I2C_rx_bulk[I2C_rx_buf[I2C_rx_in].dat[1]>>3]&(1<<(I2C_rx_buf[I2C_rx_in].dat[1]&0x07)))?BUS_I2C_RX_BULK:BUS_I2C_RX_CTL;
+  q=&I2C_rx_queue[cl];
+  //bulk packets can't use the buffers saved for control packets
+  if(cl==BUS_I2C_RX_BULK && q->num>=BUS_I2C_PACKET_QUEUE_LEN-BUS_I2C_RX_CTL_RESERVED){
+    //count dropped packet
+    arcBus_stat.i2c_stat.rx.class_drop[cl]++;
+    //free buffer
+    I2C_rx_buf[I2C_rx_in].stat=I2C_PACKET_STAT_EMPTY;
+    //set flag to indicate an error
+    ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_RX_BUSY,0);
+    return;
+  }
+  //set buffer status to complete
+  I2C_rx_buf[I2C_rx_in].stat=I2C_PACKET_STAT_COMPLETE;
+  //add to queue
+  q->idx[q->in++]=I2C_rx_in;
+  //check for wraparound
+  if(q->in>=BUS_I2C_PACKET_QUEUE_LEN){
+    q->in=0;
+  }
+  q->num++;
+  //set flag to notify 
+  ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_CMD_RX,0);
+}
+
+//queue for master transmit packets
+I2C_TX_PACKET I2C_tx_buf[BUS_I2C_TX_QUEUE_LEN];
+//queue indexes and number of queued packets
+short I2C_tx_in,I2C_tx_out,I2C_tx_num;
+//oldest sent packet waiting for the helper task and number of sent packets waiting
+short I2C_tx_fin,I2C_tx_fin_num;
+//timeout for the current queued packet
+unsigned short I2C_tx_timer;
+
+//DMA events
+CTL_EVENT_SET_t DMA_events;
+
+//start sending the rest of the master packet with DMA2, first byte must already be written
+//called from the I2C interrupt
+static void I2C_DMA_start(void){
+  //check packet length, DMA2 must be free and not needed for SPI
+  if(arcBus_stat.i2c_stat.tx.len<BUS_I2C_DMA_MIN_LEN || arcBus_stat.spi_stat.mode!=BUS_SPI_IDLE || DMA2CTL&DMAEN){
+    return;
+  }
+  #ifdef BUS_PROFILE
+    //check if DMA is turned off to compare cycles
+    if(!BUS_prof_dma_en){
+      return;
+    }
+  #endif
+  //trigger DMA2 from UCB0 transmit
+  DMACTL1=DMA2TSEL__USCIB0TX;
+  // Source DMA address: rest of the packet
+  *((unsigned int*)&DMA2SA)=(unsigned int)(arcBus_stat.i2c_stat.tx.ptr+arcBus_stat.i2c_stat.tx.idx);
+  // Destination DMA address: the transmit buffer.
+  *((unsigned int*)&DMA2DA)=(unsigned int)(&UCB0TXBUF);
+  // The size of the block to be transferred
+  DMA2SZ=arcBus_stat.i2c_stat.tx.len-arcBus_stat.i2c_stat.tx.idx;
+  // Configure the DMA transfer, single byte transfer with source increment
+  //interrupt when the last byte is written so the stop can be sent
+  DMA2CTL=DMADT_0|DMASBDB|DMASRCINCR_3|DMADSTINCR_0|DMAIE|DMAEN;
+  //DMA is sending data
+  arcBus_stat.i2c_stat.tx.dma=1;
+  //disable transmit interrupt while DMA is running
+  UCB0IE&=~UCTXIE0;
+}
+
+//stop DMA2 and let the I2C interrupt send the rest of the packet
+//callers may clear DMAEN first, a stopped transfer keeps DMA2SZ and only a finished one sets DMAIFG
+static void I2C_DMA_abort(void){
+  //check if DMA is running
+  if(arcBus_stat.i2c_stat.tx.dma){
+    //disable DMA
+    DMA2CTL&=~DMAEN;
+    //check if the transfer finished before the DMA interrupt ran, DMA2SZ has been reloaded then
+    if(DMA2CTL&DMAIFG){
+      //last byte is in the transmit buffer
+      arcBus_stat.i2c_stat.tx.idx=arcBus_stat.i2c_stat.tx.len;
+    }else{
+      //update index from the bytes left
+      arcBus_stat.i2c_stat.tx.idx=arcBus_stat.i2c_stat.tx.len-DMA2SZ;
+    }
+    //clear DMA interrupt
+    DMA2CTL&=~(DMAIE|DMAIFG);
+    //DMA is done
+    arcBus_stat.i2c_stat.tx.dma=0;
+    //enable transmit interrupt
+    UCB0IE|=UCTXIE0;
+  }
+}
+
+//stop I2C master DMA and finish the packet from the I2C interrupt, called when SPI needs DMA2 or the packet is stopped
+void BUS_I2C_DMA_stop(void){
+  int en=ctl_global_interrupts_disable();
+  //stop DMA
+  I2C_DMA_abort();
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//=======================================================================================
+//                      [Interrupt Service Routines]
+//=======================================================================================
+
+void bus_I2C_isr(void) __ctl_interrupt[USCI_B0_VECTOR]{
+  extern ticker ticker_time;
+  extern unsigned short ticker_ta;
+  static unsigned short end_e=0;
+  unsigned short tmp;
+  short slot;
+  #ifdef BUS_PROFILE
+    unsigned short prof=BUS_PROF_TIMER;
+  #endif
+  switch(UCB0IV){
+    case USCI_I2C_UCALIFG:    //Arbitration lost
+      //catch up time before waking tasks
+      BUS_tick_resync();
+      //stop DMA, packet will be restarted
+      I2C_DMA_abort();
+      //Check if packet was in progress
+      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
+        //set index
+        arcBus_stat.i2c_stat.tx.idx=0;
+        //set I2C master state
+        arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_PENDING;
+        //set timer to attempt to send later
+        TA1CCR1=readTA1()+BUS_I2C_WAIT_TIME;
+        //setup TA1CCR1 interrupt
+        TA1CCTL1=CCIE;
+        //repeated lost arbitration can mean the bus is too fast
+        BUS_I2C_speed_err();
+      }
+      //set flag to indicate condition
+      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_ARB_LOST,0);
+      //check if running
+      if(arcBus_stat.i2c_stat.mode!=BUS_I2C_IDLE){
+        //set status to idle
+        arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
+      }
+      //reset rx buffer status if in progress
+      if(I2C_rx_buf[I2C_rx_in].stat==I2C_PACKET_STAT_IN_PROGRESS){
+        //reset packet flags
+        I2C_rx_buf[I2C_rx_in].stat=I2C_PACKET_STAT_EMPTY;
+        //decrement packet index
+      }
+    break;
+    case USCI_I2C_UCNACKIFG:    //NACK interrupt  
+      //catch up time before waking tasks
+      BUS_tick_resync();
+      //Acknowledge expected but not received  
+      //stop DMA, no more data will be sent
+      I2C_DMA_abort();
+      //generate stop condition
+      UCB0CTL1|=UCTXSTP; 
+      //check if we have written more than a byte to the TX buffer
+      //one byte is always written after the start condition is sent
+      if(arcBus_stat.i2c_stat.tx.idx>1){
+          //check if end_e is set
+          if(end_e==0){
+            //set ABORT as the end event
+            end_e=BUS_EV_I2C_ABORT;
+          }
+      }else{
+          //set NACK as end event
+          end_e=BUS_EV_I2C_NACK;
+      }
+    break;
+    case USCI_I2C_UCSTTIFG:    //start condition received
+      //check if we are master
+      if(UCB0CTLW0&UCMST){
+        //clear NACK IFG
+        UCB0IFG&=~UCNACKIFG;
+        //no processing necessary
+        break;
+      }
+      //check status
+      //This is to fix the issue where the start condition happens before the stop can be processed
+      if(arcBus_stat.i2c_stat.mode==BUS_I2C_RX){
+        //finish packet and notify
+        I2C_rx_done();
+        //set state to idle
+        arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
+      }
+      //Check if transmitting or receiving
+      if(UCB0CTL1&UCTR){   
+        //zero index
+        arcBus_stat.i2c_stat.tx.idx=0;
+        //An I2C slave should always be the receiver
+        arcBus_stat.i2c_stat.tx.ptr=NULL;
+        arcBus_stat.i2c_stat.tx.len=-1;
+        //set mode to Tx
+        arcBus_stat.i2c_stat.mode=BUS_I2C_TX;
+        //send first byte to save time
+        UCB0TXBUF=BUS_I2C_DUMMY_DATA;
+      }else{
+        //find a free buffer
+        if((slot=I2C_rx_find())<0){
+          //all buffers are in use transmit NACK
+          UCB0CTL1|=UCTXNACK;
+          //class is not known yet, count it separately
+          arcBus_stat.i2c_stat.rx.full_drop++;
+          //set flag to indicate an error
+          ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_RX_BUSY,0);
+        }else{
+          //receive into this buffer
+          I2C_rx_in=slot;
+          //setup receive status
+          arcBus_stat.i2c_stat.rx.ptr=I2C_rx_buf[I2C_rx_in].dat;
+          arcBus_stat.i2c_stat.rx.len=sizeof(I2C_rx_buf[0].dat);
+          arcBus_stat.i2c_stat.rx.idx=0;
+          arcBus_stat.i2c_stat.rx.crc=0;
+          //set mode to Rx
+          arcBus_stat.i2c_stat.mode=BUS_I2C_RX;
+          //set buffer status
+          I2C_rx_buf[I2C_rx_in].stat=I2C_PACKET_STAT_IN_PROGRESS;
+          //save time the packet started for time sync
+          I2C_rx_buf[I2C_rx_in].t_tick=ticker_time;
+          I2C_rx_buf[I2C_rx_in].t_sub=readTA1()-ticker_ta;
+          //check if this is a general call packet
+          if(UCB0STATW&UCGC){
+            //set that general call address was received 
+            I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_GC_ADDR;
+          }else{
+            //received address is not known yet
+            I2C_rx_buf[I2C_rx_in].flags=0;
+          }
+        }
+      }
+    break;
+    case USCI_I2C_UCSTPIFG:    //Stop condition received
+      //catch up time before waking tasks
+      BUS_tick_resync();
+      //check if we are master
+      if(UCB0CTLW0&UCMST){
+        //make sure DMA is stopped
+        I2C_DMA_abort();
+        //set state to idle
+        arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
+        //check if packet came from the transmit queue
+        if(arcBus_stat.i2c_stat.tx.async){
+          //save end event
+          tmp=end_e;
+          //clear saved event
+          end_e=0;
+          //finish packet and start the next one
+          BUS_I2C_tx_done(tmp);
+        }else{
+          //set saved event and clear TX self event
+          ctl_events_set_clear(&arcBus_stat.events,end_e,0);
+          //clear saved event
+          end_e=0;
+        }
+      }else{
+        //clear start condition interrupt
+        UCB0IFG&=~UCSTTIFG;
+        //check if transaction was a command
+        if(arcBus_stat.i2c_stat.mode==BUS_I2C_RX){
+          //finish packet and notify
+          I2C_rx_done();
+        }
+        //set state to idle
+        arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
+        //check master status to see if a command is pending
+        if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_PENDING){          
+          //transmision interrupted, start again
+          //set to transmit mode
+          UCB0CTLW0|=UCTR;
+          //clear master I2C flags
+          ctl_events_set_clear(&arcBus_stat.events,0,BUS_EV_I2C_MASTER|BUS_EV_I2C_MASTER_START);
+          //set master mode
+          UCB0CTLW0|=UCMST;
+          //clear saved event
+          end_e=0; 
+          //generate start condition
+          UCB0CTL1|=UCTXSTT;
+        }
+      }
+    break;
+    case USCI_I2C_UCRXIFG3:    //Slave3 RXIFG
+      //check if master transaction is in progress
+      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
+        //master transaction, nack as a slave
+        UCB0CTL1|=UCTXNACK;
+        //set send to self event
+        end_e=BUS_EV_I2C_TX_SELF;
+        break;
+      }  
+      //check buffer size
+      if(arcBus_stat.i2c_stat.rx.idx>=sizeof(I2C_rx_buf[0].dat)){
+        //receive buffer is full, send NACK
+        UCB0CTL1|=UCTXNACK;
+      }else{
+        //receive data
+        arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx++]=UCB0RXBUF;
+        //add the previous byte to the CRC, the last byte is the CRC so bytes are added one late
+        if(arcBus_stat.i2c_stat.rx.idx>1){
+          arcBus_stat.i2c_stat.rx.crc=crc7_step(arcBus_stat.i2c_stat.rx.crc,arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx-2]);
+        }
+        //check if there is room for the packet's class
+        I2C_rx_cmd_check();
+      }
+      //check if flags have been set
+      if(I2C_rx_buf[I2C_rx_in].flags==0){
+        //set flag for addr3
+        I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_ADDR3;
+      }
+    break;
+    case USCI_I2C_UCTXIFG3:    //Slave 3 TXIFG
+        //no data to send so send dummy data
+        UCB0TXBUF=BUS_I2C_DUMMY_DATA;
+    break;
+    case USCI_I2C_UCRXIFG2:    //Slave 2 RXIFG
+      //check if master transaction is in progress
+      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
+        //master transaction, nack as a slave
+        UCB0CTL1|=UCTXNACK;
+        //set send to self event
+        end_e=BUS_EV_I2C_TX_SELF;
+        break;
+      }  
+      //check buffer size
+      if(arcBus_stat.i2c_stat.rx.idx>=sizeof(I2C_rx_buf[0].dat)){
+        //receive buffer is full, send NACK
+        UCB0CTL1|=UCTXNACK;
+      }else{
+        //receive data
+        arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx++]=UCB0RXBUF;
+        //add the previous byte to the CRC, the last byte is the CRC so bytes are added one late
+        if(arcBus_stat.i2c_stat.rx.idx>1){
+          arcBus_stat.i2c_stat.rx.crc=crc7_step(arcBus_stat.i2c_stat.rx.crc,arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx-2]);
+        }
+        //check if there is room for the packet's class
+        I2C_rx_cmd_check();
+      }
+      //check if flags have been set
+      if(I2C_rx_buf[I2C_rx_in].flags==0){
+        //set flag for addr2
+        I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_ADDR2;
+      }
+    break;
+    case USCI_I2C_UCTXIFG2:    //Slave 2 TXIFG
+        //no data to send so send dummy data
+        UCB0TXBUF=BUS_I2C_DUMMY_DATA;
+    break;
+    case USCI_I2C_UCRXIFG1:    //Slave 1 RXIFG
+      //check if master transaction is in progress
+      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
+        //master transaction, nack as a slave
+        UCB0CTL1|=UCTXNACK;
+        //set send to self event
+        end_e=BUS_EV_I2C_TX_SELF;
+        break;
+      }  
+      //check buffer size
+      if(arcBus_stat.i2c_stat.rx.idx>=sizeof(I2C_rx_buf[0].dat)){
+        //receive buffer is full, send NACK
+        UCB0CTL1|=UCTXNACK;
+      }else{
+        //receive data
+        arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx++]=UCB0RXBUF;
+        //add the previous byte to the CRC, the last byte is the CRC so bytes are added one late
+        if(arcBus_stat.i2c_stat.rx.idx>1){
+          arcBus_stat.i2c_stat.rx.crc=crc7_step(arcBus_stat.i2c_stat.rx.crc,arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx-2]);
+        }
+        //check if there is room for the packet's class
+        I2C_rx_cmd_check();
+      }
+      //check if flags have been set
+      if(I2C_rx_buf[I2C_rx_in].flags==0){
+        //set flag for addr1
+        I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_ADDR1;
+      }
+    break;
+    case USCI_I2C_UCTXIFG1:    //Slave 1 TXIFG
+    break;
+    case USCI_I2C_UCRXIFG0:    //Data receive in master mode and Slave 0 RXIFG
+      //check if master transaction is in progress
+      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_IN_PROGRESS){
+        //master transaction, nack as a slave
+        UCB0CTL1|=UCTXNACK;
+        //set send to self event
+        end_e=BUS_EV_I2C_TX_SELF;
+        break;
+      }  
+      //check buffer size
+      if(arcBus_stat.i2c_stat.rx.idx>=sizeof(I2C_rx_buf[0].dat)){
+        //receive buffer is full, send NACK
+        UCB0CTL1|=UCTXNACK;
+      }else{
+        //receive data
+        arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx++]=UCB0RXBUF;
+        //add the previous byte to the CRC, the last byte is the CRC so bytes are added one late
+        if(arcBus_stat.i2c_stat.rx.idx>1){
+          arcBus_stat.i2c_stat.rx.crc=crc7_step(arcBus_stat.i2c_stat.rx.crc,arcBus_stat.i2c_stat.rx.ptr[arcBus_stat.i2c_stat.rx.idx-2]);
+        }
+        //check if there is room for the packet's class
+        I2C_rx_cmd_check();
+      }
+      //check if flags have been set
+      if(I2C_rx_buf[I2C_rx_in].flags==0){
+        //set flag for addr0
+        I2C_rx_buf[I2C_rx_in].flags=CMD_PARSE_ADDR0;
+      }
+    break;
+    case USCI_I2C_UCTXIFG0:    //Data transmit in master mode and Slave 0 TXIFG
+      //check master status 
+      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_PENDING){
+        //set I2C master state
+        arcBus_stat.i2c_stat.tx.stat=BUS_I2C_MASTER_IN_PROGRESS;
+        //set state to tx
+        arcBus_stat.i2c_stat.mode=BUS_I2C_TX;
+        //stamp time sync packets once the start condition is on the bus, restarts after lost arbitration and queued packets are stamped here too
+        if(UCB0CTLW0&UCMST && arcBus_stat.i2c_stat.tx.idx==0 && arcBus_stat.i2c_stat.tx.ptr[1]==CMD_SUB_STAT && arcBus_stat.i2c_stat.tx.len==BUS_I2C_HDR_LEN+BUS_SUB_STAT_LEN+BUS_I2C_CRC_LEN){
+          //packet buffers passed to BUS_cmd_tx and the queue buffers are writable
+          BUS_time_stamp((unsigned char*)arcBus_stat.i2c_stat.tx.ptr+BUS_I2C_HDR_LEN);
+          //calculate new CRC
+          ((unsigned char*)arcBus_stat.i2c_stat.tx.ptr)[BUS_I2C_HDR_LEN+BUS_SUB_STAT_LEN]=crc7(arcBus_stat.i2c_stat.tx.ptr,BUS_I2C_HDR_LEN+BUS_SUB_STAT_LEN);
+        }
+        //queued packets have no task waiting for the start
+        if(!arcBus_stat.i2c_stat.tx.async){
+          //catch up time before waking the task
+          BUS_tick_resync();
+          //set flag to notify 
+          ctl_events_set_clear(&arcBus_stat.events,BUS_EV_I2C_MASTER_STARTED,0);
+        }
+      }
+      //check if there are more bytes
+      if(arcBus_stat.i2c_stat.tx.len>arcBus_stat.i2c_stat.tx.idx){
+        //transmit data
+        UCB0TXBUF=arcBus_stat.i2c_stat.tx.ptr[arcBus_stat.i2c_stat.tx.idx++];
+        //use DMA for the rest of the packet after the first byte
+        if(arcBus_stat.i2c_stat.tx.idx==1 && UCB0CTLW0&UCMST){
+          I2C_DMA_start();
+        }
+      }else{//nothing left to send
+        if(!(UCB0CTLW0&UCMST)){//slave mode
+          //no more data to send so send dummy data
+          UCB0TXBUF=BUS_I2C_DUMMY_DATA;
+        }else{//Master Mode
+          //generate stop condition
+          UCB0CTL1|=UCTXSTP;
+          //set end event
+          end_e=BUS_EV_I2C_COMPLETE;
+          //set state to idle
+          arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
+        }
+      }
+    break;
+    case USCI_I2C_UCCLTOIFG:    //Cock low timeout
+      //catch up time before waking tasks
+      BUS_tick_resync();
+      //check if master or slave
+      if(UCB0CTLW0&UCMST){
+        //stop DMA, no more data will be sent
+        I2C_DMA_abort();
+        //master mode, generate stop condition
+        UCB0CTL1|=UCTXSTP;
+        //set end event
+        end_e=ERR_I2C_CLL;
+      }else{
+        //slave mode, send NACK
+        UCB0CTL1|=UCTXNACK;
+      }
+      //set event
+      ctl_events_set_clear(&arcBus_stat.events,BUS_EV_I2C_ERR_CCL,0);
+    break;
+    case USCI_I2C_UCBIT9IFG:    //9th bit interrupt
+    break;
+  }
+  #ifdef BUS_PROFILE
+    //count cycles spent in the interrupt
+    BUS_prof_add(BUS_PROF_I2C_ISR,BUS_PROF_TIMER-prof);
+  #endif
+}
+
+
+
+//=================[SPI handler]=============================
+void bus_SPI_isr(void) __ctl_interrupt[USCI_A0_VECTOR]{
+  int tmp;
+  //DUMMY ISR, not used
+  tmp=UCA0IV;
+}
+
+//=================[Port pin Handler]=============================
+void bus_int(void) __ctl_interrupt[PORT2_VECTOR]{
+  //catch up time before waking tasks
+  BUS_tick_resync();
+  switch(P2IV){
+    case P1IV_P1IFG0:
+      //set events for flags
+      ctl_events_set_clear(&SUB_events,SUB_EV_INT_0,0);
+    return;
+    case P1IV_P1IFG1:
+      //set events for flags
+      ctl_events_set_clear(&SUB_events,SUB_EV_INT_1,0);
+    return;
+    case P1IV_P1IFG2:
+      //set events for flags
+      ctl_events_set_clear(&SUB_events,SUB_EV_INT_2,0);
+    return;
+    case P1IV_P1IFG3:
+      //set events for flags
+      ctl_events_set_clear(&SUB_events,SUB_EV_INT_3,0);
+    return;
+    case P1IV_P1IFG4:
+      //set events for flags
+      ctl_events_set_clear(&SUB_events,SUB_EV_INT_4,0);
+    return;
+    case P1IV_P1IFG5:
+      //set events for flags
+      ctl_events_set_clear(&SUB_events,SUB_EV_INT_5,0);
+    return;
+    case P1IV_P1IFG6:
+      //set events for flags
+      ctl_events_set_clear(&SUB_events,SUB_EV_INT_6,0);
+    return;
+    case P1IV_P1IFG7:
+      //set events for flags
+      ctl_events_set_clear(&SUB_events,SUB_EV_INT_7,0);
+    return;
+  }
+  //unknown interrupt
+}
+
+
+//================[DMA Transfer Complete]=========================
+void DMA_int(void) __ctl_interrupt[DMA_VECTOR]{
+  #ifdef BUS_PROFILE
+    unsigned short prof=BUS_PROF_TIMER;
+  #endif
+  //catch up time before waking tasks
+  BUS_tick_resync();
+  switch(DMAIV){
+    case DMAIV_DMA0IFG:
+      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SPI_COMPLETE,0);
+    break;
+    case DMAIV_DMA1IFG:
+      ctl_events_set_clear(&DMA_events,DMA_EV_SD_SPI,0);
+    break;
+    case DMAIV_DMA2IFG:
+      //check if DMA2 was sending an I2C packet
+      if(arcBus_stat.i2c_stat.tx.dma){
+        //last byte is in the transmit buffer
+        arcBus_stat.i2c_stat.tx.idx=arcBus_stat.i2c_stat.tx.len;
+        //DMA is done
+        arcBus_stat.i2c_stat.tx.dma=0;
+        //disable DMA interrupt
+        DMA2CTL&=~DMAIE;
+        //enable transmit interrupt so stop is sent after the last byte
+        UCB0IE|=UCTXIE0;
+      }else{
+        ctl_events_set_clear(&DMA_events,DMA_EV_USER,0);
+      }
+    break;
+  }
+  #ifdef BUS_PROFILE
+    //count cycles spent in the interrupt
+    BUS_prof_add(BUS_PROF_DMA_ISR,BUS_PROF_TIMER-prof);
+  #endif
+}
+
+//================[Time Tick interrupt]=========================
+//set when tickless idle is enabled
+static unsigned char tickless_en=0;
+//set while TA1CCR0 is programmed past the next tick
+static unsigned char tick_skip=0;
+//number of tick interrupts, used to measure wakeups
+static unsigned long tick_wakeups=0;
+
+//advance time by n ticks, ta is the timer count of the last tick. called with interrupts disabled
+static void tick_advance(unsigned short n,unsigned short ta){
+  extern ticker ticker_time;
+  extern unsigned long long ticker_mono;
+  extern unsigned short ticker_ta;
+  extern volatile unsigned short ticker_seq;
+  //time is changing, readers try again
+  ticker_seq++;
+  //save timer count for this tick
+  ticker_ta=ta;
+  //update ticker time
+  ticker_time+=n;
+  //update time since startup
+  ticker_mono+=n;
+  //done changing time
+  ticker_seq++;
+  //increment timer by the number of ticks
+  ctl_time_increment=n;
+  ctl_increment_tick_from_isr();
+  ctl_time_increment=1;
+
+  if(async_timer){
+    if(async_timer<=n){
+      async_timer=0;
+      ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ASYNC_TIMEOUT,0);
+    }else{
+      async_timer-=n;
+    }
+  }
+  //check for queued I2C packet timeout
+  if(I2C_tx_timer){
+    if(I2C_tx_timer<=n){
+      I2C_tx_timer=0;
+      BUS_I2C_tx_timeout();
+    }else{
+      I2C_tx_timer-=n;
+    }
+  }
+  BUS_timer_timeout_check();
+}
+
+void task_tick(void) __ctl_interrupt[TIMER1_A0_VECTOR]{
+  extern unsigned short ticker_ta;
+  unsigned short n=1,ta=TA1CCR0;
+  //count wakeup
+  tick_wakeups++;
+  //get number of ticks skipped while idle, the interrupt comes early if BUS_tick_resync was called
+  if(tick_skip){
+    n=(unsigned short)(readTA1()-ticker_ta)/32;
+    ta=ticker_ta+n*32;
+    tick_skip=0;
+  }
+  //update time
+  if(n){
+    tick_advance(n,ta);
+  }
+  //set rate to 1024Hz, one count more or less to slew the time
+  TA1CCR0=ticker_ta+32+BUS_time_slew_step(n);
+  //check if the timer passed the next tick before it was set
+  if((short)(TA1CCR0-readTA1())<=0){
+    //tick now
+    TA1CCTL0|=CCIFG;
+  }
+}
+
+//catch up time skipped while idle and go back to ticking at 1024Hz
+//the tick interrupt is run now so time is updated and woken tasks are scheduled the same way as a normal tick
+//ctl_get_current_time lags while ticks are skipped, ARClib calls this in the idle loop, in its tasks and in its interrupts that wake tasks
+//other interrupts that wake tasks should call this before setting events
+void BUS_tick_resync(void){
+  int en;
+  //nothing to do if ticks are not being skipped
+  if(!tick_skip){
+    return;
+  }
+  en=ctl_global_interrupts_disable();
+  //check again now that interrupts are disabled so a tick that just happened is not repeated
+  if(tick_skip){
+    //tick now
+    TA1CCTL0|=CCIFG;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//program TA1CCR0 for the next deadline if tickless idle is enabled and go to low power mode, called from the idle task
+void BUS_tick_sleep(void){
+  extern ticker ticker_time;
+  extern unsigned short ticker_ta;
+  CTL_TIME_t d;
+  ticker a;
+  //check if tickless idle is enabled
+  if(!tickless_en){
+    //go to low power mode
+    LPM0;
+    return;
+  }
+  ctl_global_interrupts_disable();
+  //get ticks until the next task timeout, zero if no task is waiting with a timeout
+  //timeouts that are due were handled by the tick that made them due so zero means sleep as long as possible
+  d=ctl_get_sleep_delay();
+  //limit sleep to what the timer can count
+  if(d==0 || d>BUS_TICKLESS_MAX){
+    d=BUS_TICKLESS_MAX;
+  }
+  //check async timer
+  if(async_timer && async_timer<d){
+    d=async_timer;
+  }
+  //check queued I2C packet timer
+  if(I2C_tx_timer && I2C_tx_timer<d){
+    d=I2C_tx_timer;
+  }
+  //check alarms
+  a=BUS_alarm_next(ticker_time);
+  if(a && a<d){
+    d=a;
+  }
+  //only skip if more than one tick and there is time to set the timer before the next tick
+  if(!tick_skip && d>1 && (short)(ticker_ta+32-readTA1())>BUS_TICKLESS_MARGIN){
+    //set timer for the deadline
+    TA1CCR0=ticker_ta+d*32;
+    tick_skip=1;
+  }
+  //enable interrupts and go to low power mode in one instruction
+  //an interrupt that came in after the deadline was found runs once GIE is set and wakes the CPU instead of being missed
+  __bis_SR_register(LPM0_bits|GIE);
+}
+
+//enable or disable tickless idle
+void BUS_tickless(int en){
+  tickless_en=(en!=0);
+  //go back to normal ticks when disabled
+  if(!en){
+    BUS_tick_resync();
+  }
+}
+
+//get number of tick interrupts since startup, used to measure wakeups per second
+unsigned long BUS_tick_wakeups(void){
+  unsigned long tmp;
+  int en=ctl_global_interrupts_disable();
+  tmp=tick_wakeups;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return tmp;
+}
+
+//================[I2C timeout and delay interrupt]=========================
+void bus_resend(void) __ctl_interrupt[TIMER1_A1_VECTOR]{
+  switch(TA1IV){
+    case TA1IV_TA1CCR1:
+      //check master status to see if a command is pending
+      if(arcBus_stat.i2c_stat.tx.stat==BUS_I2C_MASTER_PENDING){          
+        //transmision interrupted, start again
+        //set to transmit mode
+        UCB0CTLW0|=UCTR;
+        //clear master I2C flags
+        ctl_events_set_clear(&arcBus_stat.events,0,BUS_EV_I2C_MASTER|BUS_EV_I2C_MASTER_START);
+        //set master mode
+        UCB0CTLW0|=UCMST;
+        //generate start condition
+        UCB0CTL1|=UCTXSTT;
+        //set next timeout
+        TA1CCR1+=BUS_I2C_WAIT_TIME;
+      }else{
+        //disable interrupts
+        TA1CCTL1&=~CCIE;
+      }
+    break;
+    case TA1IV_TA1CCR2:
+      //delay done, disable interrupt
+      TA1CCTL2&=~CCIE;
+      //catch up time before waking the task
+      BUS_tick_resync();
+      //wake waiting task
+      ctl_events_set_clear(&BUS_delay_events,BUS_DELAY_EV_DONE,0);
+    break;
+  }
+}
+
+//================[System NMI Interrupt]=========================
+void SYS_NMI(void)__ctl_interrupt[SYSNMI_VECTOR]{
+  //catch up time before waking tasks
+  BUS_tick_resync();
+  switch(SYSSNIV){
+    //core supply voltage monitor interrupt
+    case SYSSNIV_SVMLIFG:
+      //event to report error
+      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SVML,0);
+    break;
+    //input supply voltage monitor interrupt
+    case SYSSNIV_SVMHIFG:
+      //event to report error
+      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SVMH,0);
+    break;
+    //core supply voltage monitor delay interrupt
+    case SYSSNIV_DLYLIFG:
+    break;
+    //interrupt supply voltage monitor delay interrupt
+    case SYSSNIV_DLYHIFG:
+    break;
+    //Vacant memory access interrupt
+    case SYSSNIV_VMAIFG:
+    break;
+    //JTAG mailbox in interrupt
+    case SYSSNIV_JMBINIFG:
+    break;
+    //JTAG mailbox out interrupt
+    case SYSSNIV_JMBOUTIFG:
+    break;
+    //SVMLVLRIFGSVMHVLRIFG
+    case SYSSNIV_VLRLIFG:
+      //clear interrupt flag bits
+      //unlock PMM
+      PMMCTL0_H=PMMPW_H;
+      //clear interrupt flags
+      PMMIFG&=~(SVMLIFG|SVMLVLRIFG);
+      //setup interrupt enables
+      PMMRIE|=SVMLIE|SVMHIE|SVMHVLRIE|SVMLVLRIE;
+      //lock PMM
+      PMMCTL0_H=0;
+    break;
+    //SVMHVLRIFGSVMHVLRIFG
+    case SYSSNIV_VLRHIFG:
+      //clear interrupt flag bits
+      //unlock PMM
+      PMMCTL0_H=PMMPW_H;
+      //clear interrupt flags
+      PMMIFG&=~(SVMHIFG|SVMHVLRIFG);
+      //setup interrupt enables
+      PMMRIE|=SVMLIE|SVMHIE|SVMHVLRIE|SVMLVLRIE;
+      //lock PMM
+      PMMCTL0_H=0;
+    break;
+  }
+}
+
+
+
@@ -5,22 +5,199 @@
 #include "ARCbus.h"
 #include "ARCbus_internal.h"
 
-typedef struct{
-    ticker time;
-    CTL_EVENT_SET_t *e;
-    CTL_EVENT_SET_t event;
-}ALARM_DAT;
-
 #define     ALARM_MAX_UPDATE_DIFF       (5*60*1024)
 
-ALARM_DAT alarms[BUS_NUM_ALARMS];
+//heap of armed alarms, the next alarm to expire is at the top
+static BUS_ALARM *alarm_heap[BUS_ALARM_MAX];
+//number of alarms in the heap
+static short alarm_num=0;
+
+//alarms used for the numbered alarm functions
+static BUS_ALARM alarms[BUS_NUM_ALARMS];
+
+extern ticker ticker_time;
+
+//check if alarm a expires before alarm b, times are compared as a signed difference so the ticker can wrap
+static int alarm_before(const BUS_ALARM *a,const BUS_ALARM *b){
+    return (long)(a->time-b->time)<0;
+}
+
+//put an alarm at idx in the heap
+static void alarm_place(BUS_ALARM *a,short idx){
+    alarm_heap[idx]=a;
+    a->pos=idx+1;
+}
+
+//move an alarm up the heap until its parent expires first
+static void alarm_sift_up(short idx){
+    BUS_ALARM *a=alarm_heap[idx];
+    short parent;
+    while(idx>0){
+        parent=(idx-1)/2;
+        //stop if the parent expires first
+        if(!alarm_before(a,alarm_heap[parent])){
+            break;
+        }
+        //move parent down
+        alarm_place(alarm_heap[parent],idx);
+        idx=parent;
+    }
+    alarm_place(a,idx);
+}
+
+//move an alarm down the heap until its children expire after it
+static void alarm_sift_down(short idx){
+    BUS_ALARM *a=alarm_heap[idx];
+    short child;
+    for(;;){
+        child=2*idx+1;
+        //check if there are children
+        if(child>=alarm_num){
+            break;
+        }
+        //use the child that expires first
+        if(child+1<alarm_num && alarm_before(alarm_heap[child+1],alarm_heap[child])){
+            child++;
+        }
+        //stop if the alarm expires first
+        if(!alarm_before(alarm_heap[child],a)){
+            break;
+        }
+        //move child up
+        alarm_place(alarm_heap[child],idx);
+        idx=child;
+    }
+    alarm_place(a,idx);
+}
+
+//take an alarm out of the heap, called with interrupts disabled
+static void alarm_remove(BUS_ALARM *a){
+    short idx=a->pos-1;
+    BUS_ALARM *last;
+    //alarm is no longer in the heap
+    a->pos=0;
+    //take the last alarm off the heap
+    last=alarm_heap[--alarm_num];
+    //done if the removed alarm was the last one
+    if(last==a){
+        return;
+    }
+    //put the last alarm where the removed alarm was and fix the heap
+    alarm_place(last,idx);
+    if(idx>0 && alarm_before(last,alarm_heap[(idx-1)/2])){
+        alarm_sift_up(idx);
+    }else{
+        alarm_sift_down(idx);
+    }
+}
+
+//trigger alarms that have expired, returns the number of alarms triggered
+//called with interrupts disabled
+static unsigned short alarm_expire(void){
+    BUS_ALARM *a;
+    unsigned short count=0;
+    //check the alarm at the top of the heap
+    while(alarm_num>0 && (long)(alarm_heap[0]->time-ticker_time)<=0){
+        a=alarm_heap[0];
+        //time elapsed, trigger event
+        ctl_events_set_clear(a->e,a->event,0);
+        count++;
+        if(a->period){
+            //periodic alarm, set the next time
+            a->time+=a->period;
+            //skip periods that were missed
+            if((long)(a->time-ticker_time)<=0){
+                a->time=ticker_time+a->period;
+            }
+            //alarm is still at the top, move it down
+            alarm_sift_down(0);
+        }else{
+            //free alarm once triggered
+            alarm_remove(a);
+        }
+    }
+    return count;
+}
+
+//setup an alarm to give an event, the alarm must not be armed
+void BUS_alarm_init(BUS_ALARM *a,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event){
+    a->time=0;
+    a->period=0;
+    a->e=e;
+    a->event=event;
+    a->pos=0;
+}
+
+//arm an alarm to go off at the given time, then every period ticks if period is not zero
+//the alarm is restarted if it is already armed
+int BUS_alarm_at(BUS_ALARM *a,ticker time,ticker period){
+    int en;
+    //check event
+    if(a->e==NULL || a->event==0){
+        return ERR_INVALID_ARGUMENT;
+    }
+    en=ctl_global_interrupts_disable();
+    //take the alarm out of the heap if it is armed
+    if(a->pos){
+        alarm_remove(a);
+    }
+    //check if there is room
+    if(alarm_num>=BUS_ALARM_MAX){
+        if(en){
+            ctl_global_interrupts_enable();
+        }
+        return ERR_BUSY;
+    }
+    //set time
+    a->time=time;
+    a->period=period;
+    //add to the bottom of the heap and move it up
+    alarm_place(a,alarm_num++);
+    alarm_sift_up(a->pos-1);
+    if(en){
+        ctl_global_interrupts_enable();
+    }
+    return RET_SUCCESS;
+}
+
+//arm an alarm to go off in delay ticks, then every period ticks if period is not zero
+int BUS_alarm_in(BUS_ALARM *a,ticker delay,ticker period){
+    //time is read with interrupts masked so a tick can't happen before the alarm is armed
+    int en=ctl_global_interrupts_disable();
+    int ret=BUS_alarm_at(a,ticker_time+delay,period);
+    if(en){
+        ctl_global_interrupts_enable();
+    }
+    return ret;
+}
+
+//stop an alarm, returns ERR_BUSY if the alarm was not armed
+int BUS_alarm_cancel(BUS_ALARM *a){
+    int ret=RET_SUCCESS;
+    int en=ctl_global_interrupts_disable();
+    if(a->pos){
+        alarm_remove(a);
+    }else{
+        //already expired or never armed
+        ret=ERR_BUSY;
+    }
+    if(en){
+        ctl_global_interrupts_enable();
+    }
+    return ret;
+}
+
+//check if an alarm is armed
+int BUS_alarm_armed(const BUS_ALARM *a){
+    return a->pos!=0;
+}
 
 int BUS_alarm_is_free(unsigned char num){
     if(num>=BUS_NUM_ALARMS){
         return ERR_INVALID_ARGUMENT;
     }
-    //check event
-    if(alarms[num].e!=NULL || alarms[num].event!=0){
+    //check if alarm is armed
+    if(BUS_alarm_armed(&alarms[num])){
         return ERR_BUSY;
     }
     //timer not in use
@@ -31,8 +208,8 @@ ticker BUS_get_alarm_time(unsigned char num){
     if(num>=BUS_NUM_ALARMS){
         return 0;
     }
-    //check event
-    if(alarms[num].e!=NULL || alarms[num].event!=0){
+    //check if alarm is armed
+    if(BUS_alarm_armed(&alarms[num])){
         return alarms[num].time;
     }
     //timer not in use
@@ -41,23 +218,16 @@ ticker BUS_get_alarm_time(unsigned char num){
 
 int BUS_set_alarm(unsigned char num,ticker time,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event){
     int ret;
-    int en;
     //check if alarm is busy
     ret=BUS_alarm_is_free(num);
     if(ret!=RET_SUCCESS){
         //alarm busy, return error
         return ret;
     }
-    en=ctl_global_interrupts_disable();
-    //set time
-    alarms[num].time=time;
     //set event
-    alarms[num].e=e;
-    alarms[num].event=event;
-    if(en){
-        ctl_global_interrupts_enable();
-    }
-    return RET_SUCCESS;
+    BUS_alarm_init(&alarms[num],e,event);
+    //set time
+    return BUS_alarm_at(&alarms[num],time,0);
 }
 
 void BUS_free_alarm(unsigned char num){
@@ -65,29 +235,36 @@ void BUS_free_alarm(unsigned char num){
         return;
     }
     //free timer
-    alarms[num].e=0;
-    alarms[num].event=NULL;
+    BUS_alarm_cancel(&alarms[num]);
 }
 
-//called from timer ISR
+//called from timer ISR, only the top of the heap is checked
 void BUS_timer_timeout_check(void){
-    extern ticker ticker_time;
-    int i;
-    //loop through all inputs
-    for(i=0;i<BUS_NUM_ALARMS;i++){
-        //check for timeout
-        if(alarms[i].e!=NULL && alarms[i].event!=0 && alarms[i].time==ticker_time){
-            //time elapsed, trigger event
-            ctl_events_set_clear(alarms[i].e,alarms[i].event,0);
-            //free alarm once triggered
-            BUS_free_alarm(i);
-        }
+    alarm_expire();
+}
+
+//get ticks from now until the next alarm, 0 if no alarms are set
+//called with interrupts disabled
+ticker BUS_alarm_next(ticker now){
+    long d;
+    //check for alarms
+    if(alarm_num==0){
+        return 0;
+    }
+    //get time until the next alarm
+    d=alarm_heap[0]->time-now;
+    //alarm is due now
+    if(d<=0){
+        return 1;
     }
+    return d;
 }
 
 void BUS_alarm_ticker_update(ticker newt,ticker oldt){
     ticker diff;
-    int i;
+    unsigned short count;
+    int en;
+    short i;
     //check time difference
     if(newt==oldt){
         //nothing to do
@@ -99,23 +276,29 @@ void BUS_alarm_ticker_update(ticker newt,ticker oldt){
             //time went forwards
             report_error(ERR_LEV_INFO,BUS_ERR_SRC_ALARMS,ALARMS_FWD_TIME_UPDATE,diff);
             //trigger alarms that were skipped over
-            //loop through all alarms
-            for(i=0;i<BUS_NUM_ALARMS;i++){
-                //check if time was updated over timeout time
-                if(alarms[i].e!=NULL && alarms[i].event!=0 && (alarms[i].time-oldt<=diff)){
-                    //time elapsed, trigger event
-                    ctl_events_set_clear(alarms[i].e,alarms[i].event,0);
-                    //free alarm once triggered
-                    BUS_free_alarm(i);
-                    //Generate debug message 
-                    report_error(ERR_LEV_INFO,BUS_ERR_SRC_ALARMS,ALARMS_ADJ_TRIGGER,i);
-                }
-            } 
+            en=ctl_global_interrupts_disable();
+            count=alarm_expire();
+            if(en){
+                ctl_global_interrupts_enable();
+            }
+            //Generate debug message
+            if(count){
+                report_error(ERR_LEV_INFO,BUS_ERR_SRC_ALARMS,ALARMS_ADJ_TRIGGER_COUNT,count);
+            }
         }else{
             //newt<oldt
             diff=oldt-newt;
             //check if times are close
             if(diff>ALARM_MAX_UPDATE_DIFF){
+                //keep alarms the same number of ticks from now so they don't all trigger
+                //all alarms move by the same amount so the heap order does not change
+                en=ctl_global_interrupts_disable();
+                for(i=0;i<alarm_num;i++){
+                    alarm_heap[i]->time+=newt-oldt;
+                }
+                if(en){
+                    ctl_global_interrupts_enable();
+                }
                 //check if difference is large
                 if(diff>USHRT_MAX){
                     if(newt-oldt<USHRT_MAX){
@@ -129,10 +312,9 @@ void BUS_alarm_ticker_update(ticker newt,ticker oldt){
                 //don't trigger alarms
                 return;
             }
-            //time went backwards 
+            //time went backwards, alarms go off at the same time so they are late
             report_error(ERR_LEV_INFO,BUS_ERR_SRC_ALARMS,ALARMS_REV_TIME_UPDATE,diff);
-            //TODO: trigger alarms?
         }
-    }   
+    }
 }
 
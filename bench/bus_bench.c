@@ -0,0 +1,245 @@
+//ARClib benchmarks, runs on a board with the library built with BUS_PROFILE defined
+//needs a second board running ARClib at BENCH_ADDR, results are printed with printf
+#include <msp430.h>
+#include <ctl.h>
+#include <stdio.h>
+#include <string.h>
+#include <ARCbus.h>
+#include <crc.h>
+#include <compress.h>
+
+//address of this board
+#define BENCH_OWN_ADDR      BUS_ADDR_IMG
+//address of the board to send packets to
+#define BENCH_ADDR          BUS_ADDR_CDH
+//number of times each test is run
+#define BENCH_NUM           100
+//commands used for dispatch timing
+#define BENCH_CMD_LIST      200
+#define BENCH_CMD_TABLE     201
+//number of callbacks in the list before the one that handles BENCH_CMD_LIST
+#define BENCH_LIST_DUMMY    4
+
+//benchmark task
+static CTL_TASK_t bench_task;
+//stack for benchmark task
+static unsigned bench_stack[600];
+
+//I2C master interrupt cycles per packet with and without DMA
+static void bench_i2c(void){
+  unsigned char buf[BUS_I2C_HDR_LEN+BUS_I2C_MAX_PACKET_LEN+BUS_I2C_CRC_LEN],*ptr;
+  //payload lengths to test
+  static const unsigned short lens[]={4,14,BUS_I2C_MAX_PACKET_LEN};
+  BUS_PROF_STAT i2c,dma;
+  unsigned short sent;
+  int dma_en,i,j,resp;
+  printf("I2C master packets to 0x%02X\r\n",BENCH_ADDR);
+  for(dma_en=0;dma_en<2;dma_en++){
+    //use DMA or the interrupt for each byte
+    BUS_prof_i2c_dma(dma_en);
+    for(j=0;j<sizeof(lens)/sizeof(lens[0]);j++){
+      //clear stats
+      BUS_prof_clear();
+      for(i=0,sent=0;i<BENCH_NUM;i++){
+        //setup ping with dummy payload
+        ptr=BUS_cmd_init(buf,CMD_PING);
+        memset(ptr,i,lens[j]);
+        //send packet
+        resp=BUS_cmd_tx(BENCH_ADDR,buf,lens[j],0);
+        //count successful packets
+        if(resp==RET_SUCCESS){
+          sent++;
+        }
+      }
+      //get stats
+      BUS_prof_get(BUS_PROF_I2C_ISR,&i2c);
+      BUS_prof_get(BUS_PROF_DMA_ISR,&dma);
+      //check that packets were sent
+      if(sent==0){
+        printf("  no packets sent\r\n");
+        continue;
+      }
+      //cycles per packet includes received packets from the other board
+      printf("  %s %2u bytes : %u packets, %lu I2C + %lu DMA cycles per packet\r\n",dma_en?"DMA ":"ISR ",lens[j],sent,i2c.total/sent,dma.total/sent);
+    }
+  }
+  //back to normal
+  BUS_prof_i2c_dma(1);
+}
+
+//callback that handles no commands, stands in for other subsystem callbacks
+static int bench_dummy_cb(unsigned char src,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char flags){
+  return ERR_UNKNOWN_CMD;
+}
+
+//callback at the end of the list that handles BENCH_CMD_LIST
+static int bench_list_cb(unsigned char src,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char flags){
+  if(cmd==BENCH_CMD_LIST){
+    return RET_SUCCESS;
+  }
+  return ERR_UNKNOWN_CMD;
+}
+
+//handler registered for BENCH_CMD_TABLE
+static int bench_table_cb(unsigned char src,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char flags){
+  return RET_SUCCESS;
+}
+
+//callback list entries
+static CMD_PARSE_DAT bench_dummy[BENCH_LIST_DUMMY],bench_list={bench_list_cb,CMD_PARSE_ADDR0,0,NULL};
+
+//cycles to dispatch a command with the callback list and with a registered handler
+static void bench_parse(void){
+  static const unsigned char cmds[]={BENCH_CMD_LIST,BENCH_CMD_TABLE};
+  unsigned char dat[4]={0};
+  BUS_PROF_STAT st;
+  int i,j;
+  //add callbacks to the list, the handling callback has the lowest priority so it is checked last
+  for(i=0;i<BENCH_LIST_DUMMY;i++){
+    bench_dummy[i].cb=bench_dummy_cb;
+    bench_dummy[i].flags=CMD_PARSE_ADDR0;
+    bench_dummy[i].priority=10;
+    BUS_register_cmd_callback(&bench_dummy[i]);
+  }
+  BUS_register_cmd_callback(&bench_list);
+  //register handler
+  BUS_register_cmd_handler(BENCH_CMD_TABLE,CMD_PARSE_ADDR0,bench_table_cb);
+  printf("Command dispatch, %u other callbacks in the list\r\n",BENCH_LIST_DUMMY);
+  for(j=0;j<sizeof(cmds)/sizeof(cmds[0]);j++){
+    //clear stats
+    BUS_prof_clear();
+    for(i=0;i<BENCH_NUM;i++){
+      if(BUS_prof_parse(BENCH_ADDR,cmds[j],dat,sizeof(dat),CMD_PARSE_ADDR0)!=RET_SUCCESS){
+        printf("  command %u not handled\r\n",cmds[j]);
+        break;
+      }
+    }
+    //get stats
+    BUS_prof_get(BUS_PROF_CMD_PARSE,&st);
+    if(st.count==0){
+      continue;
+    }
+    printf("  %s : %lu cycles average, %u max\r\n",cmds[j]==BENCH_CMD_LIST?"list   ":"handler",st.total/st.count,st.max);
+  }
+}
+
+//buffer for CRC timing, one extra byte so an odd address can be used
+static unsigned char bench_buf[1024+2];
+
+//CRC cycles per KB with DMA and from the CPU, and the longest time interrupts are disabled for DMA
+static void bench_crc(void){
+  BUS_PROF_STAT st;
+  unsigned long total;
+  unsigned short start;
+  int i,j;
+  //fill buffer
+  for(i=0;i<sizeof(bench_buf);i++){
+    bench_buf[i]=i*7;
+  }
+  printf("CRC16 of 1KB\r\n");
+  //even address uses DMA, odd address is done by the CPU
+  for(j=0;j<2;j++){
+    //clear stats
+    BUS_prof_clear();
+    for(i=0,total=0;i<BENCH_NUM;i++){
+      //time CRC with the profiling timer
+      start=TA2R;
+      crc16(bench_buf+j,1024);
+      total+=(unsigned short)(TA2R-start);
+    }
+    //get time spent with interrupts disabled
+    BUS_prof_get(BUS_PROF_CRC_DMA,&st);
+    printf("  %s : %lu cycles per KB, %u cycles max with interrupts disabled\r\n",j?"CPU":"DMA",total/BENCH_NUM,st.max);
+  }
+}
+
+//LZ compression time for 1KB of text and random data, random data searches the whole window for every byte
+static void bench_lz(void){
+  static unsigned char lz[1024];
+  CTL_TIME_t start,t;
+  unsigned short clen;
+  int i,j;
+  printf("LZ compress of 1KB\r\n");
+  for(j=0;j<2;j++){
+    //fill buffer with repeating text or pseudo random data
+    for(i=0;i<1024;i++){
+      bench_buf[i]=j?(i*251+(i>>3)*17)^(i>>5):"ARClib bench "[i%13];
+    }
+    //time with the tick, compression takes milliseconds
+    start=ctl_get_current_time();
+    for(i=0;i<BENCH_NUM;i++){
+      clen=lz_compress(bench_buf,1024,lz,1023);
+    }
+    t=ctl_get_current_time()-start;
+    //ticks are 1/1024 s, SMCLK is 20MHz
+    printf("  %s : %u bytes, %lu cycles per byte\r\n",j?"random":"text  ",clen,(unsigned long)((t*(20000000ULL/1024))/(BENCH_NUM*1024UL)));
+  }
+}
+
+//tick interrupts per second while idle with normal ticks and with tickless idle
+static void bench_tickless(void){
+  unsigned long w;
+  int en;
+  printf("Idle wakeups\r\n");
+  for(en=0;en<2;en++){
+    BUS_tickless(en);
+    //count tick interrupts while this task sleeps for 10s
+    w=BUS_tick_wakeups();
+    ctl_timeout_wait(ctl_get_current_time()+10*1024);
+    w=BUS_tick_wakeups()-w;
+    printf("  %s : %lu wakeups per second\r\n",en?"tickless":"normal  ",w/10);
+  }
+  //back to normal ticks
+  BUS_tickless(0);
+}
+
+//error of BUS_delay_usec for busy waits, TA1CCR2 waits and tick sleeps, used to check BUS_DELAY_LOOP_CYCLES
+//times are measured with the profiling timer so delays must be shorter than 3276us
+static void bench_delay(void){
+  static const unsigned short us[]={5,20,50,99,100,300,1000,3000};
+  unsigned short start,t,max;
+  unsigned long total;
+  int i,j;
+  printf("Delay error\r\n");
+  for(j=0;j<sizeof(us)/sizeof(us[0]);j++){
+    for(i=0,total=0,max=0;i<BENCH_NUM;i++){
+      start=TA2R;
+      BUS_delay_usec(us[j]);
+      t=TA2R-start;
+      total+=t;
+      if(t>max){
+        max=t;
+      }
+    }
+    //SMCLK is 20MHz so 20 cycles per microsecond, interrupts during the delay add to the max
+    printf("  %4u us : %+ld us average, %+ld us max\r\n",us[j],(long)(total/BENCH_NUM/20)-us[j],(long)(max/20)-us[j]);
+  }
+}
+
+//run benchmarks
+static void bench_run(void *p) __toplevel{
+  //let the bus start up
+  ctl_timeout_wait(ctl_get_current_time()+1024);
+  bench_i2c();
+  bench_parse();
+  bench_crc();
+  bench_lz();
+  bench_tickless();
+  bench_delay();
+  printf("Benchmarks done\r\n");
+  for(;;){
+    ctl_timeout_wait(ctl_get_current_time()+1024);
+  }
+}
+
+int main(void){
+  //setup clocks and pins
+  ARC_setup();
+  //setup bus
+  initARCbus(BENCH_OWN_ADDR);
+  //start benchmark task
+  ctl_task_run(&bench_task,BUS_PRI_LOW,bench_run,NULL,"bench",sizeof(bench_stack)/sizeof(bench_stack[0])-2,bench_stack+1,0);
+  //start ARClib tasks and idle
+  mainLoop();
+  return 0;
+}
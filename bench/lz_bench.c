@@ -0,0 +1,147 @@
+//host benchmark for the LZ compression used for SPI data
+//build and run on a PC: gcc -O2 -o lz_bench lz_bench.c && ./lz_bench
+//prints compression ratio, time per byte and byte compares per byte for the match search
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//count compares in the match search
+static unsigned long lz_cmp;
+#define LZ_COUNT_CMP()      (lz_cmp++)
+
+#include "../compress.c"
+
+//size of each test block, same as a SPI buffer
+#define BENCH_LEN           1024
+//number of times each test is run for timing
+#define BENCH_NUM           200
+
+//fill functions for test data
+typedef void (*fill_func)(unsigned char *buf,unsigned short len);
+
+//all zeros, long matches
+static void fill_zero(unsigned char *buf,unsigned short len){
+  memset(buf,0,len);
+}
+
+//random bytes, no matches
+static void fill_random(unsigned char *buf,unsigned short len){
+  unsigned short i;
+  srand(1);
+  for(i=0;i<len;i++){
+    buf[i]=rand();
+  }
+}
+
+//random bytes from two values, many short matches in the window
+static void fill_binary(unsigned char *buf,unsigned short len){
+  unsigned short i;
+  srand(2);
+  for(i=0;i<len;i++){
+    buf[i]=(rand()&1)?'a':'b';
+  }
+}
+
+//every other byte is the same, the first byte check passes for half the window and fails on the next byte
+static void fill_alternate(unsigned char *buf,unsigned short len){
+  unsigned short i;
+  srand(3);
+  for(i=0;i<len;i++){
+    buf[i]=(i&1)?rand():0;
+  }
+}
+
+//runs one byte shorter than the longest match, every position in the window matches until the end of a run
+static void fill_runs(unsigned char *buf,unsigned short len){
+  unsigned short i;
+  for(i=0;i<len;i++){
+    buf[i]=((i%LZ_MAX_MATCH)==LZ_MAX_MATCH-1)?i/LZ_MAX_MATCH+1:0;
+  }
+}
+
+//text with repeated words
+static void fill_text(unsigned char *buf,unsigned short len){
+  static const char *words[]={"the ","spacecraft ","bus ","sends ","data ","over ","SPI ","and ","I2C ","to ","each ","board "};
+  unsigned short i=0,n;
+  const char *w;
+  srand(4);
+  while(i<len){
+    w=words[rand()%(sizeof(words)/sizeof(words[0]))];
+    for(n=0;w[n] && i<len;n++){
+      buf[i++]=w[n];
+    }
+  }
+}
+
+//telemetry records with a timestamp, slowly changing readings and noise in the low bits
+static void fill_telemetry(unsigned char *buf,unsigned short len){
+  unsigned short i,j,v;
+  srand(5);
+  for(i=0;i+16<=len;i+=16){
+    //timestamp
+    buf[i]=i>>12;
+    buf[i+1]=i>>4;
+    //readings
+    for(j=2;j<16;j+=2){
+      v=1000*j+(i>>6)+(rand()&3);
+      buf[i+j]=v>>8;
+      buf[i+j+1]=v;
+    }
+  }
+  memset(buf+i,0,len-i);
+}
+
+//get time in nanoseconds
+static double now_ns(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+static void bench(const char *name,fill_func fill){
+  static unsigned char src[BENCH_LEN],lz[BENCH_LEN+BENCH_LEN/8+8],out[BENCH_LEN],in_place[BENCH_LEN+4];
+  unsigned short clen,dlen;
+  unsigned long cmp;
+  double t0,tc,td;
+  int i;
+  fill(src,BENCH_LEN);
+  //count compares for one block
+  lz_cmp=0;
+  clen=lz_compress(src,BENCH_LEN,lz,sizeof(lz));
+  cmp=lz_cmp;
+  //time compression
+  t0=now_ns();
+  for(i=0;i<BENCH_NUM;i++){
+    clen=lz_compress(src,BENCH_LEN,lz,sizeof(lz));
+  }
+  tc=(now_ns()-t0)/BENCH_NUM/BENCH_LEN;
+  //time decompression
+  t0=now_ns();
+  for(i=0;i<BENCH_NUM;i++){
+    dlen=lz_decompress(lz,clen,out,sizeof(out));
+  }
+  td=(now_ns()-t0)/BENCH_NUM/BENCH_LEN;
+  //check result
+  if(dlen!=BENCH_LEN || memcmp(src,out,BENCH_LEN)){
+    printf("%-10s : decompress failed\n",name);
+    return;
+  }
+  //check in place decompression in a SPI buffer sized block, only done if the data got smaller
+  memcpy(in_place,lz,clen);
+  dlen=(clen<BENCH_LEN)?lz_decompress_inplace(in_place,clen,sizeof(in_place)):0;
+  printf("%-10s : %4u -> %4u bytes (%5.1f%%), %7.1f compares/byte, compress %6.1f ns/byte, decompress %4.1f ns/byte, in place %s\n",
+         name,BENCH_LEN,clen,100.0*clen/BENCH_LEN,(double)cmp/BENCH_LEN,tc,td,
+         (clen>=BENCH_LEN)?"n/a":((dlen==BENCH_LEN && !memcmp(src,in_place,BENCH_LEN))?"ok":"failed"));
+}
+
+int main(void){
+  bench("zero",fill_zero);
+  bench("text",fill_text);
+  bench("telemetry",fill_telemetry);
+  bench("random",fill_random);
+  bench("binary",fill_binary);
+  bench("alternate",fill_alternate);
+  bench("runs",fill_runs);
+  return 0;
+}
@@ -1,59 +1,192 @@
-#include <ctl.h>
-#include <msp430.h>
-#include "ARCbus.h"
-
-#include "ARCbus_internal.h"
-
-//mutex for buffer locking
-CTL_MUTEX_t buffer_mutex;
-
-//buffer for SPI transactions
-//static unsigned char Buffer[4096+2];
-//static unsigned char Buffer[2048+2];
-static unsigned char Buffer[1024+4];
-
-//setup stuff for buffer usage
-void BUS_init_buffer(void){
-  //initialize mutex
-  ctl_mutex_init(&buffer_mutex);
-}
-
-//return buffer size
-const unsigned int BUS_get_buffer_size(void){
-  return sizeof(Buffer);
-}
-
-//lock buffer and return pointer to buffer
-void* BUS_get_buffer(CTL_TIMEOUT_t t, CTL_TIME_t timeout){
-  if(ctl_mutex_lock(&buffer_mutex,t,timeout)){
-    //lock aquired, return buffer
-    return Buffer;
-  }else{
-    //lock not aquired return NULL
-    return NULL;
-  }
-}
-
-//free buffer
-void BUS_free_buffer(void){
-  ctl_mutex_unlock(&buffer_mutex);
-}
-
-//get buffer if it was locked by ARCbus
-void* BUS_get_buffer_from_event(void){
-  //TODO: error chekcing
-  return Buffer;
-}
-
-//free buffer if it was locket by ARCbus
-void BUS_free_buffer_from_event(void){
-  //bus internal events
-  extern CTL_EVENT_SET_t BUS_INT_events;
-  //set event to realese buffer
-  ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_BUFF_UNLOCK,0);
-}
-
-
-
-
-
+#include <ctl.h>
+#include <msp430.h>
+#include "ARCbus.h"
+
+#include "ARCbus_internal.h"
+
+//semaphore counting free blocks
+static CTL_SEMAPHORE_t buffer_sem;
+
+//blocks for SPI transactions
+static unsigned char Buffer[BUS_BUFFER_BLOCK_NUM][BUS_BUFFER_BLOCK_SIZE];
+//number of references to each block, zero if the block is free
+static unsigned char buffer_ref[BUS_BUFFER_BLOCK_NUM];
+
+//pool counters
+static BUS_BUFFER_STAT buffer_stat;
+
+//block that BUS_get_buffer returned for this task
+static __thread void *BUS_thread_buffer=NULL;
+//number of times this task has called BUS_get_buffer without BUS_free_buffer
+static __thread unsigned char BUS_thread_buffer_cnt=0;
+
+//block received by the ARCbus task and passed to the subsystem
+void *BUS_event_buffer=NULL;
+
+//setup stuff for buffer usage
+void BUS_init_buffer(void){
+  //initialize semaphore, all blocks are free
+  ctl_semaphore_init(&buffer_sem,BUS_BUFFER_BLOCK_NUM);
+}
+
+//return buffer size
+const unsigned int BUS_get_buffer_size(void){
+  return BUS_BUFFER_BLOCK_SIZE;
+}
+
+//get block index from pointer, returns -1 if the pointer is not a block
+static int BUS_buffer_idx(void *buf){
+  unsigned int off;
+  //check if pointer is in the pool
+  if((unsigned char*)buf<Buffer[0] || (unsigned char*)buf>=Buffer[BUS_BUFFER_BLOCK_NUM]){
+    return -1;
+  }
+  //get offset into pool
+  off=(unsigned char*)buf-Buffer[0];
+  //pointer must be the start of a block
+  if(off%BUS_BUFFER_BLOCK_SIZE){
+    return -1;
+  }
+  return off/BUS_BUFFER_BLOCK_SIZE;
+}
+
+//allocate a block from the pool, returns NULL if no block is free before the timeout
+void* BUS_buffer_alloc(CTL_TIMEOUT_t t, CTL_TIME_t timeout){
+  int i,en;
+  //wait for a free block
+  if(!ctl_semaphore_wait(&buffer_sem,t,timeout)){
+    en=ctl_global_interrupts_disable();
+    //count failure
+    buffer_stat.fail++;
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    return NULL;
+  }
+  en=ctl_global_interrupts_disable();
+  //find free block, the semaphore guarantees there is one
+  for(i=0;i<BUS_BUFFER_BLOCK_NUM && buffer_ref[i]!=0;i++);
+  //take block
+  buffer_ref[i]=1;
+  //update counters
+  buffer_stat.used++;
+  if(buffer_stat.used>buffer_stat.high){
+    buffer_stat.high=buffer_stat.used;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return Buffer[i];
+}
+
+//add a reference to a block
+int BUS_buffer_ref(void *buf){
+  int idx,en,resp=RET_SUCCESS;
+  //get block index
+  if((idx=BUS_buffer_idx(buf))<0){
+    return ERR_INVALID_ARGUMENT;
+  }
+  en=ctl_global_interrupts_disable();
+  //block must be allocated and references must not overflow
+  if(buffer_ref[idx]==0 || buffer_ref[idx]==0xFF){
+    resp=ERR_INVALID_ARGUMENT;
+  }else{
+    //add reference
+    buffer_ref[idx]++;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return resp;
+}
+
+//remove a reference to a block, block is returned to the pool when the last reference is removed
+int BUS_buffer_free(void *buf){
+  int idx,en,last=0;
+  //get block index
+  if((idx=BUS_buffer_idx(buf))<0){
+    return ERR_INVALID_ARGUMENT;
+  }
+  en=ctl_global_interrupts_disable();
+  //check that block is allocated
+  if(buffer_ref[idx]==0){
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    return ERR_INVALID_ARGUMENT;
+  }
+  //remove reference and check if this was the last one
+  if(--buffer_ref[idx]==0){
+    buffer_stat.used--;
+    last=1;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  //return block to the pool
+  if(last){
+    ctl_semaphore_signal(&buffer_sem);
+    //start a SPI transfer that is waiting for a block
+    ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SPI_NEXT,0);
+  }
+  return RET_SUCCESS;
+}
+
+//get pool counters
+void BUS_buffer_stat(BUS_BUFFER_STAT *stat){
+  int en;
+  en=ctl_global_interrupts_disable();
+  *stat=buffer_stat;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//lock buffer and return pointer to buffer
+void* BUS_get_buffer(CTL_TIMEOUT_t t, CTL_TIME_t timeout){
+  //check if this task already has a block
+  if(BUS_thread_buffer!=NULL){
+    //add reference so each call needs a free
+    if(BUS_buffer_ref(BUS_thread_buffer)!=RET_SUCCESS){
+      return NULL;
+    }
+  }else{
+    //get block from pool and remember it for BUS_free_buffer
+    BUS_thread_buffer=BUS_buffer_alloc(t,timeout);
+    //check if block was allocated
+    if(BUS_thread_buffer==NULL){
+      return NULL;
+    }
+  }
+  //count calls
+  BUS_thread_buffer_cnt++;
+  return BUS_thread_buffer;
+}
+
+//free buffer
+void BUS_free_buffer(void){
+  void *buf=BUS_thread_buffer;
+  //check if this task has a block
+  if(buf==NULL){
+    return;
+  }
+  //forget block once the last reference from this task is gone
+  if(--BUS_thread_buffer_cnt==0){
+    BUS_thread_buffer=NULL;
+  }
+  //release block
+  BUS_buffer_free(buf);
+}
+
+//get buffer if it was locked by ARCbus
+void* BUS_get_buffer_from_event(void){
+  return BUS_event_buffer;
+}
+
+//free buffer if it was locket by ARCbus
+void BUS_free_buffer_from_event(void){
+  //bus internal events
+  extern CTL_EVENT_SET_t BUS_INT_events;
+  //set event to realese buffer
+  ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_BUFF_UNLOCK,0);
+}
@@ -0,0 +1,188 @@
+#include <string.h>
+#include "compress.h"
+
+//LZSS compression for bulk data
+//each group of 8 items starts with a flag byte, a set bit means the item is a literal byte
+//a clear bit means the item is a match: [offset-1][length-LZ_MIN_MATCH]
+//compression finds matches with hash chains kept on the stack, decompression only needs the input and output buffers
+
+//count byte compares in the match search, defined by the host benchmark
+#ifndef LZ_COUNT_CMP
+  #define LZ_COUNT_CMP()
+#endif
+
+//hash of the LZ_MIN_MATCH bytes at p, used to find earlier positions that can match
+#define LZ_HASH(p)        (((((unsigned short)(p)[0])<<5)^(((unsigned short)(p)[1])<<3)^(p)[2])&(LZ_HASH_NUM-1))
+
+//add position p to the hash chains
+//head has the last position with each hash plus one, prev has the distance back to the last position with the same hash
+static void lz_insert(const unsigned char *src,unsigned short p,unsigned short *head,unsigned char *prev){
+  unsigned short h=LZ_HASH(src+p),d;
+  //distance to the last position with the same hash
+  d=p-(head[h]-1);
+  //link to it if it is in the window, offsets that don't fit in a byte end the chain
+  prev[p%LZ_WINDOW_LEN]=(head[h]!=0 && d<LZ_WINDOW_LEN)?d:0;
+  //position is the new start of the chain
+  head[h]=p+1;
+}
+
+//compress len bytes from src into dst, returns compressed length or zero if the data does not fit in max bytes
+unsigned short lz_compress(const unsigned char *src,unsigned short len,unsigned char *dst,unsigned short max){
+  unsigned short in=0,out=0,flag_idx=0,start,i,n,best_len,best_off,limit,end;
+  unsigned short head[LZ_HASH_NUM];
+  unsigned char prev[LZ_WINDOW_LEN],bit=0,tries,d;
+  //no positions in the chains yet, prev is only read for positions that have been added
+  memset(head,0,sizeof(head));
+  //positions after end don't have enough bytes to hash
+  end=(len>=LZ_MIN_MATCH)?len-LZ_MIN_MATCH+1:0;
+  while(in<len){
+    //check if a new flag byte is needed
+    if(bit==0){
+      //check for space
+      if(out>=max){
+        return 0;
+      }
+      //start new flag byte
+      flag_idx=out++;
+      dst[flag_idx]=0;
+      bit=1;
+    }
+    //find longest match in the window
+    best_len=0;
+    best_off=0;
+    //start of window
+    start=(in>LZ_WINDOW_LEN)?in-LZ_WINDOW_LEN:0;
+    //longest possible match
+    limit=len-in;
+    if(limit>LZ_MAX_MATCH){
+      limit=LZ_MAX_MATCH;
+    }
+    //check earlier positions with the same hash, newest first
+    if(limit>=LZ_MIN_MATCH && (i=head[LZ_HASH(src+in)])!=0){
+      i--;
+      for(tries=0;i>=start && tries<LZ_CHAIN_MAX;tries++){
+        LZ_COUNT_CMP();
+        //check the byte after the best match first, only a longer match is useful
+        if(src[i+best_len]==src[in+best_len]){
+          //get match length, matches can run into the data being compressed
+          for(n=0;n<limit && src[i+n]==src[in+n];n++){
+            LZ_COUNT_CMP();
+          }
+          //check for a longer match
+          if(n>best_len){
+            best_len=n;
+            best_off=in-i;
+            //stop if the longest match was found
+            if(n==limit){
+              break;
+            }
+          }
+        }
+        //check for the end of the chain
+        if((d=prev[i%LZ_WINDOW_LEN])==0){
+          break;
+        }
+        //go to the last position with the same hash
+        i-=d;
+      }
+    }
+    //check if match is long enough
+    if(best_len>=LZ_MIN_MATCH){
+      //check for space
+      if(out+2>max){
+        return 0;
+      }
+      //write match
+      dst[out++]=best_off-1;
+      dst[out++]=best_len-LZ_MIN_MATCH;
+    }else{
+      //check for space
+      if(out>=max){
+        return 0;
+      }
+      //flag literal
+      dst[flag_idx]|=bit;
+      //write literal
+      dst[out++]=src[in];
+      best_len=1;
+    }
+    //add the positions that were used to the chains
+    for(;best_len>0;best_len--,in++){
+      if(in<end){
+        lz_insert(src,in,head,prev);
+      }
+    }
+    //next flag bit
+    bit<<=1;
+  }
+  return out;
+}
+
+//decompress len bytes from src into dst, set inplace if src is inside dst
+//returns decompressed length or zero if the data is bad, does not fit in max bytes or would overwrite unread input
+static unsigned short lz_decode(const unsigned char *src,unsigned short len,unsigned char *dst,unsigned short max,int inplace){
+  unsigned short in=0,out=0,off,n;
+  //offset of src in dst, output must stay behind the input
+  unsigned short base=inplace?src-dst:0;
+  unsigned char flags=0,bit=0;
+  while(in<len){
+    //check if a new flag byte is needed
+    if(bit==0){
+      flags=src[in++];
+      bit=1;
+      //flag byte must be followed by an item
+      if(in>=len){
+        return 0;
+      }
+    }
+    //check item type
+    if(flags&bit){
+      //check for space, the literal is read before it is written so it can overwrite itself
+      if(out>=max || (inplace && out>base+in)){
+        return 0;
+      }
+      //copy literal
+      dst[out++]=src[in++];
+    }else{
+      //match needs two bytes
+      if(in+2>len){
+        return 0;
+      }
+      //get offset and length
+      off=src[in++]+1;
+      n=src[in++]+LZ_MIN_MATCH;
+      //check offset and space
+      if(off>out || out+n>max || (inplace && out+n>base+in)){
+        return 0;
+      }
+      //copy match one byte at a time, matches can overlap the output
+      for(;n>0;n--,out++){
+        dst[out]=dst[out-off];
+      }
+    }
+    //next flag bit
+    bit<<=1;
+  }
+  return out;
+}
+
+//decompress len bytes from src into dst, returns decompressed length or zero if the data is bad or does not fit in max bytes
+unsigned short lz_decompress(const unsigned char *src,unsigned short len,unsigned char *dst,unsigned short max){
+  return lz_decode(src,len,dst,max,0);
+}
+
+//decompress len bytes at the start of buf in place, buf must be max bytes long
+//the data is moved to the end of buf and expanded from there, returns zero if the output would overwrite unread input
+//the data in buf is lost if this fails
+unsigned short lz_decompress_inplace(unsigned char *buf,unsigned short len,unsigned short max){
+  unsigned short base;
+  //check that data fits
+  if(len>max){
+    return 0;
+  }
+  //move data to the end of the buffer
+  base=max-len;
+  memmove(buf+base,buf,len);
+  //expand to the start of the buffer
+  return lz_decode(buf+base,len,buf,max,1);
+}
@@ -0,0 +1,24 @@
+#ifndef __COMPRESS_H
+#define __COMPRESS_H
+
+//match offsets are one byte so the window is 256 bytes
+#define LZ_WINDOW_LEN     (256)
+//shortest match, shorter matches are sent as literals
+#define LZ_MIN_MATCH      (3)
+//longest match, match length is one byte
+#define LZ_MAX_MATCH      (LZ_MIN_MATCH+255)
+//number of hash chains used to find matches, must be a power of 2
+#define LZ_HASH_NUM       (64)
+//most earlier positions checked for each byte, longer chains find better matches but take longer
+#define LZ_CHAIN_MAX      (16)
+
+//compress len bytes from src into dst, returns compressed length or zero if the data does not fit in max bytes
+//the match search follows hash chains that use about 400 bytes of stack, data without matches takes about 4 byte compares per byte (bench/lz_bench.c)
+unsigned short lz_compress(const unsigned char *src,unsigned short len,unsigned char *dst,unsigned short max);
+//decompress len bytes from src into dst, returns decompressed length or zero if the data is bad or does not fit in max bytes
+unsigned short lz_decompress(const unsigned char *src,unsigned short len,unsigned char *dst,unsigned short max);
+//decompress len bytes at the start of buf in place, buf must be max bytes long
+//returns decompressed length or zero if the data is bad or the output would overwrite unread input, buf is lost if this fails
+unsigned short lz_decompress_inplace(unsigned char *buf,unsigned short len,unsigned short max);
+
+#endif
@@ -1,58 +1,144 @@
-#include <msp430.h>
-#include <ctl.h>
-
-
-//Table used to compute 7-bit CRC
-//*****************************************************************************
-static const unsigned char crc7_table[256] = {
-    0x00, 0x12, 0x24, 0x36, 0x48, 0x5a, 0x6c, 0x7e, 0x90, 0x82, 0xb4, 0xa6, 0xd8, 0xca, 0xfc, 0xee,
-    0x32, 0x20, 0x16, 0x04, 0x7a, 0x68, 0x5e, 0x4c, 0xa2, 0xb0, 0x86, 0x94, 0xea, 0xf8, 0xce, 0xdc,
-    0x64, 0x76, 0x40, 0x52, 0x2c, 0x3e, 0x08, 0x1a, 0xf4, 0xe6, 0xd0, 0xc2, 0xbc, 0xae, 0x98, 0x8a,
-    0x56, 0x44, 0x72, 0x60, 0x1e, 0x0c, 0x3a, 0x28, 0xc6, 0xd4, 0xe2, 0xf0, 0x8e, 0x9c, 0xaa, 0xb8,
-    0xc8, 0xda, 0xec, 0xfe, 0x80, 0x92, 0xa4, 0xb6, 0x58, 0x4a, 0x7c, 0x6e, 0x10, 0x02, 0x34, 0x26,
-    0xfa, 0xe8, 0xde, 0xcc, 0xb2, 0xa0, 0x96, 0x84, 0x6a, 0x78, 0x4e, 0x5c, 0x22, 0x30, 0x06, 0x14,
-    0xac, 0xbe, 0x88, 0x9a, 0xe4, 0xf6, 0xc0, 0xd2, 0x3c, 0x2e, 0x18, 0x0a, 0x74, 0x66, 0x50, 0x42,
-    0x9e, 0x8c, 0xba, 0xa8, 0xd6, 0xc4, 0xf2, 0xe0, 0x0e, 0x1c, 0x2a, 0x38, 0x46, 0x54, 0x62, 0x70,
-    0x82, 0x90, 0xa6, 0xb4, 0xca, 0xd8, 0xee, 0xfc, 0x12, 0x00, 0x36, 0x24, 0x5a, 0x48, 0x7e, 0x6c,
-    0xb0, 0xa2, 0x94, 0x86, 0xf8, 0xea, 0xdc, 0xce, 0x20, 0x32, 0x04, 0x16, 0x68, 0x7a, 0x4c, 0x5e,
-    0xe6, 0xf4, 0xc2, 0xd0, 0xae, 0xbc, 0x8a, 0x98, 0x76, 0x64, 0x52, 0x40, 0x3e, 0x2c, 0x1a, 0x08,
-    0xd4, 0xc6, 0xf0, 0xe2, 0x9c, 0x8e, 0xb8, 0xaa, 0x44, 0x56, 0x60, 0x72, 0x0c, 0x1e, 0x28, 0x3a,
-    0x4a, 0x58, 0x6e, 0x7c, 0x02, 0x10, 0x26, 0x34, 0xda, 0xc8, 0xfe, 0xec, 0x92, 0x80, 0xb6, 0xa4,
-    0x78, 0x6a, 0x5c, 0x4e, 0x30, 0x22, 0x14, 0x06, 0xe8, 0xfa, 0xcc, 0xde, 0xa0, 0xb2, 0x84, 0x96,
-    0x2e, 0x3c, 0x0a, 0x18, 0x66, 0x74, 0x42, 0x50, 0xbe, 0xac, 0x9a, 0x88, 0xf6, 0xe4, 0xd2, 0xc0,
-    0x1c, 0x0e, 0x38, 0x2a, 0x54, 0x46, 0x70, 0x62, 0x8c, 0x9e, 0xa8, 0xba, 0xc4, 0xd6, 0xe0, 0xf2
-};
-
-unsigned char crc7(const unsigned char *data,unsigned short len){
-    unsigned char crc=0;
-    unsigned int tbl_idx;
-    unsigned short i;
-    for(i=0;i<len;i++){
-        tbl_idx = ((crc >> 0) ^ *data) & 0xff;
-        crc = (crc7_table[tbl_idx] ^ (crc << (8 - 1))) & (0x7f << 1);
-        data++;
-    }
-    //return 7-bit CRC in msb's and 1 in lsb (for SD card communication)
-    return crc|1;
-
-}
-
-CTL_MUTEX_t crc_mutex;
-
-//use CRC module for crc16
-unsigned short crc16(const unsigned char *data,unsigned short len){
-    unsigned short crc=0;
-    unsigned short i;
-    unsigned int tbl_idx;
-    //lock the CRC module
-    ctl_mutex_lock_uc(&crc_mutex);
-    //init CRC module with initial value
-    CRCINIRES=0;
-    for(i=0;i<len;i++){
-      CRCDIRB_L=*data++;
-    }
-    crc=CRCINIRES;
-    //lock the CRC module
-    ctl_mutex_unlock(&crc_mutex);
-    return crc;
-}
+#include <msp430.h>
+#include <ctl.h>
+#include "ARCbus.h"
+#include "ARCbus_internal.h"
+
+
+//Table used to compute 7-bit CRC
+//*****************************************************************************
+static const unsigned char crc7_table[256] = {
+    0x00, 0x12, 0x24, 0x36, 0x48, 0x5a, 0x6c, 0x7e, 0x90, 0x82, 0xb4, 0xa6, 0xd8, 0xca, 0xfc, 0xee,
+    0x32, 0x20, 0x16, 0x04, 0x7a, 0x68, 0x5e, 0x4c, 0xa2, 0xb0, 0x86, 0x94, 0xea, 0xf8, 0xce, 0xdc,
+    0x64, 0x76, 0x40, 0x52, 0x2c, 0x3e, 0x08, 0x1a, 0xf4, 0xe6, 0xd0, 0xc2, 0xbc, 0xae, 0x98, 0x8a,
+    0x56, 0x44, 0x72, 0x60, 0x1e, 0x0c, 0x3a, 0x28, 0xc6, 0xd4, 0xe2, 0xf0, 0x8e, 0x9c, 0xaa, 0xb8,
+    0xc8, 0xda, 0xec, 0xfe, 0x80, 0x92, 0xa4, 0xb6, 0x58, 0x4a, 0x7c, 0x6e, 0x10, 0x02, 0x34, 0x26,
+    0xfa, 0xe8, 0xde, 0xcc, 0xb2, 0xa0, 0x96, 0x84, 0x6a, 0x78, 0x4e, 0x5c, 0x22, 0x30, 0x06, 0x14,
+    0xac, 0xbe, 0x88, 0x9a, 0xe4, 0xf6, 0xc0, 0xd2, 0x3c, 0x2e, 0x18, 0x0a, 0x74, 0x66, 0x50, 0x42,
+    0x9e, 0x8c, 0xba, 0xa8, 0xd6, 0xc4, 0xf2, 0xe0, 0x0e, 0x1c, 0x2a, 0x38, 0x46, 0x54, 0x62, 0x70,
+    0x82, 0x90, 0xa6, 0xb4, 0xca, 0xd8, 0xee, 0xfc, 0x12, 0x00, 0x36, 0x24, 0x5a, 0x48, 0x7e, 0x6c,
+    0xb0, 0xa2, 0x94, 0x86, 0xf8, 0xea, 0xdc, 0xce, 0x20, 0x32, 0x04, 0x16, 0x68, 0x7a, 0x4c, 0x5e,
+    0xe6, 0xf4, 0xc2, 0xd0, 0xae, 0xbc, 0x8a, 0x98, 0x76, 0x64, 0x52, 0x40, 0x3e, 0x2c, 0x1a, 0x08,
+    0xd4, 0xc6, 0xf0, 0xe2, 0x9c, 0x8e, 0xb8, 0xaa, 0x44, 0x56, 0x60, 0x72, 0x0c, 0x1e, 0x28, 0x3a,
+    0x4a, 0x58, 0x6e, 0x7c, 0x02, 0x10, 0x26, 0x34, 0xda, 0xc8, 0xfe, 0xec, 0x92, 0x80, 0xb6, 0xa4,
+    0x78, 0x6a, 0x5c, 0x4e, 0x30, 0x22, 0x14, 0x06, 0xe8, 0xfa, 0xcc, 0xde, 0xa0, 0xb2, 0x84, 0x96,
+    0x2e, 0x3c, 0x0a, 0x18, 0x66, 0x74, 0x42, 0x50, 0xbe, 0xac, 0x9a, 0x88, 0xf6, 0xe4, 0xd2, 0xc0,
+    0x1c, 0x0e, 0x38, 0x2a, 0x54, 0x46, 0x70, 0x62, 0x8c, 0x9e, 0xa8, 0xba, 0xc4, 0xd6, 0xe0, 0xf2
+};
+
+unsigned char crc7(const unsigned char *data,unsigned short len){
+    unsigned char crc=0;
+    unsigned int tbl_idx;
+    unsigned short i;
+    for(i=0;i<len;i++){
+        tbl_idx = ((crc >> 0) ^ *data) & 0xff;
+        crc = (crc7_table[tbl_idx] ^ (crc << (8 - 1))) & (0x7f << 1);
+        data++;
+    }
+    //return 7-bit CRC in msb's and 1 in lsb (for SD card communication)
+    return crc|1;
+
+}
+
+//add a byte to a running 7-bit CRC, start with zero and set the lsb at the end to match crc7
+unsigned char crc7_step(unsigned char crc,unsigned char dat){
+    return (crc7_table[(crc^dat)&0xff]^(crc<<(8-1)))&(0x7f<<1);
+}
+
+CTL_MUTEX_t crc_mutex;
+
+//minimum length to use DMA for crc16, shorter data is faster from the CPU
+#define CRC_DMA_MIN_LEN     16
+//most words sent in one block transfer, interrupts are disabled for each block so this limits interrupt latency
+#define CRC_DMA_BLOCK_WORDS 64
+
+//feed 16-bit words into the CRC module with DMA2 block transfers, returns number of bytes done
+//the CPU is halted during each block transfer so DMA2 is only borrowed if it is not in use
+//interrupts are enabled between blocks, if SPI or I2C takes DMA2 the rest is left for the CPU
+static unsigned short crc16_dma(const unsigned char *data,unsigned short len){
+    unsigned int sa,da,sz,ctl1;
+    unsigned short done=0,words;
+    int en;
+    #ifdef BUS_PROFILE
+      unsigned short prof;
+    #endif
+    //words can only be read from even addresses
+    if(((unsigned int)data)&1 || len<CRC_DMA_MIN_LEN){
+      return 0;
+    }
+    //send blocks until there is less than a word left
+    while(len-done>=2){
+      //get block size
+      words=(len-done)/2;
+      if(words>CRC_DMA_BLOCK_WORDS){
+        words=CRC_DMA_BLOCK_WORDS;
+      }
+      en=ctl_global_interrupts_disable();
+      //check if DMA2 is being used for SPI or I2C
+      if(DMA2CTL&DMAEN){
+        if(en){
+          ctl_global_interrupts_enable();
+        }
+        break;
+      }
+      #ifdef BUS_PROFILE
+        prof=BUS_PROF_TIMER;
+      #endif
+      //save DMA2 setup in case SPI or I2C was in the middle of setting it up
+      ctl1=DMACTL1;
+      sa=*((unsigned int*)&DMA2SA);
+      da=*((unsigned int*)&DMA2DA);
+      sz=DMA2SZ;
+      //trigger from DMAREQ
+      DMACTL1=DMA2TSEL_0;
+      // Source DMA address: data
+      *((unsigned int*)&DMA2SA)=(unsigned int)(data+done);
+      // Destination DMA address: CRC module, word writes process the low byte first
+      *((unsigned int*)&DMA2DA)=(unsigned int)(&CRCDIRB);
+      //number of words to transfer
+      DMA2SZ=words;
+      // Configure the DMA transfer, block word transfer with source increment
+      DMA2CTL=DMADT_1|DMASRCINCR_3|DMADSTINCR_0|DMAEN;
+      //start transfer, CPU is halted until the block is done
+      DMA2CTL|=DMAREQ;
+      //done with DMA2
+      DMA2CTL=0;
+      //restore DMA2 setup
+      DMACTL1=ctl1;
+      *((unsigned int*)&DMA2SA)=sa;
+      *((unsigned int*)&DMA2DA)=da;
+      DMA2SZ=sz;
+      #ifdef BUS_PROFILE
+        //time with interrupts disabled
+        BUS_prof_add(BUS_PROF_CRC_DMA,BUS_PROF_TIMER-prof);
+      #endif
+      if(en){
+        ctl_global_interrupts_enable();
+      }
+      //count bytes done
+      done+=words*2;
+    }
+    //return number of bytes done
+    return done;
+}
+
+//use CRC module for crc16
+unsigned short crc16(const unsigned char *data,unsigned short len){
+    unsigned short crc=0;
+    unsigned short i;
+    unsigned int tbl_idx;
+    //lock the CRC module
+    ctl_mutex_lock_uc(&crc_mutex);
+    //init CRC module with initial value
+    CRCINIRES=0;
+    //feed as much as possible with DMA
+    i=crc16_dma(data,len);
+    data+=i;
+    //feed the rest from the CPU
+    for(;i<len;i++){
+      CRCDIRB_L=*data++;
+    }
+    crc=CRCINIRES;
+    //lock the CRC module
+    ctl_mutex_unlock(&crc_mutex);
+    return crc;
+}
@@ -1,7 +1,9 @@
-#ifndef __CRC_H
-#define __CRC_H
-
-unsigned char crc7(const void *dat,unsigned short len);
-unsigned short crc16(const void *dat,unsigned short len);
-
-#endif
+#ifndef __CRC_H
+#define __CRC_H
+
+unsigned char crc7(const void *dat,unsigned short len);
+//add a byte to a running 7-bit CRC, start with zero and set the lsb at the end to match crc7
+unsigned char crc7_step(unsigned char crc,unsigned char dat);
+unsigned short crc16(const void *dat,unsigned short len);
+
+#endif
@@ -1,190 +1,214 @@
-#include "ARCbus.h"
-#include "ARCbus_internal.h"
-
-//return error strings for error code
-const char *BUS_error_str(int error){
-  //check for error
-  switch(error){
-    case RET_SUCCESS:
-      return "SUCCESS";
-    case ERR_BAD_LEN:
-      return "ERROR BAD LENGTH";
-    case ERR_CMD_NACK:
-      return "ERROR COMMAND NON-ACKNOWLEDGEMENT";
-    case ERR_I2C_NACK:
-      return "ERROR I2C NON-ACKNOWLEDGEMENT";
-    case ERR_UNKNOWN:
-      return "ERROR UNKNOWN";
-    case ERR_BAD_ADDR:
-      return "ERROR BAD ADDRESS";
-    case ERR_BAD_CRC:
-      return "ERROR BAD CRC";
-    case ERR_TIMEOUT:
-      return "ERROR TIMEOUT";
-    case ERR_BUSY:
-      return "ERROR DEVICE OR RESOURCE BUSY";
-    case ERR_INVALID_ARGUMENT:
-      return "ERROR INVALID ARGUMENT";
-    case ERR_PACKET_TOO_LONG:
-      return "ERROR PACKET TOO LONG";
-    case ERR_I2C_ABORT:
-      return "ERROR I2C Transaction Aborted";
-    case ERR_TIME_INVALID:
-      return "ERROR TICKER TIME IS NOT VALID";
-    case ERR_TIME_TOO_OLD:
-      return "ERROR TICKER TIME IS TOO OLD";
-    case ERR_I2C_CLL:
-      return "ERROR I2C Clock Low Timeout";
-    case ERR_I2C_START_TIMEOUT:
-      return "ERROR I2C start timeout";
-    case ERR_I2C_TX_SELF:
-      return "ERROR TX to self";
-    case ERR_DMA_TIMEOUT:
-      return "ERROR DMA timeout";
-    //Error was not found
-    default:
-      return "UNKNOWN ERROR";
-  }
-}
-
-const char* BUS_cmdtostr(unsigned char cmd){
-  switch(cmd){
-    case CMD_NACK:
-      return "Nack";
-    case CMD_SPI_COMPLETE:
-      return "SPI Complete";
-    case CMD_SPI_RDY:
-      return "SPI Ready";
-    case CMD_SUB_ON:
-      return "Subsystem On";
-    case CMD_SUB_OFF:
-      return "Subsystem Off";
-    case CMD_SUB_POWERUP:
-      return "Subsystem Powerup";
-    case CMD_RESET:
-      return "Reset";
-    case CMD_SUB_STAT:
-      return "Subsystem Stat";
-    case CMD_SPI_CLEAR:
-      return "SPI Clear";
-    case CMD_EPS_STAT:
-      return "EPS Status";
-    case CMD_LEDL_STAT:
-      return "LEDL Status";
-    case CMD_ACDS_STAT:
-      return "ACDS Status";
-    case CMD_COMM_STAT:
-      return "COMM Status";
-    case CMD_IMG_STAT:
-      return "IMG Status";
-    case CMD_ASYNC_SETUP:
-      return "Async Setup";
-    case CMD_ASYNC_DAT:
-      return "Async Data";
-    case CMD_SPI_DATA_ACTION:
-      return "SPI Data Action";
-    case CMD_PING:
-        return "CMD_PING";
-    case CMD_MAG_DATA:
-        return "CMD_MAG_DATA";
-    case CMD_MAG_SAMPLE_CONFIG:
-        return "CMD_MAG_SAMPLE_CONFIG";
-    case CMD_ERR_REQ:
-        return "CMD_ERR_REQ";
-    case CMD_IMG_READ_PIC:
-        return "CMD_IMG_READ_PIC";
-    case CMD_IMG_TAKE_TIMED_PIC:
-        return "CMD_IMG_TAKE_TIMED_PIC";
-    case CMD_IMG_TAKE_PIC_NOW:
-        return "CMD_IMG_TAKE_PIC_NOW";
-    case CMD_GS_DATA:
-        return "CMD_GS_DATA";
-    case CMD_TEST_MODE:
-        return "CMD_TEST_MODE";
-    case CMD_BEACON_ON:
-        return "CMD_BEACON_ON";
-    case CMD_ACDS_CONFIG:
-        return "CMD_ACDS_CONFIG";
-    case CMD_IMG_CLEARPIC:
-        return "CMD_IMG_CLEARPIC";
-    case CMD_LEDL_READ_BLOCK:
-        return "CMD_LEDL_READ_BLOCK";
-    case CMD_ACDS_READ_BLOCK:
-        return "CMD_ACDS_READ_BLOCK";
-    case CMD_EPS_SEND:
-        return "CMD_EPS_SEND";
-    case CMD_LEDL_BLOW_FUSE:
-        return "CMD_LEDL_BLOW_FUSE";
-    case CMD_SPI_ABORT:
-        return "CMD_SPI_ABORT";
-    default:
-      return "Unknown";
-  }
-}
-
-const char* BUS_cmd_resptostr(unsigned char resp){
-  switch(resp){
-    case RET_SUCCESS:
-      return "Success";
-    case ERR_PK_LEN:
-      return "Error Invalid Packet Length";
-    case ERR_UNKNOWN_CMD:
-      return "Error Unknown Command";
-    case ERR_SPI_LEN:
-      return "Error SPI Block Length";
-    case ERR_BAD_PK:
-      return "Error Bad Packet";
-    case ERR_SPI_BUSY:
-      return "Error SPI busy";
-    case ERR_BUFFER_BUSY:
-      return "Error Buffer Busy";
-    case ERR_ILLEAGLE_COMMAND:
-      return "Error Illeagle Command";
-    case ERR_SPI_NOT_RUNNING:
-      return "Error SPI not running";
-    case ERR_SPI_WRONG_ADDR:
-      return "Error SPI wrong address";
-    case ERR_PK_BAD_PARM:
-      return "Error Bad parameter";
-    default:
-      return "Unknown";
-  }
-}
-
-const char* bus_flags_tostr(unsigned char flags){
-  switch(flags){
-    case BUS_FLAGS_INVALID_ADDR:
-      return "BUS_FLAGS_INVALID_ADDR";
-    case BUS_FLAGS_ADDR_DISABLED:
-      return "BUS_FLAGS_ADDR_DISABLED";
-    default:
-      return "Unknown";
-  }
-}
-
-const char * bus_version_err_tostr(signed char resp){
-  switch(resp){
-    case BUS_VER_SAME:
-      return "BUS_VER_SAME";
-    case BUS_VER_INVALID_MAJOR_REV:
-      return "BUS_VER_INVALID_MAJOR_REV";
-    case BUS_VER_MAJOR_REV_OLDER:
-      return "BUS_VER_MAJOR_REV_OLDER";
-    case BUS_VER_MAJOR_REV_NEWER:
-      return "BUS_VER_MAJOR_REV_NEWER";
-    case BUS_VER_INVALID_MINOR_REV:
-      return "BUS_VER_INVALID_MINOR_REV";
-    case BUS_VER_MINOR_REV_OLDER:
-      return "BUS_VER_MINOR_REV_OLDER";
-    case BUS_VER_MINOR_REV_NEWER:
-      return "BUS_VER_MINOR_REV_NEWER";
-    case BUS_VER_DIRTY_REV:
-      return "BUS_VER_DIRTY_REV";
-    case BUS_VER_HASH_MISMATCH:
-      return "BUS_VER_HASH_MISMATCH";
-    case BUS_VER_COMMIT_MISMATCH:
-      return "BUS_VER_COMMIT_MISMATCH";
-    default:
-      return "Unknown";
-  }
-}
+#include "ARCbus.h"
+#include "ARCbus_internal.h"
+
+//return error strings for error code
+const char *BUS_error_str(int error){
+  //check for error
+  switch(error){
+    case RET_SUCCESS:
+      return "SUCCESS";
+    case ERR_BAD_LEN:
+      return "ERROR BAD LENGTH";
+    case ERR_CMD_NACK:
+      return "ERROR COMMAND NON-ACKNOWLEDGEMENT";
+    case ERR_I2C_NACK:
+      return "ERROR I2C NON-ACKNOWLEDGEMENT";
+    case ERR_UNKNOWN:
+      return "ERROR UNKNOWN";
+    case ERR_BAD_ADDR:
+      return "ERROR BAD ADDRESS";
+    case ERR_BAD_CRC:
+      return "ERROR BAD CRC";
+    case ERR_TIMEOUT:
+      return "ERROR TIMEOUT";
+    case ERR_BUSY:
+      return "ERROR DEVICE OR RESOURCE BUSY";
+    case ERR_INVALID_ARGUMENT:
+      return "ERROR INVALID ARGUMENT";
+    case ERR_PACKET_TOO_LONG:
+      return "ERROR PACKET TOO LONG";
+    case ERR_I2C_ABORT:
+      return "ERROR I2C Transaction Aborted";
+    case ERR_TIME_INVALID:
+      return "ERROR TICKER TIME IS NOT VALID";
+    case ERR_TIME_TOO_OLD:
+      return "ERROR TICKER TIME IS TOO OLD";
+    case ERR_I2C_CLL:
+      return "ERROR I2C Clock Low Timeout";
+    case ERR_I2C_START_TIMEOUT:
+      return "ERROR I2C start timeout";
+    case ERR_I2C_TX_SELF:
+      return "ERROR TX to self";
+    case ERR_DMA_TIMEOUT:
+      return "ERROR DMA timeout";
+    //Error was not found
+    default:
+      return "UNKNOWN ERROR";
+  }
+}
+
+const char* BUS_cmdtostr(unsigned char cmd){
+  switch(cmd){
+    case CMD_NACK:
+      return "Nack";
+    case CMD_SPI_COMPLETE:
+      return "SPI Complete";
+    case CMD_SPI_RDY:
+      return "SPI Ready";
+    case CMD_SUB_ON:
+      return "Subsystem On";
+    case CMD_SUB_OFF:
+      return "Subsystem Off";
+    case CMD_SUB_POWERUP:
+      return "Subsystem Powerup";
+    case CMD_RESET:
+      return "Reset";
+    case CMD_SUB_STAT:
+      return "Subsystem Stat";
+    case CMD_SPI_CLEAR:
+      return "SPI Clear";
+    case CMD_EPS_STAT:
+      return "EPS Status";
+    case CMD_LEDL_STAT:
+      return "LEDL Status";
+    case CMD_ACDS_STAT:
+      return "ACDS Status";
+    case CMD_COMM_STAT:
+      return "COMM Status";
+    case CMD_IMG_STAT:
+      return "IMG Status";
+    case CMD_ASYNC_SETUP:
+      return "Async Setup";
+    case CMD_ASYNC_DAT:
+      return "Async Data";
+    case CMD_SPI_DATA_ACTION:
+      return "SPI Data Action";
+    case CMD_PING:
+        return "CMD_PING";
+    case CMD_MAG_DATA:
+        return "CMD_MAG_DATA";
+    case CMD_MAG_SAMPLE_CONFIG:
+        return "CMD_MAG_SAMPLE_CONFIG";
+    case CMD_ERR_REQ:
+        return "CMD_ERR_REQ";
+    case CMD_IMG_READ_PIC:
+        return "CMD_IMG_READ_PIC";
+    case CMD_IMG_TAKE_TIMED_PIC:
+        return "CMD_IMG_TAKE_TIMED_PIC";
+    case CMD_IMG_TAKE_PIC_NOW:
+        return "CMD_IMG_TAKE_PIC_NOW";
+    case CMD_GS_DATA:
+        return "CMD_GS_DATA";
+    case CMD_TEST_MODE:
+        return "CMD_TEST_MODE";
+    case CMD_BEACON_ON:
+        return "CMD_BEACON_ON";
+    case CMD_ACDS_CONFIG:
+        return "CMD_ACDS_CONFIG";
+    case CMD_IMG_CLEARPIC:
+        return "CMD_IMG_CLEARPIC";
+    case CMD_LEDL_READ_BLOCK:
+        return "CMD_LEDL_READ_BLOCK";
+    case CMD_ACDS_READ_BLOCK:
+        return "CMD_ACDS_READ_BLOCK";
+    case CMD_EPS_SEND:
+        return "CMD_EPS_SEND";
+    case CMD_LEDL_BLOW_FUSE:
+        return "CMD_LEDL_BLOW_FUSE";
+    case CMD_SPI_ABORT:
+        return "CMD_SPI_ABORT";
+    case CMD_MULTI:
+        return "CMD_MULTI";
+    case CMD_BUS_SPEED:
+        return "CMD_BUS_SPEED";
+    case CMD_SPI_QUEUED:
+        return "CMD_SPI_QUEUED";
+    case CMD_SPI_GO:
+        return "CMD_SPI_GO";
+    case CMD_FRAG:
+        return "CMD_FRAG";
+    case CMD_RPC:
+        return "CMD_RPC";
+    case CMD_RPC_RESP:
+        return "CMD_RPC_RESP";
+    case CMD_SEQ:
+        return "CMD_SEQ";
+    case CMD_SEQ_NACK:
+        return "CMD_SEQ_NACK";
+    case CMD_SEQ_ACK:
+        return "CMD_SEQ_ACK";
+    default:
+      return "Unknown";
+  }
+}
+
+const char* BUS_cmd_resptostr(unsigned char resp){
+  switch(resp){
+    case RET_SUCCESS:
+      return "Success";
+    case ERR_PK_LEN:
+      return "Error Invalid Packet Length";
+    case ERR_UNKNOWN_CMD:
+      return "Error Unknown Command";
+    case ERR_SPI_LEN:
+      return "Error SPI Block Length";
+    case ERR_BAD_PK:
+      return "Error Bad Packet";
+    case ERR_SPI_BUSY:
+      return "Error SPI busy";
+    case ERR_BUFFER_BUSY:
+      return "Error Buffer Busy";
+    case ERR_ILLEAGLE_COMMAND:
+      return "Error Illeagle Command";
+    case ERR_SPI_NOT_RUNNING:
+      return "Error SPI not running";
+    case ERR_SPI_WRONG_ADDR:
+      return "Error SPI wrong address";
+    case ERR_PK_BAD_PARM:
+      return "Error Bad parameter";
+    case ERR_SPI_LZ:
+      return "Error SPI decompression";
+    case ERR_SEQ_NO_ACK:
+      return "Error sequenced command not acknowledged";
+    default:
+      return "Unknown";
+  }
+}
+
+const char* bus_flags_tostr(unsigned char flags){
+  switch(flags){
+    case BUS_FLAGS_INVALID_ADDR:
+      return "BUS_FLAGS_INVALID_ADDR";
+    case BUS_FLAGS_ADDR_DISABLED:
+      return "BUS_FLAGS_ADDR_DISABLED";
+    default:
+      return "Unknown";
+  }
+}
+
+const char * bus_version_err_tostr(signed char resp){
+  switch(resp){
+    case BUS_VER_SAME:
+      return "BUS_VER_SAME";
+    case BUS_VER_INVALID_MAJOR_REV:
+      return "BUS_VER_INVALID_MAJOR_REV";
+    case BUS_VER_MAJOR_REV_OLDER:
+      return "BUS_VER_MAJOR_REV_OLDER";
+    case BUS_VER_MAJOR_REV_NEWER:
+      return "BUS_VER_MAJOR_REV_NEWER";
+    case BUS_VER_INVALID_MINOR_REV:
+      return "BUS_VER_INVALID_MINOR_REV";
+    case BUS_VER_MINOR_REV_OLDER:
+      return "BUS_VER_MINOR_REV_OLDER";
+    case BUS_VER_MINOR_REV_NEWER:
+      return "BUS_VER_MINOR_REV_NEWER";
+    case BUS_VER_DIRTY_REV:
+      return "BUS_VER_DIRTY_REV";
+    case BUS_VER_HASH_MISMATCH:
+      return "BUS_VER_HASH_MISMATCH";
+    case BUS_VER_COMMIT_MISMATCH:
+      return "BUS_VER_COMMIT_MISMATCH";
+    default:
+      return "Unknown";
+  }
+}
@@ -1,869 +1,2520 @@
-#include <ctl.h>
-#include <msp430.h>
-#include <stdlib.h>
-#include <string.h>
-#include "timerA.h"
-#include "ARCbus.h"
-#include "crc.h"
-#include "spi.h"
-#include <Error.h>
-#include "ARCbus_internal.h"
-
-//record error function, used to save an error without it cluttering up the terminal
-void record_error(unsigned char level,unsigned short source,int err, unsigned short argument,ticker time);
-
-//bus internal events
-CTL_EVENT_SET_t BUS_INT_events,BUS_helper_events;
-
-//task structure for idle task and ARC bus task
-CTL_TASK_t idle_task,ARC_bus_task,ARC_bus_helper_task;
-
-//stack for ARC bus task
-unsigned BUS_stack[256],helper_stack[250];
-
-BUS_STAT arcBus_stat;
-
-//events for subsystems
-CTL_EVENT_SET_t SUB_events;
-
-//address of SPI slave during transaction
-static unsigned char SPI_addr=0;
-
-static void ARC_bus_helper(void *p);
-
-static struct{
-    CTL_MUTEX_t mutex;
-    unsigned short size;
-    unsigned char type;
-    unsigned char level;
-    unsigned char dest;
-}err_req;
-
-//struct for NACK info
-//This is used to setup a NACK packet in the bus task and have it sent by the bus helper task
-//no mutex is used but address is used to indicate busy status. This only works if no other threads use this structure
-static struct{
-  unsigned char addr;
-  unsigned char dat[BUS_I2C_HDR_LEN+2+BUS_I2C_CRC_LEN];
-}nack_info;
-
-
-//power state of subsystem
-unsigned short powerState=SUB_PWR_OFF;
-
-//pointer to linked list of command parse functions
-//nodes in the list are sorted by priority
-//this node is the first in the list (or NULL for an empty list)
-//the last node in the list has next set to NULL
-CMD_PARSE_DAT *cmd_parse_list=NULL;
-
-//register callback
-//insert the callback structure in the linked list based on priority
-void BUS_register_cmd_callback(CMD_PARSE_DAT *cb_dat){
-  //get a pointer to the current list head
-  CMD_PARSE_DAT **head=&cmd_parse_list;
-  //find insertion point.
-  //This should be where *head points to a node with greater priority (or the beginning)
-  //and *head->next points to a node with lower priority (or the end)
-  while(*head!=NULL && (*head)->priority>cb_dat->priority){
-    //move head to the next element in the list
-    head= &(*head)->next;
-  }
-  //link to lower priority callbacks
-  cb_dat->next=*head;
-  //link in this callback
-  *head=cb_dat;
-}
-#define BUS_VERSION_LEN         (sizeof(BUS_VERSION)+BUS_VERSION_HASH_LEN)
-#define BUS_VERSION_MINOR_DIG   (4)     //maximum digits in minor version
-#define BUS_VERSION_HASH_LEN    (13)    //maximum length of hash that is sent
-
-
-//compare versions and report error if they are different
-char BUS_version_cmp(const BUS_VERSION* other,unsigned char len){
-  //first check that length is long enough
-  if(len<sizeof(BUS_VERSION)){
-    //return error
-    return BUS_VER_LENGTH;
-  }
-  //check for valid major versions
-  if(other->major==BUS_INVALID_MAJOR_VER || ARClib_vstruct.major==BUS_INVALID_MAJOR_VER){
-    //report error
-    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_INVALID_MAJOR,(ARClib_vstruct.major==BUS_INVALID_MAJOR_VER?VERSION_ERR_INVALID_MINE:0)|(other->major==BUS_INVALID_MAJOR_VER?VERSION_ERR_INVALID_OTHER:0));
-    //return, a major version is invalid, can't continue
-    return BUS_VER_INVALID_MAJOR_REV;
-  }
-  //compare major versions
-  if(other->major!=ARClib_vstruct.major){
-    //versions diffe, check which one is older
-    if(other->major>ARClib_vstruct.major){
-      //report error
-      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_MAJOR_REV_NEWER,other->major);
-      //other version is newer
-      return BUS_VER_MAJOR_REV_NEWER;
-    }else{
-      //report error
-      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_MAJOR_REV_OLDER,other->major);
-      //other version is older
-      return BUS_VER_MAJOR_REV_NEWER;
-    }
-  }
-  //check for valid minor versions
-  if(other->minor==BUS_INVALID_MINOR_VER || ARClib_vstruct.minor==BUS_INVALID_MINOR_VER){
-    //report error
-    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_INVALID_MINOR,(ARClib_vstruct.minor==BUS_INVALID_MINOR_VER?VERSION_ERR_INVALID_MINE:0)|(other->minor==BUS_INVALID_MINOR_VER?VERSION_ERR_INVALID_OTHER:0));
-    //return, a major version is invalid, can't continue
-    return BUS_VER_INVALID_MINOR_REV;
-  }
-  //compare minor versions
-  if(other->minor!=ARClib_vstruct.minor){
-    //versions diffe, check which one is older
-    if(other->minor>ARClib_vstruct.minor){
-      //report error
-      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_MINOR_REV_NEWER,other->minor);
-      //other version is newer
-      return BUS_VER_MINOR_REV_NEWER;
-    }else{
-      //report error
-      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_MINOR_REV_OLDER,other->minor);
-      //other version is older
-      return BUS_VER_MINOR_REV_OLDER;
-    }
-  }
-  //check dirty flags
-  if(other->dty!=BUS_VER_CLEAN || ARClib_vstruct.dty!=BUS_VER_CLEAN){
-    //report error
-    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_DIRTY_REV,(((unsigned short)ARClib_vstruct.dty)<<8)|(other->dty));
-    //one version is dirty, there is no way to tell if they are the same
-    return BUS_VER_DIRTY_REV;
-  }
-  //compare hashes
-  if(strncmp(other->hash,ARClib_vstruct.hash,len-sizeof(BUS_VERSION))){
-    //report error
-    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_HASH_MISMATCH,0);
-    //hashes are different
-    return BUS_VER_HASH_MISMATCH;
-  }
-  //check string length of hash to make sure the full hash was compared
-  if(strlen(ARClib_vstruct.hash)+sizeof(BUS_VERSION)>len){
-    //compare the number of commits between versioned commit and the current one
-    if(other->commits!=ARClib_vstruct.commits){
-      //report error
-      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_COMMIT_MISMATCH,other->commits);
-      //different number of commits, different commits
-      return BUS_VER_COMMIT_MISMATCH;
-    }
-    //otherwise versions are probably the same
-  }
-  return BUS_VER_SAME;
-}
-
-//ARC bus Task, do ARC bus stuff
-static void ARC_bus_run(void *p) __toplevel{
-  unsigned int e;
-  unsigned char len;
-  unsigned char addr,cmd,flags;
-  int resp;
-  unsigned char pk[40];
-  unsigned char *ptr;
-  unsigned short crc;
-  unsigned char *SPI_buf=NULL;
-  ticker nt,ot;
-  int snd,i;
-  unsigned char parse_mask;
-  #ifdef CDH_LIB
-  //temporary array for bus version comparison, needed for alignment reasons
-  unsigned short tmp[(BUS_VERSION_LEN+1)/sizeof(unsigned short)];
-  #endif
-  CMD_PARSE_DAT *parse_ptr;
-  SPI_addr=0;
-  //Initialize ErrorLib
-  error_recording_start();
-  //init error request mutex
-  ctl_mutex_init(&err_req.mutex);
-  //initialize helper events
-  ctl_events_init(&BUS_helper_events,0);
-  //start helper task
-  ctl_task_run(&ARC_bus_helper_task,BUS_PRI_ARCBUS_HELPER,ARC_bus_helper,NULL,"ARC_Bus_helper",sizeof(helper_stack)/sizeof(helper_stack[0])-2,helper_stack+1,0);
-  
-  //event loop
-  for(;;){
-    //wait for something to happen
-    e = ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&BUS_INT_events,BUS_INT_EV_ALL,CTL_TIMEOUT_NONE,0);
-    //check if buffer can be unlocked
-    if(e&BUS_INT_EV_BUFF_UNLOCK){
-      SPI_buf=NULL;
-      //unlock buffer
-      BUS_free_buffer();
-    }
-    //check if I2C mutex can be released
-    if(e&BUS_INT_EV_RELEASE_MUTEX){
-      //release I2C mutex
-      BUS_I2C_release();
-    }
-    //check if a SPI transaction is complete
-    if(e&BUS_INT_EV_SPI_COMPLETE){
-      //check if SPI was in progress
-      if(SPI_addr){
-        //turn off SPI
-        SPI_deactivate();
-        //assemble CRC
-        crc=SPI_buf[arcBus_stat.spi_stat.len+1];//LSB
-        crc|=(((unsigned short)SPI_buf[arcBus_stat.spi_stat.len])<<8);//MSB
-        //check CRC
-        if(crc!=crc16(SPI_buf,arcBus_stat.spi_stat.len)){
-          //Bad CRC
-          //clear buffer pointer
-          SPI_buf=NULL;
-          //free buffer
-          BUS_free_buffer();
-          //send event
-          ctl_events_set_clear(&SUB_events,SUB_EV_SPI_ERR_CRC,0);
-          //set return value for SPI complete packet
-          arcBus_stat.spi_stat.nack=ERR_BAD_CRC;
-        }else{
-          //tell subsystem, SPI data received
-          //Subsystem must signal to free the buffer
-          ctl_events_set_clear(&SUB_events,SUB_EV_SPI_DAT,0);
-          //set return value for SPI complete packet
-          arcBus_stat.spi_stat.nack=RET_SUCCESS;
-        }
-        //tell helper thread to send SPI complete command
-        ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_SPI_COMPLETE_CMD,0);
-      }
-    }
-    //check if an I2C command has been received
-    if(e&BUS_INT_EV_I2C_CMD_RX){
-        //check if packet is complete
-        if(I2C_rx_buf[I2C_rx_out].stat!=I2C_PACKET_STAT_COMPLETE){
-            //report error
-            report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_RX_BUF_STAT,I2C_rx_buf[I2C_rx_out].stat);
-            //disable interrupts
-            ctl_global_interrupts_set(0);
-            //put UCB0 into reset state
-            UCB0CTL1|=UCSWRST;   
-            //initialize I2C packet queue to empty state
-            for(i=0;i<BUS_I2C_PACKET_QUEUE_LEN;i++){
-                I2C_rx_buf[i].stat=I2C_PACKET_STAT_EMPTY;
-            }
-            //I2C mutex init
-            ctl_mutex_init(&arcBus_stat.i2c_stat.mutex);
-            //set I2C to idle mode
-            arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
-            //initialize I2C packet queue pointers
-            I2C_rx_in=I2C_rx_out=0;
-            //bring UCB0 out of reset state
-            UCB0CTL1&=~UCSWRST;
-            //re-enable interrupts
-            ctl_global_interrupts_enable();
-        }else{
-        //clear response
-        resp=0;
-        //get len
-        len=I2C_rx_buf[I2C_rx_out].len;
-        //compute crc
-        crc=crc7(I2C_rx_buf[I2C_rx_out].dat,len-1);
-        //get length of payload
-        len=len-BUS_I2C_CRC_LEN-BUS_I2C_HDR_LEN;
-        //get sender address
-        addr=CMD_ADDR_MASK&I2C_rx_buf[I2C_rx_out].dat[0];
-        //get packet flags
-        flags=I2C_rx_buf[I2C_rx_out].flags;
-        //get command type
-        cmd=I2C_rx_buf[I2C_rx_out].dat[1];
-        //point to the first payload byte
-        ptr=&I2C_rx_buf[I2C_rx_out].dat[2];
-        //check crc for packet
-        if(ptr[len]==crc){
-          //handle command based on command type
-          switch(cmd){
-            case CMD_SUB_ON:            
-                //check for proper length
-                if(len!=0){
-                  resp=ERR_PK_LEN;
-                }
-                //set new power status
-                powerState=SUB_PWR_ON;
-                //inform subsystem
-                ctl_events_set_clear(&SUB_events,SUB_EV_PWR_ON,0);
-            break;
-            case CMD_SUB_OFF:
-              //check to make sure that the command is directed to this subsystem
-              if(len==1 && BUS_OA_check(ptr[0])==RET_SUCCESS){
-                //set new power status
-                powerState=SUB_PWR_OFF;
-                //inform subsystem
-                ctl_events_set_clear(&SUB_events,SUB_EV_PWR_OFF,0);
-              }else{
-                //error with command
-                resp=ERR_BAD_PK;
-              }
-            break;
-            case CMD_SUB_STAT:
-              //check for proper length
-              if(len!=4){
-                resp=ERR_PK_LEN;
-              }                
-              #ifndef CDH_LIB //only update time on subsystem boards
-                  //assemble time from packet
-                  nt=ptr[3];
-                  nt|=((ticker)ptr[2])<<8;
-                  nt|=((ticker)ptr[1])<<16;
-                  nt|=((ticker)ptr[0])<<24;
-                  //update time
-                  ot=setget_ticker_time(nt);
-                  //tell subsystem to send status
-                  ctl_events_set_clear(&SUB_events,SUB_EV_SEND_STAT,0);
-                  //trigger any alarms that were skipped
-                  BUS_alarm_ticker_update(nt,ot);
-              #else
-                  //if CMD_SUB_STAT is recived by CDH, report an error
-                  report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_CDH_SUB_STAT_REC,addr);
-                  resp=ERR_ILLEAGLE_COMMAND;
-              #endif
-            break;
-            case CMD_RESET:          
-              //check for proper length
-              if(len!=0){
-                resp=ERR_PK_LEN;
-              }
-              //reset msp430
-              reset(ERR_LEV_INFO,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_RESET,0);
-              //code should never get here, report error
-              report_error(ERR_LEV_CRITICAL,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_RESET_FAIL,0);
-              break;
-            case CMD_SPI_RDY:
-              //check length
-              if(len!=2){
-                resp=ERR_PK_LEN;
-                break;
-              }
-              //assemble length
-              arcBus_stat.spi_stat.len=ptr[1];//LSB
-              arcBus_stat.spi_stat.len|=(((unsigned short)ptr[0])<<8);//MSB
-              //check length account for 16bit CRC
-              if(arcBus_stat.spi_stat.len+2>BUS_get_buffer_size()){
-                //length is too long
-                //cause NACK to be sent
-                resp=ERR_SPI_LEN;
-                break;
-              }
-              //check if already transmitting
-              if(SPI_buf!=NULL){
-                resp=ERR_SPI_BUSY;
-                break;
-              }
-              SPI_buf=BUS_get_buffer(CTL_TIMEOUT_NOW,0);
-              //check if buffer was locked
-              if(SPI_buf==NULL){
-                //buffer locked, set event
-                ctl_events_set_clear(&SUB_events,SUB_EV_SPI_ERR_BUSY,0);
-                //set response
-                resp=ERR_BUFFER_BUSY;
-                //stop SPI setup
-                break;
-              }
-              //disable DMA
-              DMA0CTL&=~DMAEN;
-              DMA1CTL&=~DMAEN;
-              DMA2CTL&=~DMAEN;
-              //save address of SPI slave
-              SPI_addr=addr;
-              //setup SPI structure
-              arcBus_stat.spi_stat.rx=SPI_buf;
-              arcBus_stat.spi_stat.tx=NULL;
-              //Setup SPI bus to exchange data as master
-              SPI_master_setup();
-              //============[setup DMA for transfer]============
-              //setup source trigger
-              DMACTL0 &=~(DMA0TSEL_31|DMA1TSEL_31);
-              DMACTL0 |= (DMA0TSEL__USCIA0RX|DMA1TSEL__USCIA0TX);
-              DMACTL1 = DMA2TSEL__USCIA0RX;
-              //DMA9 workaround, use a dummy channel with lower priority and the same trigger
-              //setup dummy channel: read and write from unused space in the SPI registers
-              *((unsigned int*)&DMA2SA) = EUSCI_A0_BASE + 0x02;
-              *((unsigned int*)&DMA2DA) = EUSCI_A0_BASE + 0x04;
-              // only one byte
-              DMA2SZ = 1;
-              // Configure the DMA transfer, repeated byte transfer with no increment
-              DMA2CTL = DMADT_4|DMASBDB|DMAEN|DMASRCINCR_0|DMADSTINCR_0;
-
-              // Source DMA address: receive register.
-              *((unsigned int*)&DMA0SA) = (unsigned short)(&UCA0RXBUF);
-              // Destination DMA address: rx buffer.
-              *((unsigned int*)&DMA0DA) = (unsigned short)SPI_buf;
-              // The size of the block to be transferred
-              DMA0SZ = arcBus_stat.spi_stat.len+BUS_SPI_CRC_LEN;
-              // Configure the DMA transfer, single byte transfer with destination increment
-              DMA0CTL = DMAIE|DMADT_0|DMASBDB|DMAEN|DMASRCINCR_0|DMADSTINCR_3;
-
-              // Source DMA address: SPI transmit buffer, constant data will be sent
-              *((unsigned int*)&DMA1SA) = (unsigned int)(&UCA0TXBUF);
-              // Destination DMA address: the transmit buffer.
-              *((unsigned int*)&DMA1DA) = (unsigned int)(&UCA0TXBUF);
-              // The size of the block to be transferred
-              DMA1SZ = arcBus_stat.spi_stat.len+BUS_SPI_CRC_LEN-1;
-              // Configure the DMA transfer, single byte transfer with no increment
-              DMA1CTL=DMADT_0|DMASBDB|DMAEN|DMASRCINCR_0|DMADSTINCR_0;
-              //write the Tx buffer to start transfer
-              UCA0TXBUF=BUS_SPI_DUMMY_DATA;
-            break;
-            
-            case CMD_SPI_ABORT:
-              //check length
-              if(len!=0){
-                resp=ERR_PK_LEN;
-                break;
-              }
-              //check SPI mode
-              if(arcBus_stat.spi_stat.mode!=BUS_SPI_MASTER){
-                resp=ERR_SPI_NOT_RUNNING;
-                break;
-              }
-              //check SPI address
-              if(SPI_addr!=addr){
-                resp=ERR_SPI_WRONG_ADDR;
-                break;
-              }
-              //disable DMA
-              DMA0CTL&=~DMAEN;
-              DMA1CTL&=~DMAEN;
-              DMA2CTL&=~DMAEN;
-              //turn off SPI
-              SPI_deactivate();              
-              //clear buffer pointer
-              SPI_buf=NULL;
-              //free buffer
-              BUS_free_buffer();
-              //clear address
-              SPI_addr=0;
-              //retport error
-              report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_SPI_ABORT,addr);
-            break;
-
-            case CMD_SPI_COMPLETE:
-              //check length
-              if(len!=1){
-                resp=ERR_PK_LEN;
-                break;
-              }
-#ifndef CDH_LIB
-              //check if a SPI transaction was in progress
-              if(arcBus_stat.spi_stat.mode!=BUS_SPI_SLAVE){
-#else
-              //check if a SPI transaction was in progress
-              if(arcBus_stat.spi_stat.mode!=BUS_SPI_MASTER && arcBus_stat.spi_stat.mode!=BUS_SPI_SLAVE){
-#endif
-                //SPI is in the wrong state so send busy error
-                resp=ERR_SPI_NOT_RUNNING;
-                //send NACK
-                break;
-              }
-
-              //check that the command came from the correct subsystem
-              if(arcBus_stat.spi_stat.mode==BUS_SPI_MASTER && SPI_addr!=addr){
-                  //wrong address sent for complete command
-                  resp=ERR_SPI_WRONG_ADDR;
-                  //send NACK
-                  break;
-              }
-              //disable DMA
-              DMA0CTL&=~DMAEN;
-              DMA1CTL&=~DMAEN;
-              DMA2CTL&=~DMAEN;
-              //turn off SPI
-              SPI_deactivate();
-              //SPI transfer is done, see if there was an error
-              arcBus_stat.spi_stat.nack=ptr[0];
-              //notify CDH board
-#ifndef CDH_LIB
-              ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_SPI_CLEAR_CMD,0);
-#endif
-              //notify calling task
-              ctl_events_set_clear(&arcBus_stat.events,BUS_EV_SPI_COMPLETE,0);
-            break;
-            case CMD_ASYNC_SETUP:
-              //check length
-              if(len!=1){
-                resp=ERR_PK_LEN;
-                break;
-              }
-              switch(ptr[0]){
-                case ASYNC_OPEN:
-                  //open remote connection
-                  async_open_remote(addr);
-                break;
-                case ASYNC_CLOSE:
-                  //check if sending address corosponds to async address
-                  if(async_addr!=addr){
-                    //report error
-                    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_ASYNC,ASYNC_ERR_CLOSE_WRONG_ADDR,(((unsigned short)addr)<<8)|async_addr);
-                    break;
-                  }
-                  //tell helper thread to close connection
-                  ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ASYNC_CLOSE,0);
-                break;
-              }
-            break;
-            case CMD_ASYNC_DAT:
-              //post bytes to queue
-              ctl_byte_queue_post_multi_nb(&async_rxQ,len,ptr);
-            break;
-            case CMD_NACK:
-              //TODO: handle this better somehow?
-              //check length
-              if(len!=2){
-                resp=ERR_PK_LEN;
-                break;
-              }
-              //set event 
-              ctl_events_set_clear(&arcBus_stat.events,BUS_EV_CMD_NACK,0);
-              //report error
-              report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_NACK_REC,(((unsigned short)ptr[0])<<8)|((unsigned short)ptr[1]));
-              //check which packet was nacked
-              switch(ptr[0]){
-                  case CMD_SPI_RDY:
-                    //set SPI nack reason
-                    arcBus_stat.spi_stat.nack=ptr[1];
-                    //send event to spi code
-                    ctl_events_set_clear(&arcBus_stat.events,BUS_EV_SPI_NACK,0);
-                  break;
-              }
-            break;
-            case CMD_ERR_REQ:
-              if(len<1){
-                resp=ERR_PK_LEN;
-                break;
-              }
-              if(!ctl_mutex_lock(&err_req.mutex,CTL_TIMEOUT_NOW,0)){
-                resp=ERR_BUSY;
-                break;
-              }
-              //request type
-              err_req.type=ptr[0];
-              //address to send data to
-              err_req.dest=addr;
-              switch(ptr[0]){
-                case ERR_REQ_REPLAY:
-                    err_req.size=(((unsigned short)ptr[1])<<8)|((unsigned short)ptr[2]);
-                    err_req.level=ptr[3];
-                break;
-                default:
-                    resp=ERR_INVALID_ARGUMENT;
-                break;
-              }
-              //check if the packet was parsed
-              if(!resp){
-                //send event to process request
-                ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ERR_REQ,0);
-              }
-            ctl_mutex_unlock(&err_req.mutex);
-            break;
-            case CMD_PING:
-                //this is a dummy command that does nothing
-            break;
-            default:
-            #ifdef CDH_LIB
-              if(cmd==CMD_SUB_POWERUP){
-                char vresp;
-                //copy into temporary word aligned variable
-                memcpy(tmp,ptr,len);
-                //compare to version string
-                if((vresp=BUS_version_cmp((BUS_VERSION*)tmp,len))){
-                    //version mismatch
-                    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SUBSYSTEM_VERSION_MISMATCH,(((unsigned short)vresp)<<8)|addr);
-                }
-                //set length to zero
-                len=0;
-              }
-            #endif
-              //get callback structure list
-              parse_ptr=cmd_parse_list;
-              //get mask from packet flags
-              parse_mask=flags;
-              //set response to unknown command
-              resp=ERR_UNKNOWN_CMD;
-              //loop through list and check for commands
-              while(parse_ptr!=NULL && resp==ERR_UNKNOWN_CMD){                
-                //check if flags match
-                if(parse_ptr->flags&parse_mask){
-                  //check for subsystem command
-                  resp=parse_ptr->cb(addr,cmd,ptr,len,flags);
-                }
-                //get next callback structure
-                parse_ptr=parse_ptr->next;
-              }
-            break;
-          }
-          //check if command was recognized
-          if(resp!=0){
-            report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_BAD_CMD,(((unsigned short)resp)<<8)|((unsigned short)cmd));
-            //check packet to see if NACK should be sent
-            if(I2C_rx_buf[I2C_rx_out].dat[0]&CMD_TX_NACK){
-              //check NACK address to see if a nack can be sent
-              if(nack_info.addr==0){
-                //set address
-                nack_info.addr=addr;
-                //setup command
-                ptr=BUS_cmd_init(nack_info.dat,CMD_NACK);
-                //sent command
-                *ptr++=cmd;
-                //send NACK reason
-                *ptr++=resp;
-                //tell helper thread to send packet
-                ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_NACK,0);
-              }else{
-                //can't send nack, report error
-                report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_NACK_BUSY,(((unsigned short)addr)<<8)|resp);
-              }
-            }
-          }
-        }else{
-          //CRC failed, report error
-          report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_CMD_CRC,cmd);
-          //if command was not a NACK command send NACK
-          if(cmd!=CMD_NACK){
-            //check NACK address to see if a nack can be sent
-            if(nack_info.addr==0){
-              //set address
-              nack_info.addr=addr;
-              //setup command
-              ptr=BUS_cmd_init(nack_info.dat,CMD_NACK);
-              //sent command
-              *ptr++=cmd;
-              //send NACK reason
-              *ptr++=ERR_BAD_CRC;
-              //tell helper thread to send packet
-              ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_NACK,0);
-            }else{
-              //can't send nack, report error
-              report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_NACK_BUSY,(((unsigned short)addr)<<8)|ERR_BAD_CRC);
-            }
-          }
-        }
-        //done with packet set status
-        I2C_rx_buf[I2C_rx_out].stat=I2C_PACKET_STAT_EMPTY;
-        //increment index
-        I2C_rx_out++;
-        //check for wraparound
-        if(I2C_rx_out>=BUS_I2C_PACKET_QUEUE_LEN){
-          I2C_rx_out=0;
-        }
-        //check next packet status
-        if(I2C_rx_buf[I2C_rx_out].stat==I2C_PACKET_STAT_COMPLETE){   
-          //There is still a packet set event again
-          ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_CMD_RX,0);
-        }
-      }
-    }
-    //check for errors and report
-    if(e&BUS_INT_EV_I2C_RX_BUSY){
-      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_I2C_RX_BUSY,0);
-    }
-    if(e&BUS_INT_EV_I2C_ARB_LOST){
-      report_error(ERR_LEV_DEBUG,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_I2C_ARB_LOST,0);
-    }
-    //Low side supply error
-    if(e&BUS_INT_EV_SVML){
-      //report error
-      report_error(ERR_LEV_CRITICAL,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SVML,0);
-    }
-    //high side supply error
-    if(e&BUS_INT_EV_SVMH){
-      //report error
-      report_error(ERR_LEV_CRITICAL,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SVMH,0);
-    }
-  }
-}
-    
-    
-//ARC bus Task, do ARC bus stuff
-static void ARC_bus_helper(void *p) __toplevel{
-  unsigned int e;
-  int resp,maxsize;
-  unsigned char *ptr,pk[BUS_I2C_HDR_LEN+BUS_VERSION_LEN+BUS_I2C_CRC_LEN];
-  unsigned short len;
-  #ifndef CDH_LIB         //Subsystem board 
-    //first send "I'm on" command
-    ptr=BUS_cmd_init(pk,CMD_SUB_POWERUP);//setup command
-    //copy in data part of struct
-    memcpy(ptr,&ARClib_vstruct,sizeof(BUS_VERSION));
-    //increment pointer
-    ptr+=sizeof(BUS_VERSION);
-    //write version into string
-    len=strlcpy((char*)ptr,ARClib_vstruct.hash,BUS_VERSION_HASH_LEN)+sizeof(BUS_VERSION);
-    //send command
-    resp=BUS_cmd_tx(BUS_ADDR_CDH,pk,len,0);
-      //check for failed send
-      if(resp!=RET_SUCCESS){
-        //give a warning
-        report_error(ERR_LEV_WARNING,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_CDH_NOT_FOUND,resp);
-        //wait a bit
-        ctl_timeout_wait(ctl_get_current_time()+30);
-        //resend
-        resp=BUS_cmd_tx(BUS_ADDR_CDH,pk,len,0);
-        //check for success
-        if(resp!=RET_SUCCESS){
-          //Failed
-          report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_CDH_NOT_FOUND,resp);     
-        }
-      }
-  #endif
-  for(;;){
-    e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&BUS_helper_events,BUS_HELPER_EV_ALL,CTL_TIMEOUT_NONE,0);
-    //async timer timed out, send data
-    if(e&BUS_HELPER_EV_ASYNC_TIMEOUT){
-      //send some data
-      async_send_data();
-    }
-    //SPI transaction is complete
-    if(e&BUS_HELPER_EV_SPI_COMPLETE_CMD){      
-      //done with SPI send command
-      ptr=BUS_cmd_init(pk,CMD_SPI_COMPLETE);
-      //send return to indicate success
-      *ptr=arcBus_stat.spi_stat.nack;
-      //send data
-      resp=BUS_cmd_tx(SPI_addr,pk,1,0);
-      //check if command was successful and try again if it failed
-      if(resp!=RET_SUCCESS){
-        resp=BUS_cmd_tx(SPI_addr,pk,1,0);
-      }
-      //check if command sent successfully
-      if(resp!=RET_SUCCESS){
-        //report error
-        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SPI_COMPLETE_FAIL,resp);
-      }
-      //transaction complete, clear address
-      SPI_addr=0;
-    }
-    if(e&BUS_HELPER_EV_SPI_CLEAR_CMD){
-      //done with SPI send command
-      BUS_cmd_init(pk,CMD_SPI_CLEAR);
-      resp=BUS_cmd_tx(BUS_ADDR_CDH,pk,0,0);
-      //check if command was successful and try again if it failed
-      if(resp!=RET_SUCCESS){
-        resp=BUS_cmd_tx(BUS_ADDR_CDH,pk,0,0);
-      }
-      //check if command sent successfully
-      if(resp!=RET_SUCCESS){
-        //report error
-        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SPI_CLEAR_FAIL,resp);
-      }
-    }
-    if(e&BUS_HELPER_EV_ASYNC_CLOSE){      
-      //close async connection
-      async_close_remote();
-      //send event
-      ctl_events_set_clear(&SUB_events,SUB_EV_ASYNC_CLOSE,0);
-    }
-    if(e&BUS_HELPER_EV_ERR_REQ){
-        //get mutex
-        if(ctl_mutex_lock(&err_req.mutex,CTL_TIMEOUT_DELAY,100)){
-            //get buffer
-            ptr=BUS_get_buffer(CTL_TIMEOUT_DELAY,100);
-            //check if buffer was aquired
-            if(ptr){
-              //set data type
-              ptr[0]=SPI_ERROR_DAT;
-              //set own address
-              ptr[1]=BUS_get_OA();
-              //get maximum size for data packet. part of the buffer is used to read errors into
-              maxsize=BUS_get_buffer_size()-512-2;
-              //check if requested size is greater then max
-              if(maxsize<err_req.size){
-                //set maxsize
-                err_req.size=maxsize;
-              }
-              //check request type
-              switch(err_req.type){
-                case ERR_REQ_REPLAY:
-                  //get errors
-                  error_log_mem_replay(ptr+2,err_req.size,err_req.level,ptr+2+maxsize);
-                break;
-              }
-              //send data
-              resp=BUS_SPI_txrx(err_req.dest,ptr,NULL,err_req.size+2);
-              //Check if data was sent
-              if(resp!=RET_SUCCESS){
-                  //report error
-                  report_error(ERR_LEV_ERROR,BUS_ERR_SRC_ERR_REQ,ERR_REQ_ERR_SPI_SEND,resp);
-              }
-              //free buffer
-              BUS_free_buffer();
-            }else{
-              //set flag so we try again
-              ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ERR_REQ,0);
-              //report error
-              report_error(ERR_LEV_ERROR,BUS_ERR_SRC_ERR_REQ,ERR_REQ_ERR_BUFFER_BUSY,0);
-            }
-            ctl_mutex_unlock(&err_req.mutex);
-        }else{
-          //set flag so we try again
-          ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ERR_REQ,0);
-          //report error
-          report_error(ERR_LEV_ERROR,BUS_ERR_SRC_ERR_REQ,ERR_REQ_ERR_MUTEX_TIMEOUT,0);
-        }
-    }
-    if(e&BUS_HELPER_EV_NACK){
-      //double check address
-      if(nack_info.addr){
-        //send the command
-        resp=BUS_cmd_tx(nack_info.addr,nack_info.dat,2,0);
-        //check response
-        if(resp!=RET_SUCCESS){
-          //error sending packet, report error
-          report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_TX_NACK_FAIL,resp);
-        }
-        //clear the address
-        nack_info.addr=0;
-      }else{
-        //no nack packet? report error
-        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_UNEXPECTED_NACK_EV,0);
-      }
-    }
-  }
-}
-
-//=======================================================================================
-//                                 [Main Loop]
-//=======================================================================================
-
-//main loop function, start ARC_Bus task then enter Idle task
-void mainLoop(void) __toplevel{
-  //initialize events
-  ctl_events_init(&BUS_INT_events,0);
-  //start ARCbus task
-  ctl_task_run(&ARC_bus_task,BUS_PRI_ARCBUS,ARC_bus_run,NULL,"ARC_Bus",sizeof(BUS_stack)/sizeof(BUS_stack[0])-2,BUS_stack+1,0);
-  //kick WDT to give us some time
-  WDT_KICK();
-  // drop to lowest priority to start created tasks running.
-  ctl_task_set_priority(&idle_task,0); 
-  
-  //main idle loop
-  //NOTE that this task should never wait to ensure that there is always a runnable task
-  for(;;){    
-    //kick watchdog
-    WDT_KICK();
-    //go to low power mode
-    LPM0;
-  }
-}
-
-//main loop testing function, start ARC_Bus task then enter Idle task
-void mainLoop_testing(void (*cb)(void)) __toplevel{
-  //initialize events
-  ctl_events_init(&BUS_INT_events,0);
-  //start ARCbus task
-  ctl_task_run(&ARC_bus_task,BUS_PRI_ARCBUS,ARC_bus_run,NULL,"ARC_Bus",sizeof(BUS_stack)/sizeof(BUS_stack[0])-2,BUS_stack+1,0);
-  //kick WDT to give us some time
-  WDT_KICK();
-  // drop to lowest priority to start created tasks running.
-  ctl_task_set_priority(&idle_task,0); 
-  
-  //main idle loop
-  //NOTE that this task should never wait to ensure that there is always a runnable task
-  for(;;){    
-      //call the callback
-      cb();
-  }
-}
+#include <ctl.h>
+#include <msp430.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timerA.h"
+#include "ARCbus.h"
+#include "crc.h"
+#include "spi.h"
+#include "compress.h"
+#include <Error.h>
+#include "ARCbus_internal.h"
+
+//record error function, used to save an error without it cluttering up the terminal
+void record_error(unsigned char level,unsigned short source,int err, unsigned short argument,ticker time);
+
+//bus internal events
+CTL_EVENT_SET_t BUS_INT_events,BUS_helper_events;
+
+//task structure for idle task and ARC bus task
+CTL_TASK_t idle_task,ARC_bus_task,ARC_bus_helper_task;
+
+//stack for ARC bus task
+unsigned BUS_stack[256],helper_stack[250];
+
+BUS_STAT arcBus_stat;
+
+//events for subsystems
+CTL_EVENT_SET_t SUB_events;
+
+//address of SPI slave during transaction
+static unsigned char SPI_addr=0;
+
+//buffer used for SPI master transaction
+static unsigned char *SPI_buf=NULL;
+
+//registered buffers for SPI receive
+static BUS_SPI_RX_DEST *SPI_rx_list=NULL;
+//registered buffer used for the current SPI master transaction
+static BUS_SPI_RX_DEST *SPI_dest=NULL;
+//set if the current SPI master transaction is compressed
+static unsigned char SPI_lz=0;
+
+//data to send back to a board the next time it sends SPI data
+typedef struct{
+  const unsigned char *buf;
+  unsigned short len;
+  //event to set once data is sent
+  CTL_EVENT_SET_t *e;
+  CTL_EVENT_SET_t event;
+  //address to send to, zero if unused
+  unsigned char addr;
+}SPI_REPLY;
+
+//SPI reply data
+static SPI_REPLY SPI_reply[BUS_SPI_REPLY_NUM];
+//reply being sent in the current SPI master transaction
+static SPI_REPLY *SPI_reply_cur=NULL;
+//buffer that reply data is sent from
+static unsigned char *SPI_tx_buf=NULL;
+//set if the current SPI master transaction can receive data, reply length is sent in CMD_SPI_COMPLETE
+static unsigned char SPI_duplex=0;
+//length of reply sent in the current SPI master transaction
+static unsigned short SPI_reply_len=0;
+
+//chunked SPI receive states
+enum{SPI_CHUNK_IDLE=0,SPI_CHUNK_RUN,SPI_CHUNK_RESEND};
+
+//chunked SPI receive state, each chunk has its own CRC so only bad chunks are sent again
+static struct{
+  //address of sending board
+  unsigned char addr;
+  //chunk length and number of chunks
+  unsigned char chunk,num;
+  //chunk being received
+  unsigned char cur;
+  //length of data
+  unsigned short len;
+  //chunks to receive in this transfer
+  unsigned long want;
+  //chunks that had bad CRCs
+  unsigned long bad;
+  //receive state
+  unsigned char stat;
+}SPI_chunk;
+
+//SPI transfer waiting for the SPI master
+typedef struct{
+  unsigned char addr;
+  unsigned char pri;
+}SPI_REQ;
+
+//queue of waiting SPI transfers sorted by priority
+static SPI_REQ SPI_queue[BUS_SPI_QUEUE_LEN];
+static unsigned char SPI_queue_num=0;
+//priority of SPI transfers from each address
+static unsigned char SPI_pri[128];
+//address of the board that was told to start its transfer
+static unsigned char SPI_go_addr=0;
+//time that the board must start its transfer by
+static CTL_TIME_t SPI_go_time;
+
+//SPI stream states
+enum{SPI_STREAM_IDLE=0,SPI_STREAM_RUN,SPI_STREAM_DONE};
+
+//SPI stream receive state, the buffer is split in half so one chunk can be read while the next is received
+static struct{
+  //number of data bytes left to receive
+  unsigned short left;
+  //length of data in each chunk
+  unsigned short chunk;
+  //length of data in each half of the buffer, zero if empty
+  volatile unsigned short len[2];
+  //set if the chunk in each half of the buffer is the last one
+  volatile unsigned char last[2];
+  //half of the buffer being filled
+  unsigned char fill;
+  //half of the buffer to be read next
+  volatile unsigned char read;
+  //set while DMA is receiving a chunk
+  unsigned char busy;
+  //stream state
+  volatile unsigned char stat;
+}SPI_stream;
+
+static void ARC_bus_helper(void *p);
+
+static struct{
+    CTL_MUTEX_t mutex;
+    unsigned short size;
+    unsigned char type;
+    unsigned char level;
+    unsigned char dest;
+}err_req;
+
+//length of NACK queue, one entry is always left empty
+#define BUS_NACK_QUEUE_LEN      (8)
+//length of command and reason pair in a NACK packet
+#define BUS_NACK_PAIR_LEN       (2)
+
+//queue of NACKs to send
+//This is filled by the bus task and worker tasks and emptied by the bus helper task
+//no mutex is used, entries are added with interrupts disabled and only the helper task changes nack_out
+static struct{
+  unsigned char addr;
+  //CMD_NACK, CMD_SEQ_NACK or CMD_SEQ_ACK
+  unsigned char type;
+  //sequence number for CMD_SEQ_NACK and CMD_SEQ_ACK
+  unsigned char seq;
+  unsigned char cmd;
+  unsigned char resp;
+}nack_queue[BUS_NACK_QUEUE_LEN];
+//queue indexes
+static volatile unsigned char nack_in=0,nack_out=0;
+
+
+//power state of subsystem
+unsigned short powerState=SUB_PWR_OFF;
+
+//pointer to linked list of command parse functions
+//nodes in the list are sorted by priority
+//this node is the first in the list (or NULL for an empty list)
+//the last node in the list has next set to NULL
+CMD_PARSE_DAT *cmd_parse_list=NULL;
+
+//register callback
+//insert the callback structure in the linked list based on priority
+void BUS_register_cmd_callback(CMD_PARSE_DAT *cb_dat){
+  //get a pointer to the current list head
+  CMD_PARSE_DAT **head=&cmd_parse_list;
+  //find insertion point.
+  //This should be where *head points to a node with greater priority (or the beginning)
+  //and *head->next points to a node with lower priority (or the end)
+  while(*head!=NULL && (*head)->priority>cb_dat->priority){
+    //move head to the next element in the list
+    head= &(*head)->next;
+  }
+  //link to lower priority callbacks
+  cb_dat->next=*head;
+  //link in this callback
+  *head=cb_dat;
+}
+
+//maximum number of single command handlers
+#define BUS_CMD_HANDLER_MAX     (16)
+
+//single command handlers
+static struct{
+  unsigned char flags;
+  cmd_parse_Callback cb;
+}cmd_handlers[BUS_CMD_HANDLER_MAX];
+
+//number of handlers used
+static unsigned char cmd_handler_num=0;
+
+//handler for each command, index into cmd_handlers plus one or zero if there is no handler
+static unsigned char cmd_handler_idx[256];
+
+//register a handler for a single command, looked up directly instead of searching the callback list
+//registering a command again replaces the handler
+int BUS_register_cmd_handler(unsigned char cmd,unsigned char flags,cmd_parse_Callback fn){
+  unsigned char idx;
+  int en;
+  //check for handler
+  if(fn==NULL){
+    return ERR_INVALID_ARGUMENT;
+  }
+  en=ctl_global_interrupts_disable();
+  //get handler index
+  idx=cmd_handler_idx[cmd];
+  //check if command already has a handler
+  if(idx==0){
+    //check if there is room for another handler
+    if(cmd_handler_num>=BUS_CMD_HANDLER_MAX){
+      if(en){
+        ctl_global_interrupts_enable();
+      }
+      return ERR_BUSY;
+    }
+    //use the next handler
+    idx=++cmd_handler_num;
+  }
+  //setup handler
+  cmd_handlers[idx-1].flags=flags;
+  cmd_handlers[idx-1].cb=fn;
+  //set handler for command
+  cmd_handler_idx[cmd]=idx;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return RET_SUCCESS;
+}
+
+//request handlers
+static struct{
+  unsigned char cmd;
+  cmd_rpc_Callback cb;
+}rpc_handlers[BUS_RPC_HANDLER_NUM];
+
+//number of request handlers used
+static unsigned char rpc_handler_num=0;
+
+//register a handler that answers requests for a command sent with BUS_cmd_txrx
+//registering a command again replaces the handler
+int BUS_register_rpc_handler(unsigned char cmd,cmd_rpc_Callback fn){
+  int i,en;
+  //check for handler
+  if(fn==NULL){
+    return ERR_INVALID_ARGUMENT;
+  }
+  en=ctl_global_interrupts_disable();
+  //check if command already has a handler
+  for(i=0;i<rpc_handler_num;i++){
+    if(rpc_handlers[i].cmd==cmd){
+      break;
+    }
+  }
+  //check if there is room for another handler
+  if(i>=BUS_RPC_HANDLER_NUM){
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    return ERR_BUSY;
+  }
+  //setup handler
+  rpc_handlers[i].cmd=cmd;
+  rpc_handlers[i].cb=fn;
+  //check if a new handler was used
+  if(i>=rpc_handler_num){
+    rpc_handler_num++;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return RET_SUCCESS;
+}
+
+//get request handler for a command, returns NULL if there is no handler
+static cmd_rpc_Callback BUS_rpc_handler(unsigned char cmd){
+  int i;
+  for(i=0;i<rpc_handler_num;i++){
+    if(rpc_handlers[i].cmd==cmd){
+      return rpc_handlers[i].cb;
+    }
+  }
+  return NULL;
+}
+#define BUS_VERSION_LEN         (sizeof(BUS_VERSION)+BUS_VERSION_HASH_LEN)
+#define BUS_VERSION_MINOR_DIG   (4)     //maximum digits in minor version
+#define BUS_VERSION_HASH_LEN    (13)    //maximum length of hash that is sent
+
+
+//compare versions and report error if they are different
+char BUS_version_cmp(const BUS_VERSION* other,unsigned char len){
+  //first check that length is long enough
+  if(len<sizeof(BUS_VERSION)){
+    //return error
+    return BUS_VER_LENGTH;
+  }
+  //check for valid major versions
+  if(other->major==BUS_INVALID_MAJOR_VER || ARClib_vstruct.major==BUS_INVALID_MAJOR_VER){
+    //report error
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_INVALID_MAJOR,(ARClib_vstruct.major==BUS_INVALID_MAJOR_VER?VERSION_ERR_INVALID_MINE:0)|(other->major==BUS_INVALID_MAJOR_VER?VERSION_ERR_INVALID_OTHER:0));
+    //return, a major version is invalid, can't continue
+    return BUS_VER_INVALID_MAJOR_REV;
+  }
+  //compare major versions
+  if(other->major!=ARClib_vstruct.major){
+    //versions diffe, check which one is older
+    if(other->major>ARClib_vstruct.major){
+      //report error
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_MAJOR_REV_NEWER,other->major);
+      //other version is newer
+      return BUS_VER_MAJOR_REV_NEWER;
+    }else{
+      //report error
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_MAJOR_REV_OLDER,other->major);
+      //other version is older
+      return BUS_VER_MAJOR_REV_NEWER;
+    }
+  }
+  //check for valid minor versions
+  if(other->minor==BUS_INVALID_MINOR_VER || ARClib_vstruct.minor==BUS_INVALID_MINOR_VER){
+    //report error
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_INVALID_MINOR,(ARClib_vstruct.minor==BUS_INVALID_MINOR_VER?VERSION_ERR_INVALID_MINE:0)|(other->minor==BUS_INVALID_MINOR_VER?VERSION_ERR_INVALID_OTHER:0));
+    //return, a major version is invalid, can't continue
+    return BUS_VER_INVALID_MINOR_REV;
+  }
+  //compare minor versions
+  if(other->minor!=ARClib_vstruct.minor){
+    //versions diffe, check which one is older
+    if(other->minor>ARClib_vstruct.minor){
+      //report error
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_MINOR_REV_NEWER,other->minor);
+      //other version is newer
+      return BUS_VER_MINOR_REV_NEWER;
+    }else{
+      //report error
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_MINOR_REV_OLDER,other->minor);
+      //other version is older
+      return BUS_VER_MINOR_REV_OLDER;
+    }
+  }
+  //check dirty flags
+  if(other->dty!=BUS_VER_CLEAN || ARClib_vstruct.dty!=BUS_VER_CLEAN){
+    //report error
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_DIRTY_REV,(((unsigned short)ARClib_vstruct.dty)<<8)|(other->dty));
+    //one version is dirty, there is no way to tell if they are the same
+    return BUS_VER_DIRTY_REV;
+  }
+  //compare hashes
+  if(strncmp(other->hash,ARClib_vstruct.hash,len-sizeof(BUS_VERSION))){
+    //report error
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_HASH_MISMATCH,0);
+    //hashes are different
+    return BUS_VER_HASH_MISMATCH;
+  }
+  //check string length of hash to make sure the full hash was compared
+  if(strlen(ARClib_vstruct.hash)+sizeof(BUS_VERSION)>len){
+    //compare the number of commits between versioned commit and the current one
+    if(other->commits!=ARClib_vstruct.commits){
+      //report error
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_VERSION,VERSION_ERR_COMMIT_MISMATCH,other->commits);
+      //different number of commits, different commits
+      return BUS_VER_COMMIT_MISMATCH;
+    }
+    //otherwise versions are probably the same
+  }
+  return BUS_VER_SAME;
+}
+
+//setup a NACK packet and have the helper task send it
+static void BUS_nack_queue(unsigned char addr,unsigned char type,unsigned char seq,unsigned char cmd,unsigned char resp){
+  unsigned char next;
+  int en;
+  //disable interrupts so a worker task can't add an entry at the same time
+  en=ctl_global_interrupts_disable();
+  //get next index
+  next=nack_in+1;
+  //check for wraparound
+  if(next>=BUS_NACK_QUEUE_LEN){
+    next=0;
+  }
+  //check for space in the queue
+  if(next!=nack_out){
+    //set address
+    nack_queue[nack_in].addr=addr;
+    //set NACK type and sequence number
+    nack_queue[nack_in].type=type;
+    nack_queue[nack_in].seq=seq;
+    //set command
+    nack_queue[nack_in].cmd=cmd;
+    //set NACK reason
+    nack_queue[nack_in].resp=resp;
+    //add to queue, entry must be setup first
+    nack_in=next;
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    //tell helper thread to send packet
+    ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_NACK,0);
+  }else{
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    //can't send nack, report error
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_NACK_BUSY,(((unsigned short)addr)<<8)|resp);
+  }
+}
+
+//queue a NACK to be sent by the helper task, can be called from the ARCbus task or a worker task
+void BUS_nack_post(unsigned char addr,unsigned char cmd,unsigned char resp){
+  BUS_nack_queue(addr,CMD_NACK,0,cmd,resp);
+}
+
+//send all queued NACKs and sequenced command ACKs, called from the helper task
+//entries of the same type for the same address are combined into one packet
+static void BUS_nack_send(void){
+  unsigned char pk[BUS_I2C_HDR_LEN+BUS_I2C_MAX_PACKET_LEN+BUS_I2C_CRC_LEN],*ptr;
+  unsigned char addr,type,i,elen;
+  unsigned short len;
+  int resp;
+  //send until queue is empty
+  while(nack_out!=nack_in){
+    //get address and type from the oldest entry
+    addr=nack_queue[nack_out].addr;
+    type=nack_queue[nack_out].type;
+    //NACKs for sequenced commands also have the sequence number, ACKs only have the sequence number
+    elen=(type==CMD_SEQ_NACK)?BUS_SEQ_NACK_LEN:((type==CMD_SEQ_ACK)?BUS_SEQ_ACK_LEN:BUS_NACK_PAIR_LEN);
+    //setup command
+    ptr=BUS_cmd_init(pk,type);
+    len=0;
+    //collect entries for this address
+    for(i=nack_out;i!=nack_in && len+elen<=BUS_I2C_MAX_PACKET_LEN;i=(i+1>=BUS_NACK_QUEUE_LEN)?0:i+1){
+      //check address and type, already sent entries have a zero address
+      if(nack_queue[i].addr==addr && nack_queue[i].type==type){
+        //add sequence number
+        if(type==CMD_SEQ_NACK || type==CMD_SEQ_ACK){
+          ptr[len++]=nack_queue[i].seq;
+        }
+        //add command and reason
+        if(type!=CMD_SEQ_ACK){
+          ptr[len++]=nack_queue[i].cmd;
+          ptr[len++]=nack_queue[i].resp;
+        }
+        //mark as sent
+        nack_queue[i].addr=0;
+      }
+    }
+    //remove sent entries from the queue
+    while(nack_out!=nack_in && nack_queue[nack_out].addr==0){
+      //get next index, nack_out is only changed once so the bus task never sees a bad index
+      i=nack_out+1;
+      //check for wraparound
+      if(i>=BUS_NACK_QUEUE_LEN){
+        i=0;
+      }
+      nack_out=i;
+    }
+    //send the command
+    resp=BUS_cmd_tx(addr,pk,len,0);
+    //check response
+    if(resp!=RET_SUCCESS){
+      //error sending packet, report error
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_TX_NACK_FAIL,resp);
+    }
+  }
+}
+
+//report a command that could not be parsed and send a NACK if one was requested
+static void BUS_cmd_fail(unsigned char addr,unsigned char cmd,int resp,unsigned char nack){
+  report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_BAD_CMD,(((unsigned short)resp)<<8)|((unsigned short)cmd));
+  //check packet to see if NACK should be sent
+  if(nack){
+    BUS_nack_post(addr,cmd,resp);
+  }
+}
+
+//buffer to put fragmented commands back together
+typedef struct{
+  //sender address, zero if free
+  unsigned char addr;
+  unsigned char seq;
+  //index of the next fragment
+  unsigned char next;
+  unsigned short len;
+  //time that the last fragment was received
+  CTL_TIME_t time;
+  //command followed by the payload
+  unsigned char dat[BUS_FRAG_MAX_LEN+1];
+}BUS_FRAG_BUF;
+
+//reassembly buffers
+static BUS_FRAG_BUF frag_buf[BUS_FRAG_BUF_NUM];
+
+//throw away a partly received command
+static void BUS_frag_drop(BUS_FRAG_BUF *buf,int resp){
+  report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_FRAG_DROP,(((unsigned short)resp)<<8)|buf->addr);
+  //free buffer
+  buf->addr=0;
+}
+
+//add a CMD_FRAG packet to a reassembly buffer, returns the buffer once the whole command is received
+//the buffer must be freed by setting addr to zero, resp is set if the fragment could not be used
+static BUS_FRAG_BUF *BUS_frag_add(unsigned char addr,const unsigned char *ptr,unsigned short len,int *resp){
+  BUS_FRAG_BUF *buf=NULL,*free_buf=NULL;
+  unsigned char idx,last;
+  int i;
+  //check length, fragments must have data
+  if(len<=BUS_FRAG_HDR_LEN){
+    *resp=ERR_PK_LEN;
+    return NULL;
+  }
+  //get fragment index
+  idx=ptr[1]&~BUS_FRAG_LAST;
+  last=ptr[1]&BUS_FRAG_LAST;
+  //look for a buffer for this board and for a free buffer
+  for(i=0;i<BUS_FRAG_BUF_NUM;i++){
+    if(frag_buf[i].addr==addr){
+      buf=&frag_buf[i];
+    }else if(free_buf==NULL && (frag_buf[i].addr==0 || (ctl_get_current_time()-frag_buf[i].time)>BUS_FRAG_TIMEOUT)){
+      free_buf=&frag_buf[i];
+    }
+  }
+  //check for the first fragment of a command
+  if(idx==0){
+    //check if an old command was not finished
+    if(buf!=NULL){
+      BUS_frag_drop(buf,ERR_BAD_PK);
+    }else{
+      buf=free_buf;
+    }
+    //check for a buffer
+    if(buf==NULL){
+      *resp=ERR_BUFFER_BUSY;
+      return NULL;
+    }
+    //check for an old command that timed out
+    if(buf->addr!=0){
+      BUS_frag_drop(buf,ERR_BAD_PK);
+    }
+    //setup buffer
+    buf->addr=addr;
+    buf->seq=ptr[0];
+    buf->next=0;
+    buf->len=0;
+  }else if(buf==NULL || buf->seq!=ptr[0] || buf->next!=idx){
+    //fragment is missing, throw away command
+    if(buf!=NULL){
+      BUS_frag_drop(buf,ERR_PK_BAD_PARM);
+    }
+    *resp=ERR_PK_BAD_PARM;
+    return NULL;
+  }
+  //skip header
+  ptr+=BUS_FRAG_HDR_LEN;
+  len-=BUS_FRAG_HDR_LEN;
+  //check that the fragment fits
+  if(buf->len+len>sizeof(buf->dat)){
+    BUS_frag_drop(buf,ERR_PK_LEN);
+    *resp=ERR_PK_LEN;
+    return NULL;
+  }
+  //copy data
+  memcpy(buf->dat+buf->len,ptr,len);
+  buf->len+=len;
+  //next fragment
+  buf->next++;
+  buf->time=ctl_get_current_time();
+  //check for last fragment
+  if(last){
+    return buf;
+  }
+  return NULL;
+}
+
+#ifdef CDH_LIB
+//maximum number of boards that speed capabilities are saved for
+#define BUS_SPEED_NODES         (8)
+
+//speed capabilities of boards that have powered up
+static struct{
+  unsigned char addr;
+  BUS_SPEED caps;
+}speed_caps[BUS_SPEED_NODES];
+
+//save speed capabilities for a board and tell all boards to use the fastest speed they all support
+static void BUS_speed_negotiate(unsigned char addr,unsigned char i2c,unsigned char spi){
+  unsigned char pk[BUS_I2C_HDR_LEN+BUS_SPEED_CAPS_LEN+BUS_I2C_CRC_LEN],*ptr;
+  BUS_SPEED sp;
+  int i,resp;
+  //find entry for this board or an empty entry
+  for(i=0;i<BUS_SPEED_NODES;i++){
+    if(speed_caps[i].addr==addr || speed_caps[i].addr==0){
+      break;
+    }
+  }
+  //check if an entry was found
+  if(i<BUS_SPEED_NODES){
+    //save capabilities
+    speed_caps[i].addr=addr;
+    speed_caps[i].caps.i2c=i2c;
+    speed_caps[i].caps.spi=spi;
+  }else{
+    //no room, lower the limits of this board so the other board is still accounted for
+    if(i2c<BUS_speed_limit.i2c){
+      BUS_speed_limit.i2c=i2c;
+    }
+    if(spi<BUS_speed_limit.spi){
+      BUS_speed_limit.spi=spi;
+    }
+  }
+  //start with the limits of this board
+  sp=BUS_speed_limit;
+  //find the fastest speed supported by all boards
+  for(i=0;i<BUS_SPEED_NODES && speed_caps[i].addr;i++){
+    if(speed_caps[i].caps.i2c<sp.i2c){
+      sp.i2c=speed_caps[i].caps.i2c;
+    }
+    if(speed_caps[i].caps.spi<sp.spi){
+      sp.spi=speed_caps[i].caps.spi;
+    }
+  }
+  //setup command
+  ptr=BUS_cmd_init(pk,CMD_BUS_SPEED);
+  //set speeds
+  ptr[0]=sp.i2c;
+  ptr[1]=sp.spi;
+  //send to all boards, this is called from the bus task so the packet is queued
+  resp=BUS_cmd_tx_async(BUS_ADDR_GC,pk,BUS_SPEED_CAPS_LEN,0,NULL,0,NULL);
+  //check for errors
+  if(resp!=RET_SUCCESS){
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SPEED_TX_FAIL,resp);
+  }
+  //general call is not received by this board, set speed here
+  BUS_speed_set(sp.i2c,sp.spi);
+}
+#endif
+
+//register a buffer to receive SPI data from addr with data type type, buffer is owned by the caller again once event is set
+int BUS_SPI_rx_register(BUS_SPI_RX_DEST *dest,unsigned char addr,unsigned char type,void *buf,unsigned short size,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event){
+  BUS_SPI_RX_DEST *ptr;
+  int en;
+  //check arguments, buffer must fit at least the CRC
+  if(dest==NULL || buf==NULL || size<=BUS_SPI_CRC_LEN){
+    return ERR_INVALID_ARGUMENT;
+  }
+  en=ctl_global_interrupts_disable();
+  //check if buffer is receiving
+  if(dest->stat==BUS_SPI_RX_BUSY){
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    return ERR_BUSY;
+  }
+  //look for buffer in the list
+  for(ptr=SPI_rx_list;ptr!=NULL && ptr!=dest;ptr=ptr->next);
+  //setup buffer
+  dest->buf=buf;
+  dest->size=size;
+  dest->addr=addr;
+  dest->type=type;
+  dest->e=e;
+  dest->event=event;
+  dest->len=0;
+  //ready to receive
+  dest->stat=BUS_SPI_RX_ARMED;
+  //add to the list if not already there
+  if(ptr==NULL){
+    dest->next=SPI_rx_list;
+    SPI_rx_list=dest;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return RET_SUCCESS;
+}
+
+//stop receiving SPI data into a registered buffer
+int BUS_SPI_rx_unregister(BUS_SPI_RX_DEST *dest){
+  BUS_SPI_RX_DEST **ptr;
+  int en,resp=ERR_INVALID_ARGUMENT;
+  en=ctl_global_interrupts_disable();
+  //check if buffer is receiving
+  if(dest->stat==BUS_SPI_RX_BUSY){
+    resp=ERR_BUSY;
+  }else{
+    //find buffer in the list
+    for(ptr=&SPI_rx_list;*ptr!=NULL;ptr=&(*ptr)->next){
+      if(*ptr==dest){
+        //remove from list
+        *ptr=dest->next;
+        dest->next=NULL;
+        dest->stat=BUS_SPI_RX_IDLE;
+        resp=RET_SUCCESS;
+        break;
+      }
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return resp;
+}
+
+//find a registered buffer for SPI data and mark it busy, returns NULL if none match
+static BUS_SPI_RX_DEST *SPI_dest_find(unsigned char addr,unsigned char type,unsigned short len){
+  BUS_SPI_RX_DEST *ptr;
+  int en;
+  en=ctl_global_interrupts_disable();
+  for(ptr=SPI_rx_list;ptr!=NULL;ptr=ptr->next){
+    //check state, address, type and size
+    if(ptr->stat==BUS_SPI_RX_ARMED && (ptr->addr==BUS_SPI_RX_ANY_ADDR || ptr->addr==addr) &&
+       (ptr->type==BUS_SPI_RX_ANY_TYPE || ptr->type==type) && len+BUS_SPI_CRC_LEN<=ptr->size){
+      //buffer is now receiving
+      ptr->stat=BUS_SPI_RX_BUSY;
+      break;
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return ptr;
+}
+
+//send data back to addr the next time it sends SPI data, event is set once the data has been sent
+//buf is used by the ARCbus task until then
+int BUS_SPI_reply(unsigned char addr,const void *buf,unsigned short len,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t event){
+  SPI_REPLY *free_reply=NULL;
+  int i,en;
+  //check address
+  if(addr_chk(addr)!=RET_SUCCESS || addr==BUS_ADDR_GC){
+    return ERR_BAD_ADDR;
+  }
+  //check length, reply and CRC must fit in the buffer
+  if(buf==NULL || len==0 || len+BUS_SPI_CRC_LEN>BUS_get_buffer_size()){
+    return ERR_BAD_LEN;
+  }
+  en=ctl_global_interrupts_disable();
+  for(i=0;i<BUS_SPI_REPLY_NUM;i++){
+    //only one reply for each address
+    if(SPI_reply[i].addr==addr){
+      if(en){
+        ctl_global_interrupts_enable();
+      }
+      return ERR_BUSY;
+    }
+    //remember free entry
+    if(SPI_reply[i].addr==0 && free_reply==NULL){
+      free_reply=&SPI_reply[i];
+    }
+  }
+  //check for a free entry
+  if(free_reply==NULL){
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    return ERR_BUSY;
+  }
+  //setup reply
+  free_reply->buf=buf;
+  free_reply->len=len;
+  free_reply->e=e;
+  free_reply->event=event;
+  free_reply->addr=addr;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return RET_SUCCESS;
+}
+
+//cancel data waiting to be sent back to addr
+int BUS_SPI_reply_cancel(unsigned char addr){
+  int i,en,resp=ERR_INVALID_ARGUMENT;
+  en=ctl_global_interrupts_disable();
+  for(i=0;i<BUS_SPI_REPLY_NUM;i++){
+    //check address
+    if(SPI_reply[i].addr==addr && addr!=0){
+      //check if reply is being sent
+      if(&SPI_reply[i]==SPI_reply_cur){
+        resp=ERR_BUSY;
+      }else{
+        //free entry
+        SPI_reply[i].addr=0;
+        resp=RET_SUCCESS;
+      }
+      break;
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return resp;
+}
+
+//setup reply data for addr, returns buffer to send from or NULL if there is nothing to send
+//rx_len is the number of bytes the other board can receive, len is the number of bytes in the transaction
+static unsigned char *SPI_reply_start(unsigned char addr,unsigned short rx_len,unsigned short len){
+  unsigned short crc;
+  int i,en;
+  //nothing sent yet
+  SPI_reply_len=0;
+  SPI_reply_cur=NULL;
+  //reply, padding and CRC must fit in a pool block
+  if(rx_len>len || len+BUS_SPI_CRC_LEN>BUS_get_buffer_size()){
+    return NULL;
+  }
+  //find reply, don't let it be canceled while it is copied
+  en=ctl_global_interrupts_disable();
+  for(i=0;i<BUS_SPI_REPLY_NUM;i++){
+    //check address and length
+    if(SPI_reply[i].addr==addr && SPI_reply[i].len<=rx_len){
+      SPI_reply_cur=&SPI_reply[i];
+      break;
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  //check if a reply was found
+  if(SPI_reply_cur==NULL){
+    return NULL;
+  }
+  //get buffer to send from
+  SPI_tx_buf=BUS_buffer_alloc(CTL_TIMEOUT_NOW,0);
+  if(SPI_tx_buf==NULL){
+    //send reply next time
+    SPI_reply_cur=NULL;
+    return NULL;
+  }
+  //copy reply
+  memcpy(SPI_tx_buf,SPI_reply_cur->buf,SPI_reply_cur->len);
+  //fill the rest with dummy data
+  memset(SPI_tx_buf+SPI_reply_cur->len,BUS_SPI_DUMMY_DATA,len-SPI_reply_cur->len);
+  //calculate CRC
+  crc=crc16(SPI_tx_buf,len);
+  //send CRC in Big endian order
+  SPI_tx_buf[len]=crc>>8;
+  SPI_tx_buf[len+1]=crc;
+  //save length for CMD_SPI_COMPLETE
+  SPI_reply_len=SPI_reply_cur->len;
+  return SPI_tx_buf;
+}
+
+//SPI master transaction is done, sent is non zero if the reply was clocked out
+static void SPI_reply_done(int sent){
+  //check for reply
+  if(SPI_reply_cur!=NULL && sent){
+    //tell the task that the reply was sent
+    if(SPI_reply_cur->e!=NULL){
+      ctl_events_set_clear(SPI_reply_cur->e,SPI_reply_cur->event,0);
+    }
+    //free entry
+    SPI_reply_cur->addr=0;
+  }
+  SPI_reply_cur=NULL;
+  //free reply buffer
+  if(SPI_tx_buf!=NULL){
+    BUS_buffer_free(SPI_tx_buf);
+    SPI_tx_buf=NULL;
+  }
+}
+
+//return SPI receive buffer to the pool
+static void SPI_buf_free(void){
+  //check for registered buffer
+  if(SPI_dest!=NULL){
+    //transfer failed, buffer can receive again
+    SPI_dest->stat=BUS_SPI_RX_ARMED;
+    SPI_dest=NULL;
+    SPI_buf=NULL;
+    return;
+  }
+  //check if there is a buffer
+  if(SPI_buf==NULL){
+    return;
+  }
+  //subsystem can no longer get the buffer
+  BUS_event_buffer=NULL;
+  //free buffer
+  BUS_buffer_free(SPI_buf);
+  //clear buffer pointer
+  SPI_buf=NULL;
+  //start the next waiting transfer
+  ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SPI_NEXT,0);
+}
+
+//set priority for SPI transfers from addr when they have to wait, higher priority transfers go first
+int BUS_SPI_set_priority(unsigned char addr,unsigned char pri){
+  //check address
+  if(addr_chk(addr)!=RET_SUCCESS){
+    return ERR_BAD_ADDR;
+  }
+  //save priority
+  SPI_pri[addr]=pri;
+  return RET_SUCCESS;
+}
+
+//check if the SPI master is in use
+static int SPI_busy(void){
+  return SPI_buf!=NULL || SPI_addr!=0 || SPI_stream.stat!=SPI_STREAM_IDLE;
+}
+
+//tell a board about its queued SPI transfer
+static void SPI_queue_tx(unsigned char addr,unsigned char cmd){
+  unsigned char buf[BUS_I2C_HDR_LEN+BUS_I2C_CRC_LEN];
+  int resp;
+  //setup command
+  BUS_cmd_init(buf,cmd);
+  //queue command, this is the ARCbus task so it can not wait
+  resp=BUS_cmd_tx_async(addr,buf,0,0,NULL,0,NULL);
+  //check for errors
+  if(resp!=RET_SUCCESS){
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SPI_QUEUE_TX_FAIL,(((unsigned short)resp)<<8)|addr);
+  }
+}
+
+//remove transfers from addr from the queue, returns non zero if one was found
+static int SPI_queue_remove(unsigned char addr){
+  int i,j,found=0;
+  for(i=0,j=0;i<SPI_queue_num;i++){
+    //check address
+    if(SPI_queue[i].addr==addr){
+      found=1;
+    }else{
+      //keep transfer
+      SPI_queue[j++]=SPI_queue[i];
+    }
+  }
+  SPI_queue_num=j;
+  return found;
+}
+
+//add a SPI transfer to the queue
+static int SPI_queue_add(unsigned char addr){
+  int i;
+  //board is sending again, replace old request
+  SPI_queue_remove(addr);
+  //board is no longer starting
+  if(SPI_go_addr==addr){
+    SPI_go_addr=0;
+  }
+  //check for space
+  if(SPI_queue_num>=BUS_SPI_QUEUE_LEN){
+    return ERR_SPI_BUSY;
+  }
+  //find place in the queue, transfers with the same priority are sent in order
+  for(i=SPI_queue_num;i>0 && SPI_queue[i-1].pri<SPI_pri[addr];i--){
+    //move lower priority transfer back
+    SPI_queue[i]=SPI_queue[i-1];
+  }
+  //setup transfer
+  SPI_queue[i].addr=addr;
+  SPI_queue[i].pri=SPI_pri[addr];
+  SPI_queue_num++;
+  //tell board that its transfer is waiting
+  SPI_queue_tx(addr,CMD_SPI_QUEUED);
+  return RET_SUCCESS;
+}
+
+//tell the next waiting board to start its transfer
+static void SPI_queue_run(void){
+  BUS_BUFFER_STAT st;
+  //check if SPI is free and no board has been told to start
+  if(SPI_busy() || SPI_go_addr!=0 || SPI_queue_num==0){
+    return;
+  }
+  //wait for a free block so the board is not started just to be queued again, BUS_buffer_free tries again
+  BUS_buffer_stat(&st);
+  if(st.used>=BUS_BUFFER_BLOCK_NUM){
+    return;
+  }
+  //start highest priority transfer
+  SPI_go_addr=SPI_queue[0].addr;
+  //remove from queue
+  SPI_queue_remove(SPI_go_addr);
+  //board must send CMD_SPI_RDY again before the timeout
+  SPI_go_time=ctl_get_current_time()+BUS_SPI_GO_TIMEOUT;
+  //tell board to start
+  SPI_queue_tx(SPI_go_addr,CMD_SPI_GO);
+}
+
+//decompress received SPI data into a new buffer
+//if no block is free the data is decompressed in place, this fails if the output would overrun the unread input
+static int SPI_lz_expand(void){
+  unsigned char *out;
+  unsigned short len;
+  //done with compression
+  SPI_lz=0;
+  //get buffer for decompressed data
+  out=BUS_buffer_alloc(CTL_TIMEOUT_NOW,0);
+  if(out==NULL){
+    //no free block, decompress in the receive buffer
+    len=lz_decompress_inplace(SPI_buf,arcBus_stat.spi_stat.len,BUS_get_buffer_size());
+  }else{
+    //decompress data
+    len=lz_decompress(SPI_buf,arcBus_stat.spi_stat.len,out,BUS_get_buffer_size());
+    //check for errors
+    if(len==0){
+      BUS_buffer_free(out);
+    }else{
+      //done with compressed data
+      BUS_buffer_free(SPI_buf);
+      //subsystem gets decompressed data
+      SPI_buf=out;
+      BUS_event_buffer=out;
+    }
+  }
+  //check for errors
+  if(len==0){
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SPI_LZ,(((unsigned short)(out==NULL))<<8)|SPI_addr);
+    return ERR_SPI_LZ;
+  }
+  arcBus_stat.spi_stat.len=len;
+  return RET_SUCCESS;
+}
+
+//size of each half of the buffer used for SPI streams
+#define SPI_STREAM_HALF       (BUS_get_buffer_size()/2)
+
+//setup DMA to receive size bytes into dest and send size bytes from tx, SPI must already be setup as master
+//dummy data is sent if tx is NULL
+static void SPI_rx_start(unsigned char *dest,const unsigned char *tx,unsigned short size){
+  // Source DMA address: receive register.
+  *((unsigned int*)&DMA0SA) = (unsigned short)(&UCA0RXBUF);
+  // Destination DMA address: rx buffer.
+  *((unsigned int*)&DMA0DA) = (unsigned short)dest;
+  // The size of the block to be transferred
+  DMA0SZ = size;
+  // Configure the DMA transfer, single byte transfer with destination increment
+  DMA0CTL = DMAIE|DMADT_0|DMASBDB|DMAEN|DMASRCINCR_0|DMADSTINCR_3;
+
+  // Destination DMA address: the transmit buffer.
+  *((unsigned int*)&DMA1DA) = (unsigned int)(&UCA0TXBUF);
+  // The size of the block to be transferred
+  DMA1SZ = size-1;
+  //check for data to send
+  if(tx!=NULL){
+    // Source DMA address: tx buffer, first byte is written below
+    *((unsigned int*)&DMA1SA) = ((unsigned int)tx)+1;
+    // Configure the DMA transfer, single byte transfer with source increment
+    DMA1CTL=DMADT_0|DMASBDB|DMAEN|DMASRCINCR_3|DMADSTINCR_0;
+    //write the Tx buffer to start transfer
+    UCA0TXBUF=tx[0];
+  }else{
+    // Source DMA address: SPI transmit buffer, constant data will be sent
+    *((unsigned int*)&DMA1SA) = (unsigned int)(&UCA0TXBUF);
+    // Configure the DMA transfer, single byte transfer with no increment
+    DMA1CTL=DMADT_0|DMASBDB|DMAEN|DMASRCINCR_0|DMADSTINCR_0;
+    //write the Tx buffer to start transfer
+    UCA0TXBUF=BUS_SPI_DUMMY_DATA;
+  }
+}
+
+//start receiving the next stream chunk if there is room in the buffer
+static void SPI_stream_next(void){
+  unsigned short clen;
+  //check if stream is running and DMA is idle
+  if(SPI_stream.stat!=SPI_STREAM_RUN || SPI_stream.busy){
+    return;
+  }
+  //check if half is still in use, the slave waits for the clock so the transfer pauses here
+  if(SPI_stream.len[SPI_stream.fill]!=0){
+    return;
+  }
+  //get chunk length, last chunk can be short
+  clen=SPI_stream.left;
+  if(clen>SPI_stream.chunk){
+    clen=SPI_stream.chunk;
+  }
+  //DMA is running
+  SPI_stream.busy=1;
+  //receive chunk and CRC into free half
+  SPI_rx_start(SPI_buf+SPI_stream.fill*SPI_STREAM_HALF,NULL,clen+BUS_SPI_CRC_LEN);
+}
+
+//free the buffer once the stream is done and all chunks have been read
+static void SPI_stream_free(void){
+  int en;
+  en=ctl_global_interrupts_disable();
+  //check if stream is done and both halves are empty
+  if(SPI_stream.stat!=SPI_STREAM_DONE || SPI_stream.len[0]!=0 || SPI_stream.len[1]!=0){
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    return;
+  }
+  //stream is finished
+  SPI_stream.stat=SPI_STREAM_IDLE;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  //free buffer
+  SPI_buf_free();
+}
+
+//stop SPI stream, buffer is freed once the subsystem is done with received chunks
+static void SPI_stream_stop(void){
+  //disable DMA
+  DMA0CTL&=~DMAEN;
+  DMA1CTL&=~DMAEN;
+  DMA2CTL&=~DMAEN;
+  //turn off SPI
+  SPI_deactivate();
+  //DMA is not running
+  SPI_stream.busy=0;
+  //no more chunks will be received
+  SPI_stream.stat=SPI_STREAM_DONE;
+  //free buffer if it is not in use
+  SPI_stream_free();
+}
+
+//SPI stream chunk received, check CRC and start the next chunk
+static void SPI_stream_chunk(void){
+  unsigned char *buf;
+  unsigned short clen,crc;
+  //check if stream is running
+  if(SPI_stream.stat!=SPI_STREAM_RUN){
+    return;
+  }
+  //DMA is done
+  SPI_stream.busy=0;
+  //get chunk length
+  clen=SPI_stream.left;
+  if(clen>SPI_stream.chunk){
+    clen=SPI_stream.chunk;
+  }
+  //get chunk location
+  buf=SPI_buf+SPI_stream.fill*SPI_STREAM_HALF;
+  //assemble CRC
+  crc=buf[clen+1];//LSB
+  crc|=(((unsigned short)buf[clen])<<8);//MSB
+  //check CRC
+  if(crc!=crc16(buf,clen)){
+    //Bad CRC, stop stream
+    SPI_stream_stop();
+    //send event
+    ctl_events_set_clear(&SUB_events,SUB_EV_SPI_ERR_CRC,0);
+    //set return value for SPI complete packet
+    arcBus_stat.spi_stat.nack=ERR_BAD_CRC;
+    //tell helper thread to send SPI complete command
+    ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_SPI_COMPLETE_CMD,0);
+    return;
+  }
+  //update bytes left
+  SPI_stream.left-=clen;
+  //mark the last chunk
+  SPI_stream.last[SPI_stream.fill]=(SPI_stream.left==0);
+  //chunk is ready to be read
+  SPI_stream.len[SPI_stream.fill]=clen;
+  //fill the other half next
+  SPI_stream.fill^=1;
+  //tell subsystem, SPI chunk received
+  ctl_events_set_clear(&SUB_events,SUB_EV_SPI_DAT,0);
+  //check if all data has been received
+  if(SPI_stream.left==0){
+    //done receiving
+    SPI_stream_stop();
+    //set return value for SPI complete packet
+    arcBus_stat.spi_stat.nack=RET_SUCCESS;
+    //tell helper thread to send SPI complete command
+    ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_SPI_COMPLETE_CMD,0);
+  }else{
+    //receive next chunk
+    SPI_stream_next();
+  }
+}
+
+//get length of a chunk in a chunked SPI transfer
+static unsigned short SPI_chunk_len(unsigned char idx){
+  unsigned short clen;
+  //last chunk can be short
+  clen=SPI_chunk.len-idx*(unsigned short)SPI_chunk.chunk;
+  if(clen>SPI_chunk.chunk){
+    clen=SPI_chunk.chunk;
+  }
+  return clen;
+}
+
+//receive the next wanted chunk or finish the transfer
+static void SPI_chunk_next(void){
+  unsigned short i;
+  //find next chunk to receive
+  for(;SPI_chunk.cur<SPI_chunk.num && !(SPI_chunk.want&(1UL<<SPI_chunk.cur));SPI_chunk.cur++);
+  //check for a chunk
+  if(SPI_chunk.cur<SPI_chunk.num){
+    //receive chunk and CRC into its place in the buffer
+    SPI_rx_start(SPI_buf+SPI_chunk.cur*(SPI_chunk.chunk+BUS_SPI_CRC_LEN),NULL,SPI_chunk_len(SPI_chunk.cur)+BUS_SPI_CRC_LEN);
+    return;
+  }
+  //all chunks received, turn off SPI
+  SPI_deactivate();
+  //check for bad chunks
+  if(SPI_chunk.bad){
+    //wait for the bad chunks to be sent again
+    SPI_chunk.stat=SPI_CHUNK_RESEND;
+    //other boards wait until the sender starts again or times out
+    SPI_go_addr=SPI_chunk.addr;
+    SPI_go_time=ctl_get_current_time()+BUS_SPI_GO_TIMEOUT;
+    //set return value for SPI complete packet, bad chunks are sent with it
+    arcBus_stat.spi_stat.nack=ERR_BAD_CRC;
+  }else{
+    //remove CRCs so the data is contiguous
+    for(i=1;i<SPI_chunk.num;i++){
+      memmove(SPI_buf+i*SPI_chunk.chunk,SPI_buf+i*(SPI_chunk.chunk+BUS_SPI_CRC_LEN),SPI_chunk_len(i));
+    }
+    //done with chunks
+    SPI_chunk.stat=SPI_CHUNK_IDLE;
+    //set data length for subsystem
+    arcBus_stat.spi_stat.len=SPI_chunk.len;
+    //tell subsystem, SPI data received
+    //Subsystem must signal to free the buffer
+    ctl_events_set_clear(&SUB_events,SUB_EV_SPI_DAT,0);
+    //set return value for SPI complete packet
+    arcBus_stat.spi_stat.nack=RET_SUCCESS;
+  }
+  //tell helper thread to send SPI complete command
+  ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_SPI_COMPLETE_CMD,0);
+}
+
+//chunk received, check its CRC and receive the next one
+static void SPI_chunk_done(void){
+  unsigned char *buf;
+  unsigned short clen,crc;
+  //get chunk location and length
+  buf=SPI_buf+SPI_chunk.cur*(SPI_chunk.chunk+BUS_SPI_CRC_LEN);
+  clen=SPI_chunk_len(SPI_chunk.cur);
+  //assemble CRC
+  crc=buf[clen+1];//LSB
+  crc|=(((unsigned short)buf[clen])<<8);//MSB
+  //check CRC
+  if(crc!=crc16(buf,clen)){
+    //chunk must be sent again
+    SPI_chunk.bad|=(1UL<<SPI_chunk.cur);
+  }else{
+    //chunk is good
+    SPI_chunk.bad&=~(1UL<<SPI_chunk.cur);
+  }
+  //go to the next chunk
+  SPI_chunk.cur++;
+  SPI_chunk_next();
+}
+
+//give up on a chunked transfer and free the buffer
+static void SPI_chunk_stop(void){
+  //check for chunked transfer
+  if(SPI_chunk.stat==SPI_CHUNK_IDLE){
+    return;
+  }
+  //done with chunks
+  SPI_chunk.stat=SPI_CHUNK_IDLE;
+  //free buffer
+  SPI_buf_free();
+}
+
+//get next received SPI stream chunk, returns NULL if no chunk is ready
+unsigned char *BUS_SPI_stream_get(unsigned short *len,int *last){
+  unsigned char *buf=NULL;
+  int en;
+  en=ctl_global_interrupts_disable();
+  //check for a stream and a chunk to read
+  if(SPI_stream.stat!=SPI_STREAM_IDLE && SPI_stream.len[SPI_stream.read]!=0){
+    //get chunk location
+    buf=SPI_buf+SPI_stream.read*SPI_STREAM_HALF;
+    //get chunk length
+    *len=SPI_stream.len[SPI_stream.read];
+    //check if this is the last chunk
+    if(last!=NULL){
+      *last=SPI_stream.last[SPI_stream.read];
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return buf;
+}
+
+//done with SPI stream chunk, lets the next chunk be received
+void BUS_SPI_stream_release(void){
+  int en;
+  en=ctl_global_interrupts_disable();
+  //check for a chunk to release
+  if(SPI_stream.stat!=SPI_STREAM_IDLE && SPI_stream.len[SPI_stream.read]!=0){
+    //half is now empty
+    SPI_stream.len[SPI_stream.read]=0;
+    SPI_stream.last[SPI_stream.read]=0;
+    //read the other half next
+    SPI_stream.read^=1;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  //tell ARCbus task that there is room for another chunk
+  ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SPI_CHUNK_FREE,0);
+}
+
+//answer a request sent with BUS_cmd_txrx
+static void BUS_rpc_answer(unsigned char addr,unsigned char seq,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char flags);
+//send a response with only a status for a request that could not be run
+static void BUS_rpc_reject(unsigned char addr,unsigned char seq,short status);
+
+//parse a command and return the response to send back
+//deferred callbacks are handed to a worker task which sends its own NACK if one was requested
+//unless nack has BUS_PARSE_INLINE set because the caller needs the result
+static int BUS_cmd_parse(unsigned char addr,unsigned char cmd,unsigned char *ptr,unsigned short len,unsigned char flags,unsigned char nack){
+  int resp=0;
+  ticker nt;
+  unsigned short sub;
+  unsigned char parse_mask;
+  int i,resend;
+  unsigned short rx_len;
+  #ifdef CDH_LIB
+  //temporary array for bus version comparison, needed for alignment reasons
+  unsigned short tmp[(BUS_VERSION_LEN+1)/sizeof(unsigned short)];
+  #endif
+  CMD_PARSE_DAT *parse_ptr,*def_ptr=NULL;
+  #ifdef BUS_PROFILE
+    unsigned short prof=BUS_PROF_TIMER;
+  #endif
+  //handle command based on command type
+  switch(cmd){
+    case CMD_SUB_ON:            
+        //check for proper length
+        if(len!=0){
+          resp=ERR_PK_LEN;
+        }
+        //set new power status
+        powerState=SUB_PWR_ON;
+        //inform subsystem
+        ctl_events_set_clear(&SUB_events,SUB_EV_PWR_ON,0);
+    break;
+    case CMD_SUB_OFF:
+      //check to make sure that the command is directed to this subsystem
+      if(len==1 && BUS_OA_check(ptr[0])==RET_SUCCESS){
+        //set new power status
+        powerState=SUB_PWR_OFF;
+        //inform subsystem
+        ctl_events_set_clear(&SUB_events,SUB_EV_PWR_OFF,0);
+      }else{
+        //error with command
+        resp=ERR_BAD_PK;
+      }
+    break;
+    case CMD_SUB_STAT:
+      #ifndef CDH_LIB //only update time on subsystem boards
+        //check for proper length
+        if(len!=BUS_SUB_STAT_LEN && len!=BUS_SUB_STAT_OLD_LEN){
+          resp=ERR_PK_LEN;
+          break;
+        }
+        //receive time is for the whole packet, only use it if the command was not inside another command
+        if(I2C_rx_buf[I2C_rx_out].dat[1]!=CMD_SUB_STAT){
+          resp=ERR_ILLEAGLE_COMMAND;
+          break;
+        }
+        //assemble time from packet
+        nt=ptr[3];
+        nt|=((ticker)ptr[2])<<8;
+        nt|=((ticker)ptr[1])<<16;
+        nt|=((ticker)ptr[0])<<24;
+        //get timer counts since the tick, older CDH boards don't send this
+        if(len==BUS_SUB_STAT_LEN){
+          sub=(((unsigned short)ptr[4])<<8)|ptr[5];
+        }else{
+          sub=0;
+        }
+        //update time using the time the packet was received
+        BUS_time_sync(nt,sub,I2C_rx_buf[I2C_rx_out].t_tick,I2C_rx_buf[I2C_rx_out].t_sub);
+        //tell subsystem to send status
+        ctl_events_set_clear(&SUB_events,SUB_EV_SEND_STAT,0);
+      #else
+        //if CMD_SUB_STAT is recived by CDH, report an error
+        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_CDH_SUB_STAT_REC,addr);
+        resp=ERR_ILLEAGLE_COMMAND;
+      #endif
+    break;
+    case CMD_RESET:          
+      //check for proper length
+      if(len!=0){
+        resp=ERR_PK_LEN;
+      }
+      //reset msp430
+      reset(ERR_LEV_INFO,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_RESET,0);
+      //code should never get here, report error
+      report_error(ERR_LEV_CRITICAL,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_RESET_FAIL,0);
+      break;
+    case CMD_SPI_RDY:
+      //check length, data type is optional, stream transfers also send chunk length and chunked transfers send a chunk map
+      //full duplex transfers send the length that can be sent back
+      if(len<2 || (len>4 && len!=BUS_SPI_CHUNK_RDY_LEN && len!=BUS_SPI_DUPLEX_RDY_LEN)){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //assemble length
+      arcBus_stat.spi_stat.len=ptr[1];//LSB
+      arcBus_stat.spi_stat.len|=(((unsigned short)ptr[0])<<8);//MSB
+      //check if bad chunks from a chunked transfer are being sent again
+      resend=(len==BUS_SPI_CHUNK_RDY_LEN && SPI_chunk.stat==SPI_CHUNK_RESEND && SPI_chunk.addr==addr && 
+              SPI_chunk.len==arcBus_stat.spi_stat.len && SPI_chunk.chunk==ptr[3]);
+      //check if board gave up on a chunked transfer
+      if(!resend && SPI_chunk.stat==SPI_CHUNK_RESEND && SPI_chunk.addr==addr){
+        //free old transfer
+        SPI_chunk_stop();
+      }
+      //check if SPI is in use or other boards are waiting their turn
+      if(!resend && (SPI_busy() || (SPI_go_addr!=0 && SPI_go_addr!=addr) || (SPI_go_addr==0 && SPI_queue_num!=0))){
+        //wait for SPI to be free
+        resp=SPI_queue_add(addr);
+        break;
+      }
+      //no longer waiting for this board
+      SPI_go_addr=0;
+      //start the next waiting transfer if this one fails, nothing is started once SPI is running
+      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SPI_NEXT,0);
+      //check if data is compressed
+      SPI_lz=((len==3 || len==BUS_SPI_DUPLEX_RDY_LEN) && ptr[2]&BUS_SPI_TYPE_LZ);
+      //check if data can be sent back
+      SPI_duplex=(len==BUS_SPI_DUPLEX_RDY_LEN);
+      //check for chunked transfer
+      if(len==BUS_SPI_CHUNK_RDY_LEN){
+        //check if bad chunks are being sent again
+        if(!resend){
+          //setup chunked transfer
+          SPI_chunk.addr=addr;
+          SPI_chunk.len=arcBus_stat.spi_stat.len;
+          SPI_chunk.chunk=ptr[3];
+          //check chunk length
+          if(SPI_chunk.chunk==0 || SPI_chunk.len==0){
+            resp=ERR_SPI_LEN;
+            break;
+          }
+          //check number of chunks, one bit for each in the chunk map
+          if(((unsigned long)SPI_chunk.len+SPI_chunk.chunk-1)/SPI_chunk.chunk>BUS_SPI_CHUNK_MAX){
+            resp=ERR_SPI_LEN;
+            break;
+          }
+          //get number of chunks
+          SPI_chunk.num=(SPI_chunk.len+SPI_chunk.chunk-1)/SPI_chunk.chunk;
+          //make sure data and CRCs fit in the buffer
+          if(SPI_chunk.len+SPI_chunk.num*BUS_SPI_CRC_LEN>BUS_get_buffer_size()){
+            resp=ERR_SPI_LEN;
+            break;
+          }
+          //first transfer must send all chunks
+          if(BUS_SPI_map_get(ptr+4)!=(0xFFFFFFFFUL>>(BUS_SPI_CHUNK_MAX-SPI_chunk.num))){
+            resp=ERR_PK_BAD_PARM;
+            break;
+          }
+          //no bad chunks yet
+          SPI_chunk.bad=0;
+        }
+      //check for stream transfer
+      }else if(len==4){
+        //assemble chunk length
+        SPI_stream.chunk=ptr[3];//LSB
+        SPI_stream.chunk|=(((unsigned short)ptr[2])<<8);//MSB
+        //check chunk length, chunk and 16bit CRC must fit in half of the buffer
+        if(SPI_stream.chunk==0 || arcBus_stat.spi_stat.len==0 || SPI_stream.chunk+BUS_SPI_CRC_LEN>SPI_STREAM_HALF){
+          //cause NACK to be sent
+          resp=ERR_SPI_LEN;
+          break;
+        }
+      //look for a registered buffer for the data type
+      }else if((len==3 || len==BUS_SPI_DUPLEX_RDY_LEN) && !SPI_lz && (SPI_dest=SPI_dest_find(addr,ptr[2],arcBus_stat.spi_stat.len))!=NULL){
+        //receive directly into registered buffer
+        SPI_buf=SPI_dest->buf;
+      }else if(arcBus_stat.spi_stat.len+2>BUS_get_buffer_size()){
+        //length is too long, account for 16bit CRC
+        //cause NACK to be sent
+        resp=ERR_SPI_LEN;
+        break;
+      }
+      //check if a buffer is needed
+      if(SPI_dest==NULL && !resend){
+        //get buffer from the pool
+        SPI_buf=BUS_buffer_alloc(CTL_TIMEOUT_NOW,0);
+        //subsystem gets this buffer when data is received
+        BUS_event_buffer=SPI_buf;
+      }
+      //check if buffer was locked
+      if(SPI_buf==NULL){
+        //no block free, wait for one to be freed
+        resp=SPI_queue_add(addr);
+        //stop SPI setup
+        break;
+      }
+      //disable DMA
+      DMA0CTL&=~DMAEN;
+      DMA1CTL&=~DMAEN;
+      DMA2CTL&=~DMAEN;
+      //save address of SPI slave
+      SPI_addr=addr;
+      //setup SPI structure
+      arcBus_stat.spi_stat.rx=SPI_buf;
+      arcBus_stat.spi_stat.tx=NULL;
+      //Setup SPI bus to exchange data as master
+      SPI_master_setup();
+      //============[setup DMA for transfer]============
+      //setup source trigger
+      DMACTL0 &=~(DMA0TSEL_31|DMA1TSEL_31);
+      DMACTL0 |= (DMA0TSEL__USCIA0RX|DMA1TSEL__USCIA0TX);
+      DMACTL1 = DMA2TSEL__USCIA0RX;
+      //DMA9 workaround, use a dummy channel with lower priority and the same trigger
+      //setup dummy channel: read and write from unused space in the SPI registers
+      *((unsigned int*)&DMA2SA) = EUSCI_A0_BASE + 0x02;
+      *((unsigned int*)&DMA2DA) = EUSCI_A0_BASE + 0x04;
+      // only one byte
+      DMA2SZ = 1;
+      // Configure the DMA transfer, repeated byte transfer with no increment
+      DMA2CTL = DMADT_4|DMASBDB|DMAEN|DMASRCINCR_0|DMADSTINCR_0;
+      //check for stream transfer
+      if(len==4){
+        //setup stream
+        SPI_stream.left=arcBus_stat.spi_stat.len;
+        SPI_stream.len[0]=SPI_stream.len[1]=0;
+        SPI_stream.last[0]=SPI_stream.last[1]=0;
+        SPI_stream.fill=0;
+        SPI_stream.read=0;
+        SPI_stream.busy=0;
+        SPI_stream.stat=SPI_STREAM_RUN;
+        //receive first chunk
+        SPI_stream_next();
+      }else if(len==BUS_SPI_CHUNK_RDY_LEN){
+        //get chunks sent in this transfer
+        SPI_chunk.want=BUS_SPI_map_get(ptr+4);
+        //start with the first chunk
+        SPI_chunk.cur=0;
+        SPI_chunk.stat=SPI_CHUNK_RUN;
+        //receive first chunk
+        SPI_chunk_next();
+      }else if(SPI_duplex){
+        //get length that can be sent back
+        rx_len=ptr[4];//LSB
+        rx_len|=(((unsigned short)ptr[3])<<8);//MSB
+        //receive data and CRC, send reply if there is one
+        SPI_rx_start(SPI_buf,SPI_reply_start(addr,rx_len,arcBus_stat.spi_stat.len),arcBus_stat.spi_stat.len+BUS_SPI_CRC_LEN);
+      }else{
+        //receive data and CRC
+        SPI_rx_start(SPI_buf,NULL,arcBus_stat.spi_stat.len+BUS_SPI_CRC_LEN);
+      }
+    break;
+    
+    case CMD_SPI_ABORT:
+      //check length
+      if(len!=0){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //check if transfer was waiting
+      if(SPI_queue_remove(addr) || SPI_go_addr==addr){
+        //check if board was told to start
+        if(SPI_go_addr==addr){
+          SPI_go_addr=0;
+          //free chunked transfer if it was waiting for bad chunks
+          if(SPI_chunk.stat==SPI_CHUNK_RESEND && SPI_chunk.addr==addr){
+            SPI_chunk_stop();
+          }
+          //start the next transfer
+          SPI_queue_run();
+        }
+        break;
+      }
+      //check SPI mode
+      if(arcBus_stat.spi_stat.mode!=BUS_SPI_MASTER){
+        resp=ERR_SPI_NOT_RUNNING;
+        break;
+      }
+      //check SPI address
+      if(SPI_addr!=addr){
+        resp=ERR_SPI_WRONG_ADDR;
+        break;
+      }
+      //check for stream transfer
+      if(SPI_stream.stat==SPI_STREAM_RUN){
+        //stop stream, buffer is freed once received chunks are read
+        SPI_stream_stop();
+        //tell subsystem that the stream ended early
+        ctl_events_set_clear(&SUB_events,SUB_EV_SPI_ERR_CRC,0);
+      }else{
+        //disable DMA
+        DMA0CTL&=~DMAEN;
+        DMA1CTL&=~DMAEN;
+        DMA2CTL&=~DMAEN;
+        //turn off SPI
+        SPI_deactivate();              
+        //chunked transfer is done
+        SPI_chunk.stat=SPI_CHUNK_IDLE;
+        //free buffer
+        SPI_buf_free();
+        //reply was not sent, keep it for next time
+        SPI_reply_done(0);
+      }
+      //clear address
+      SPI_addr=0;
+      //retport error
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_SPI_ABORT,addr);
+    break;
+
+    case CMD_SEQ:
+      //check length, command has a sequence number and a command
+      if(len<BUS_SEQ_HDR_LEN){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //handle command, NACK has the sequence number so it is sent here
+      //deferred callbacks run here so the result is known
+      i=BUS_cmd_parse(addr,ptr[1],ptr+BUS_SEQ_HDR_LEN,len-BUS_SEQ_HDR_LEN,flags,BUS_PARSE_INLINE);
+      //check if command failed
+      if(i!=0){
+        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_BAD_CMD,(((unsigned short)i)<<8)|((unsigned short)ptr[1]));
+        //check if NACK was requested
+        if(nack){
+          BUS_nack_queue(addr,CMD_SEQ_NACK,ptr[0],ptr[1],i);
+        }
+      }else if(nack){
+        //tell sender that the command was accepted, ACKs are sent when NACKs are requested
+        BUS_nack_queue(addr,CMD_SEQ_ACK,ptr[0],ptr[1],0);
+      }
+    break;
+    case CMD_SEQ_ACK:
+      //check length, packet has one or more sequence numbers
+      if(len<BUS_SEQ_ACK_LEN){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //mark each command as accepted
+      for(i=0;i<len;i+=BUS_SEQ_ACK_LEN){
+        BUS_seq_ack(addr,ptr[i]);
+      }
+    break;
+    case CMD_SEQ_NACK:
+      //check length, packet has one or more sequence number, command and reason triplets
+      if(len<BUS_SEQ_NACK_LEN || len%BUS_SEQ_NACK_LEN){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //handle each triplet
+      for(i=0;i<len;i+=BUS_SEQ_NACK_LEN){
+        //report error
+        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_NACK_REC,(((unsigned short)ptr[i+1])<<8)|((unsigned short)ptr[i+2]));
+        //mark command as rejected
+        BUS_seq_nack(addr,ptr[i],ptr[i+2]);
+      }
+    break;
+    case CMD_RPC:
+      //check length, request has a sequence number and a command
+      if(len<BUS_RPC_HDR_LEN){
+        //answer with the sequence number if there is one so the sender knows which request failed
+        if(len>0){
+          BUS_rpc_reject(addr,ptr[0],ERR_PK_LEN);
+        }else{
+          resp=ERR_PK_LEN;
+        }
+        break;
+      }
+      //run command and send response
+      BUS_rpc_answer(addr,ptr[0],ptr[1],ptr+BUS_RPC_HDR_LEN,len-BUS_RPC_HDR_LEN,flags);
+    break;
+    case CMD_RPC_RESP:
+      //check length, response has a sequence number and a 16-bit status
+      if(len<BUS_RPC_RESP_HDR_LEN){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //give response to the waiting task
+      BUS_rpc_done(addr,ptr[0],(short)((((unsigned short)ptr[1])<<8)|((unsigned short)ptr[2])),ptr+BUS_RPC_RESP_HDR_LEN,len-BUS_RPC_RESP_HDR_LEN);
+    break;
+    case CMD_SPI_QUEUED:
+      //check length
+      if(len!=0){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //tell SPI code that the transfer is waiting
+      ctl_events_set_clear(&arcBus_stat.events,BUS_EV_SPI_QUEUED,0);
+    break;
+    case CMD_SPI_GO:
+      //check length
+      if(len!=0){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //tell SPI code to start the transfer
+      ctl_events_set_clear(&arcBus_stat.events,BUS_EV_SPI_GO,0);
+    break;
+    case CMD_SPI_COMPLETE:
+      //check length, chunked transfers can send a map of bad chunks and full duplex transfers send the reply length
+      if(len!=1 && len!=3 && len!=1+BUS_SPI_CHUNK_MAP_LEN){
+        resp=ERR_PK_LEN;
+        break;
+      }
+#ifndef CDH_LIB
+      //check if a SPI transaction was in progress
+      if(arcBus_stat.spi_stat.mode!=BUS_SPI_SLAVE){
+#else
+      //check if a SPI transaction was in progress
+      if(arcBus_stat.spi_stat.mode!=BUS_SPI_MASTER && arcBus_stat.spi_stat.mode!=BUS_SPI_SLAVE){
+#endif
+        //SPI is in the wrong state so send busy error
+        resp=ERR_SPI_NOT_RUNNING;
+        //send NACK
+        break;
+      }
+
+      //check that the command came from the correct subsystem
+      if(arcBus_stat.spi_stat.mode==BUS_SPI_MASTER && SPI_addr!=addr){
+          //wrong address sent for complete command
+          resp=ERR_SPI_WRONG_ADDR;
+          //send NACK
+          break;
+      }
+      //disable DMA
+      DMA0CTL&=~DMAEN;
+      DMA1CTL&=~DMAEN;
+      DMA2CTL&=~DMAEN;
+      //turn off SPI
+      SPI_deactivate();
+      //SPI transfer is done, see if there was an error
+      arcBus_stat.spi_stat.nack=ptr[0];
+      //get bad chunks
+      arcBus_stat.spi_stat.bad=(len==1+BUS_SPI_CHUNK_MAP_LEN)?BUS_SPI_map_get(ptr+1):0;
+      //get length of data sent back
+      if(len==3){
+        arcBus_stat.spi_stat.rx_len=ptr[2];//LSB
+        arcBus_stat.spi_stat.rx_len|=(((unsigned short)ptr[1])<<8);//MSB
+      }
+      //notify CDH board
+#ifndef CDH_LIB
+      ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_SPI_CLEAR_CMD,0);
+#endif
+      //notify calling task
+      ctl_events_set_clear(&arcBus_stat.events,BUS_EV_SPI_COMPLETE,0);
+    break;
+    case CMD_ASYNC_SETUP:
+      //check length
+      if(len!=1){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      switch(ptr[0]){
+        case ASYNC_OPEN:
+          //open remote connection
+          async_open_remote(addr);
+        break;
+        case ASYNC_CLOSE:
+          //check if sending address corosponds to async address
+          if(async_addr!=addr){
+            //report error
+            report_error(ERR_LEV_ERROR,BUS_ERR_SRC_ASYNC,ASYNC_ERR_CLOSE_WRONG_ADDR,(((unsigned short)addr)<<8)|async_addr);
+            break;
+          }
+          //tell helper thread to close connection
+          ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ASYNC_CLOSE,0);
+        break;
+      }
+    break;
+    case CMD_ASYNC_DAT:
+      //post bytes to queue
+      ctl_byte_queue_post_multi_nb(&async_rxQ,len,ptr);
+    break;
+    case CMD_NACK:
+      //TODO: handle this better somehow?
+      //check length, packet has one or more command and reason pairs
+      if(len<BUS_NACK_PAIR_LEN || len%BUS_NACK_PAIR_LEN){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //set event 
+      ctl_events_set_clear(&arcBus_stat.events,BUS_EV_CMD_NACK,0);
+      //handle each pair
+      for(i=0;i<len;i+=BUS_NACK_PAIR_LEN){
+        //report error
+        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_NACK_REC,(((unsigned short)ptr[i])<<8)|((unsigned short)ptr[i+1]));
+        //check which packet was nacked
+        switch(ptr[i]){
+            case CMD_SPI_RDY:
+              //set SPI nack reason
+              arcBus_stat.spi_stat.nack=ptr[i+1];
+              //send event to spi code
+              ctl_events_set_clear(&arcBus_stat.events,BUS_EV_SPI_NACK,0);
+            break;
+            case CMD_RPC:
+              //request could not be read so the sequence number is not known, wake up the task waiting if only one request is pending
+              BUS_rpc_nack(addr,ptr[i+1]);
+            break;
+            case CMD_SEQ:
+              //sequence number is not known, all unacknowledged commands must be sent again
+              BUS_seq_nack(addr,-1,ptr[i+1]);
+            break;
+        }
+      }
+    break;
+    case CMD_ERR_REQ:
+      if(len<1){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      if(!ctl_mutex_lock(&err_req.mutex,CTL_TIMEOUT_NOW,0)){
+        resp=ERR_BUSY;
+        break;
+      }
+      //request type
+      err_req.type=ptr[0];
+      //address to send data to
+      err_req.dest=addr;
+      switch(ptr[0]){
+        case ERR_REQ_REPLAY:
+            err_req.size=(((unsigned short)ptr[1])<<8)|((unsigned short)ptr[2]);
+            err_req.level=ptr[3];
+        break;
+        default:
+            resp=ERR_INVALID_ARGUMENT;
+        break;
+      }
+      //check if the packet was parsed
+      if(!resp){
+        //send event to process request
+        ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ERR_REQ,0);
+      }
+    ctl_mutex_unlock(&err_req.mutex);
+    break;
+    case CMD_PING:
+        //this is a dummy command that does nothing
+    break;
+    case CMD_BUS_SPEED:
+      //check for proper length
+      if(len!=BUS_SPEED_CAPS_LEN){
+        resp=ERR_PK_LEN;
+        break;
+      }
+      //check for valid speeds
+      if(ptr[0]>=BUS_I2C_NUM_SPEEDS || ptr[1]>=BUS_SPI_NUM_SPEEDS){
+        resp=ERR_PK_BAD_PARM;
+        break;
+      }
+      //set new speeds
+      BUS_speed_set(ptr[0],ptr[1]);
+    break;
+    default:
+    #ifdef CDH_LIB
+      if(cmd==CMD_SUB_POWERUP){
+        char vresp;
+        unsigned char *end,vlen=len,i2c=BUS_I2C_SPEED_DEFAULT,spi=BUS_SPI_SPEED_DEFAULT;
+        //look for the end of the hash, speed capabilities follow it
+        if(len>sizeof(BUS_VERSION) && (end=memchr(ptr+sizeof(BUS_VERSION),0,len-sizeof(BUS_VERSION)))!=NULL){
+          //only compare the version part
+          vlen=end-ptr;
+          //check for speed capabilities
+          if(len>=vlen+1+BUS_SPEED_CAPS_LEN){
+            //get speeds
+            i2c=end[1];
+            spi=end[2];
+          }
+        }
+        //limit length to the size of the version
+        if(vlen>BUS_VERSION_LEN){
+          vlen=BUS_VERSION_LEN;
+        }
+        //copy into temporary word aligned variable
+        memcpy(tmp,ptr,vlen);
+        //compare to version string
+        if((vresp=BUS_version_cmp((BUS_VERSION*)tmp,vlen))){
+            //version mismatch
+            report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SUBSYSTEM_VERSION_MISMATCH,(((unsigned short)vresp)<<8)|addr);
+        }
+        //find a bus speed that works for all boards
+        BUS_speed_negotiate(addr,i2c,spi);
+        //set length to zero
+        len=0;
+      }
+    #endif
+      //get callback structure list
+      parse_ptr=cmd_parse_list;
+      //get mask from packet flags
+      parse_mask=flags;
+      //set response to unknown command
+      resp=ERR_UNKNOWN_CMD;
+      //check for a handler for this command
+      if((i=cmd_handler_idx[cmd]) && cmd_handlers[i-1].flags&parse_mask){
+        //check if handler should run in a worker task
+        if(!(cmd_handlers[i-1].flags&CMD_PARSE_DEFERRED) || nack&BUS_PARSE_INLINE || BUS_cmd_defer(addr,cmd,ptr,len,flags,nack,cmd_handlers[i-1].cb,cmd_parse_list)!=RET_SUCCESS){
+          //call handler
+          resp=cmd_handlers[i-1].cb(addr,cmd,ptr,len,flags);
+        }else{
+          //worker will handle the command
+          resp=0;
+        }
+      }
+      //loop through list and check for commands
+      while(parse_ptr!=NULL && resp==ERR_UNKNOWN_CMD){                
+        //check if flags match
+        if(parse_ptr->flags&parse_mask){
+          //check if callback should run in a worker task
+          if(parse_ptr->flags&CMD_PARSE_DEFERRED && !(nack&BUS_PARSE_INLINE)){
+            //workers only run deferred callbacks, the rest of the list is checked here first
+            if(def_ptr==NULL){
+              def_ptr=parse_ptr;
+            }
+          }else{
+            //check for subsystem command
+            resp=parse_ptr->cb(addr,cmd,ptr,len,flags);
+          }
+        }
+        //get next callback structure
+        parse_ptr=parse_ptr->next;
+      }
+      //check if a deferred callback may know the command
+      if(resp==ERR_UNKNOWN_CMD && def_ptr!=NULL){
+        if(BUS_cmd_defer(addr,cmd,ptr,len,flags,nack,def_ptr->cb,def_ptr->next)==RET_SUCCESS){
+          //worker will handle the command with the deferred callbacks
+          resp=0;
+        }else{
+          //no worker packet free, run deferred callbacks here
+          for(parse_ptr=def_ptr;parse_ptr!=NULL && resp==ERR_UNKNOWN_CMD;parse_ptr=parse_ptr->next){
+            if(parse_ptr->flags&parse_mask && parse_ptr->flags&CMD_PARSE_DEFERRED){
+              resp=parse_ptr->cb(addr,cmd,ptr,len,flags);
+            }
+          }
+        }
+      }
+    break;
+  }
+  #ifdef BUS_PROFILE
+    //commands inside CMD_SEQ and CMD_RPC are also counted on their own
+    BUS_prof_add(BUS_PROF_CMD_PARSE,BUS_PROF_TIMER-prof);
+  #endif
+  return resp;
+}
+
+//parse a command as if it was received from addr, used to measure dispatch time without a second board
+//only works if the library was built with BUS_PROFILE
+int BUS_prof_parse(unsigned char addr,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char flags){
+#ifdef BUS_PROFILE
+  return BUS_cmd_parse(addr,cmd,dat,len,flags,0);
+#else
+  return ERR_INVALID_ARGUMENT;
+#endif
+}
+
+//answer a request sent with BUS_cmd_txrx
+//commands without a request handler are parsed normally and only the result is sent back
+static void BUS_rpc_answer(unsigned char addr,unsigned char seq,unsigned char cmd,unsigned char *dat,unsigned short len,unsigned char flags){
+  unsigned char pk[BUS_I2C_HDR_LEN+BUS_I2C_MAX_PACKET_LEN+BUS_I2C_CRC_LEN],*ptr;
+  cmd_rpc_Callback cb;
+  unsigned short resp_len=0;
+  int resp;
+  //setup response
+  ptr=BUS_cmd_init(pk,CMD_RPC_RESP);
+  //check for a request handler
+  if((cb=BUS_rpc_handler(cmd))!=NULL){
+    //get response from handler
+    resp=cb(addr,cmd,dat,len,ptr+BUS_RPC_RESP_HDR_LEN,&resp_len);
+    //check response length
+    if(resp_len>BUS_RPC_RESP_MAX){
+      resp_len=0;
+      resp=ERR_BAD_PK;
+    }
+  }else{
+    //handle command, result is sent in the response instead of a NACK
+    //deferred callbacks run here so the result is known
+    resp=BUS_cmd_parse(addr,cmd,dat,len,flags,BUS_PARSE_INLINE);
+  }
+  //check for errors
+  if(resp!=0){
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_BAD_CMD,(((unsigned short)resp)<<8)|((unsigned short)cmd));
+    //don't send data with an error
+    resp_len=0;
+  }
+  //sequence number from request
+  ptr[0]=seq;
+  //result, sent as 16 bits so negative errors from handlers are not truncated
+  ptr[1]=((unsigned short)resp)>>8;
+  ptr[2]=resp;
+  //queue response, the ARCbus task can't wait for it to be sent
+  resp=BUS_cmd_tx_async(addr,pk,resp_len+BUS_RPC_RESP_HDR_LEN,0,NULL,0,NULL);
+  //check for errors
+  if(resp!=RET_SUCCESS){
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_RPC_RESP_FAIL,(((unsigned short)resp)<<8)|addr);
+  }
+}
+
+//send a response with only a status for a request that could not be run
+static void BUS_rpc_reject(unsigned char addr,unsigned char seq,short status){
+  unsigned char pk[BUS_I2C_HDR_LEN+BUS_RPC_RESP_HDR_LEN+BUS_I2C_CRC_LEN],*ptr;
+  int resp;
+  //report error
+  report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_BAD_CMD,(((unsigned short)status)<<8)|CMD_RPC);
+  //setup response
+  ptr=BUS_cmd_init(pk,CMD_RPC_RESP);
+  //sequence number from request
+  ptr[0]=seq;
+  //result
+  ptr[1]=((unsigned short)status)>>8;
+  ptr[2]=status;
+  //queue response, the ARCbus task can't wait for it to be sent
+  resp=BUS_cmd_tx_async(addr,pk,BUS_RPC_RESP_HDR_LEN,0,NULL,0,NULL);
+  //check for errors
+  if(resp!=RET_SUCCESS){
+    report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_RPC_RESP_FAIL,(((unsigned short)resp)<<8)|addr);
+  }
+}
+
+//get the next received packet, control packets come before bulk packets
+//returns -1 if no packets are waiting
+static short I2C_rx_next(void){
+  I2C_RX_QUEUE *q;
+  short idx=-1;
+  int i,en;
+  en=ctl_global_interrupts_disable();
+  for(i=0;i<BUS_I2C_RX_NUM_CLASS;i++){
+    q=&I2C_rx_queue[i];
+    //check for packets in the queue
+    if(q->num){
+      //get packet
+      idx=q->idx[q->out++];
+      //check for wraparound
+      if(q->out>=BUS_I2C_PACKET_QUEUE_LEN){
+        q->out=0;
+      }
+      q->num--;
+      break;
+    }
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return idx;
+}
+
+//set the receive class for a command, bulk commands are parsed after control commands
+int BUS_I2C_rx_class(unsigned char cmd,unsigned char cl){
+  int en;
+  //check class
+  if(cl>=BUS_I2C_RX_NUM_CLASS){
+    return ERR_INVALID_ARGUMENT;
+  }
+  en=ctl_global_interrupts_disable();
+  //set or clear bulk bit
+  if(cl==BUS_I2C_RX_BULK){
+    I2C_rx_bulk[cmd>>3]|=1<<(cmd&0x07);
+  }else{
+    I2C_rx_bulk[cmd>>3]&=~(1<<(cmd&0x07));
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return RET_SUCCESS;
+}
+
+//ARC bus Task, do ARC bus stuff
+static void ARC_bus_run(void *p) __toplevel{
+  unsigned int e;
+  unsigned char len;
+  unsigned char addr,cmd,flags;
+  int resp;
+  unsigned char pk[40];
+  unsigned char *ptr;
+  unsigned short crc;
+  int snd,i;
+  short idx;
+  BUS_FRAG_BUF *frag;
+  SPI_addr=0;
+  //Initialize ErrorLib
+  error_recording_start();
+  //init error request mutex
+  ctl_mutex_init(&err_req.mutex);
+  //initialize helper events
+  ctl_events_init(&BUS_helper_events,0);
+  //start helper task
+  ctl_task_run(&ARC_bus_helper_task,BUS_PRI_ARCBUS_HELPER,ARC_bus_helper,NULL,"ARC_Bus_helper",sizeof(helper_stack)/sizeof(helper_stack[0])-2,helper_stack+1,0);
+  //start worker tasks for deferred commands
+  BUS_worker_init();
+  
+  //event loop
+  for(;;){
+    //wait for something to happen, with a timeout if a board has been told to start a SPI transfer
+    e = ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&BUS_INT_events,BUS_INT_EV_ALL,(SPI_go_addr!=0)?CTL_TIMEOUT_ABSOLUTE:CTL_TIMEOUT_NONE,SPI_go_time);
+    //catch up time if ticks were skipped while idle
+    BUS_tick_resync();
+    //check if a board did not start its SPI transfer in time
+    if(SPI_go_addr!=0 && ((long)(ctl_get_current_time()-SPI_go_time))>=0){
+      //report error
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SPI_GO_TIMEOUT,SPI_go_addr);
+      //check if bad chunks were not sent again
+      if(SPI_chunk.stat==SPI_CHUNK_RESEND){
+        //free chunked transfer
+        SPI_chunk_stop();
+        //tell subsystem that the transfer failed
+        ctl_events_set_clear(&SUB_events,SUB_EV_SPI_ERR_CRC,0);
+      }
+      //give the next board a turn
+      SPI_go_addr=0;
+      SPI_queue_run();
+    }
+    //check if a waiting SPI transfer can start
+    if(e&BUS_INT_EV_SPI_NEXT){
+      SPI_queue_run();
+    }
+    //check if buffer can be unlocked
+    if(e&BUS_INT_EV_BUFF_UNLOCK){
+      //check for stream transfer
+      if(SPI_stream.stat!=SPI_STREAM_IDLE){
+        //free current chunk
+        BUS_SPI_stream_release();
+      }else if(SPI_dest==NULL){
+        //unlock buffer
+        SPI_buf_free();
+      }
+    }
+    //check if a stream chunk has been read
+    if(e&BUS_INT_EV_SPI_CHUNK_FREE){
+      //start next chunk if one is waiting
+      SPI_stream_next();
+      //free buffer if stream is done
+      SPI_stream_free();
+    }
+    //check if I2C mutex can be released
+    if(e&BUS_INT_EV_RELEASE_MUTEX){
+      //release I2C mutex
+      BUS_I2C_release();
+    }
+    //check if a SPI transaction is complete
+    if(e&BUS_INT_EV_SPI_COMPLETE){
+      //check for stream transfer
+      if(SPI_stream.stat==SPI_STREAM_RUN){
+        //check chunk and start the next one
+        SPI_stream_chunk();
+      //check for chunked transfer
+      }else if(SPI_chunk.stat==SPI_CHUNK_RUN){
+        //check chunk and receive the next one
+        SPI_chunk_done();
+      //check if SPI was in progress
+      }else if(SPI_addr){
+        //turn off SPI
+        SPI_deactivate();
+        //reply has been clocked out
+        SPI_reply_done(1);
+        //assemble CRC
+        crc=SPI_buf[arcBus_stat.spi_stat.len+1];//LSB
+        crc|=(((unsigned short)SPI_buf[arcBus_stat.spi_stat.len])<<8);//MSB
+        //check CRC
+        if(crc!=crc16(SPI_buf,arcBus_stat.spi_stat.len)){
+          //Bad CRC
+          //free buffer
+          SPI_buf_free();
+          //send event
+          ctl_events_set_clear(&SUB_events,SUB_EV_SPI_ERR_CRC,0);
+          //set return value for SPI complete packet
+          arcBus_stat.spi_stat.nack=ERR_BAD_CRC;
+        }else if(SPI_lz && (resp=SPI_lz_expand())!=RET_SUCCESS){
+          //could not decompress data, free buffer
+          SPI_buf_free();
+          //send event, data was good but had to be dropped
+          ctl_events_set_clear(&SUB_events,SUB_EV_SPI_ERR_BUSY,0);
+          //set return value for SPI complete packet
+          arcBus_stat.spi_stat.nack=resp;
+        }else if(SPI_dest!=NULL){
+          //save length
+          SPI_dest->len=arcBus_stat.spi_stat.len;
+          //buffer belongs to the caller now
+          SPI_dest->stat=BUS_SPI_RX_DONE;
+          //tell the caller that data was received
+          if(SPI_dest->e!=NULL){
+            ctl_events_set_clear(SPI_dest->e,SPI_dest->event,0);
+          }
+          //done with buffer
+          SPI_dest=NULL;
+          SPI_buf=NULL;
+          //set return value for SPI complete packet
+          arcBus_stat.spi_stat.nack=RET_SUCCESS;
+        }else{
+          //tell subsystem, SPI data received
+          //Subsystem must signal to free the buffer
+          ctl_events_set_clear(&SUB_events,SUB_EV_SPI_DAT,0);
+          //set return value for SPI complete packet
+          arcBus_stat.spi_stat.nack=RET_SUCCESS;
+        }
+        //tell helper thread to send SPI complete command
+        ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_SPI_COMPLETE_CMD,0);
+      }
+    }
+    //check if an I2C command has been received, control packets are parsed first
+    if(e&BUS_INT_EV_I2C_CMD_RX && (idx=I2C_rx_next())>=0){
+        //packet being parsed, only set to a valid index
+        I2C_rx_out=idx;
+        //check if packet is complete
+        if(I2C_rx_buf[I2C_rx_out].stat!=I2C_PACKET_STAT_COMPLETE){
+            //report error
+            report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_RX_BUF_STAT,I2C_rx_buf[I2C_rx_out].stat);
+            //disable interrupts
+            ctl_global_interrupts_set(0);
+            //put UCB0 into reset state
+            UCB0CTL1|=UCSWRST;   
+            //initialize I2C packet buffers and queues to empty state
+            BUS_I2C_rx_init();
+            //I2C mutex init
+            ctl_mutex_init(&arcBus_stat.i2c_stat.mutex);
+            //set I2C to idle mode
+            arcBus_stat.i2c_stat.mode=BUS_I2C_IDLE;
+            //bring UCB0 out of reset state
+            UCB0CTL1&=~UCSWRST;
+            //re-enable interrupts
+            ctl_global_interrupts_enable();
+        }else{
+        //clear response
+        resp=0;
+        //get length of payload, short packets are dropped by the receive interrupt
+        len=I2C_rx_buf[I2C_rx_out].len-BUS_I2C_CRC_LEN-BUS_I2C_HDR_LEN;
+        //get sender address
+        addr=CMD_ADDR_MASK&I2C_rx_buf[I2C_rx_out].dat[0];
+        //get packet flags
+        flags=I2C_rx_buf[I2C_rx_out].flags;
+        //get command type
+        cmd=I2C_rx_buf[I2C_rx_out].dat[1];
+        //point to the first payload byte
+        ptr=&I2C_rx_buf[I2C_rx_out].dat[2];
+        //check crc result from the receive interrupt
+        if(I2C_rx_buf[I2C_rx_out].crc==I2C_PACKET_CRC_GOOD){
+          //check for multiple command frame
+          if(cmd==CMD_MULTI){
+            //loop through commands in the frame
+            for(i=0;i<len;i+=BUS_MULTI_HDR_LEN+ptr[i+1]){
+              //check that the command header and payload fit in the frame
+              if(i+BUS_MULTI_HDR_LEN>len || i+BUS_MULTI_HDR_LEN+ptr[i+1]>len){
+                //report error for the frame
+                BUS_cmd_fail(addr,cmd,ERR_PK_LEN,I2C_rx_buf[I2C_rx_out].dat[0]&CMD_TX_NACK);
+                break;
+              }
+              //handle command
+              resp=BUS_cmd_parse(addr,ptr[i],ptr+i+BUS_MULTI_HDR_LEN,ptr[i+1],flags,I2C_rx_buf[I2C_rx_out].dat[0]&CMD_TX_NACK);
+              //check if command was recognized
+              if(resp!=0){
+                BUS_cmd_fail(addr,ptr[i],resp,I2C_rx_buf[I2C_rx_out].dat[0]&CMD_TX_NACK);
+              }
+            }
+          //check for part of a longer command
+          }else if(cmd==CMD_FRAG){
+            //add fragment to reassembly buffer
+            frag=BUS_frag_add(addr,ptr,len,&resp);
+            //check for errors
+            if(resp!=0){
+              BUS_cmd_fail(addr,cmd,resp,I2C_rx_buf[I2C_rx_out].dat[0]&CMD_TX_NACK);
+            }else if(frag!=NULL){
+              //whole command received, handle command
+              resp=BUS_cmd_parse(addr,frag->dat[0],frag->dat+1,frag->len-1,flags,I2C_rx_buf[I2C_rx_out].dat[0]&CMD_TX_NACK);
+              //check if command was recognized
+              if(resp!=0){
+                BUS_cmd_fail(addr,frag->dat[0],resp,I2C_rx_buf[I2C_rx_out].dat[0]&CMD_TX_NACK);
+              }
+              //done with buffer
+              frag->addr=0;
+            }
+          }else{
+            //handle command based on command type
+            resp=BUS_cmd_parse(addr,cmd,ptr,len,flags,I2C_rx_buf[I2C_rx_out].dat[0]&CMD_TX_NACK);
+            //check if command was recognized
+            if(resp!=0){
+              BUS_cmd_fail(addr,cmd,resp,I2C_rx_buf[I2C_rx_out].dat[0]&CMD_TX_NACK);
+            }
+          }
+        }else{
+          //CRC failed and sender requested a NACK, report error
+          report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_CMD_CRC,cmd);
+          //if command was not a NACK command send NACK
+          if(cmd!=CMD_NACK){
+            BUS_nack_post(addr,cmd,ERR_BAD_CRC);
+          }
+        }
+        //done with packet set status
+        I2C_rx_buf[I2C_rx_out].stat=I2C_PACKET_STAT_EMPTY;
+        //check for more packets
+        if(I2C_rx_queue[BUS_I2C_RX_CTL].num || I2C_rx_queue[BUS_I2C_RX_BULK].num){   
+          //There is still a packet set event again
+          ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_I2C_CMD_RX,0);
+        }
+      }
+    }
+    //check for errors and report
+    if(e&BUS_INT_EV_I2C_RX_BUSY){
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_I2C_RX_BUSY,0);
+    }
+    if(e&BUS_INT_EV_I2C_ARB_LOST){
+      report_error(ERR_LEV_DEBUG,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_I2C_ARB_LOST,0);
+    }
+    //Low side supply error
+    if(e&BUS_INT_EV_SVML){
+      //report error
+      report_error(ERR_LEV_CRITICAL,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SVML,0);
+    }
+    //high side supply error
+    if(e&BUS_INT_EV_SVMH){
+      //report error
+      report_error(ERR_LEV_CRITICAL,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SVMH,0);
+    }
+  }
+}
+    
+    
+//ARC bus Task, do ARC bus stuff
+static void ARC_bus_helper(void *p) __toplevel{
+  unsigned int e;
+  int resp,maxsize;
+  unsigned char *ptr,pk[BUS_I2C_HDR_LEN+BUS_VERSION_LEN+BUS_SPEED_CAPS_LEN+BUS_I2C_CRC_LEN];
+  unsigned short len;
+  #ifndef CDH_LIB         //Subsystem board 
+    //first send "I'm on" command
+    ptr=BUS_cmd_init(pk,CMD_SUB_POWERUP);//setup command
+    //copy in data part of struct
+    memcpy(ptr,&ARClib_vstruct,sizeof(BUS_VERSION));
+    //increment pointer
+    ptr+=sizeof(BUS_VERSION);
+    //write version into string
+    strlcpy((char*)ptr,ARClib_vstruct.hash,BUS_VERSION_HASH_LEN);
+    //skip hash and terminator
+    ptr+=strlen((char*)ptr)+1;
+    //send fastest speeds supported after the hash
+    *ptr++=BUS_speed_limit.i2c;
+    *ptr++=BUS_speed_limit.spi;
+    //get payload length
+    len=ptr-(pk+BUS_I2C_HDR_LEN);
+    //send command
+    resp=BUS_cmd_tx(BUS_ADDR_CDH,pk,len,0);
+      //check for failed send
+      if(resp!=RET_SUCCESS){
+        //give a warning
+        report_error(ERR_LEV_WARNING,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_CDH_NOT_FOUND,resp);
+        //wait a bit
+        ctl_timeout_wait(ctl_get_current_time()+30);
+        //resend
+        resp=BUS_cmd_tx(BUS_ADDR_CDH,pk,len,0);
+        //check for success
+        if(resp!=RET_SUCCESS){
+          //Failed
+          report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_CDH_NOT_FOUND,resp);     
+        }
+      }
+  #endif
+  for(;;){
+    e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&BUS_helper_events,BUS_HELPER_EV_ALL,CTL_TIMEOUT_NONE,0);
+    //catch up time if ticks were skipped while idle
+    BUS_tick_resync();
+    //async timer timed out, send data
+    if(e&BUS_HELPER_EV_ASYNC_TIMEOUT){
+      //send some data
+      async_send_data();
+    }
+    //SPI transaction is complete
+    if(e&BUS_HELPER_EV_SPI_COMPLETE_CMD){      
+      //done with SPI send command
+      ptr=BUS_cmd_init(pk,CMD_SPI_COMPLETE);
+      //send return to indicate success
+      *ptr=arcBus_stat.spi_stat.nack;
+      len=1;
+      //check for bad chunks to send again
+      if(SPI_chunk.stat==SPI_CHUNK_RESEND && arcBus_stat.spi_stat.nack==(unsigned char)ERR_BAD_CRC){
+        //send map of bad chunks
+        BUS_SPI_map_put(ptr+1,SPI_chunk.bad);
+        len+=BUS_SPI_CHUNK_MAP_LEN;
+      //check for full duplex transfer
+      }else if(SPI_duplex){
+        //send reply length MSB first
+        ptr[1]=SPI_reply_len>>8;
+        ptr[2]=SPI_reply_len;
+        len+=2;
+      }
+      //send data
+      resp=BUS_cmd_tx(SPI_addr,pk,len,0);
+      //check if command was successful and try again if it failed
+      if(resp!=RET_SUCCESS){
+        resp=BUS_cmd_tx(SPI_addr,pk,len,0);
+      }
+      //check if command sent successfully
+      if(resp!=RET_SUCCESS){
+        //report error
+        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SPI_COMPLETE_FAIL,resp);
+      }
+      //transaction complete, clear address
+      SPI_addr=0;
+      //start the next waiting transfer
+      ctl_events_set_clear(&BUS_INT_events,BUS_INT_EV_SPI_NEXT,0);
+    }
+    if(e&BUS_HELPER_EV_SPI_CLEAR_CMD){
+      //done with SPI send command
+      BUS_cmd_init(pk,CMD_SPI_CLEAR);
+      resp=BUS_cmd_tx(BUS_ADDR_CDH,pk,0,0);
+      //check if command was successful and try again if it failed
+      if(resp!=RET_SUCCESS){
+        resp=BUS_cmd_tx(BUS_ADDR_CDH,pk,0,0);
+      }
+      //check if command sent successfully
+      if(resp!=RET_SUCCESS){
+        //report error
+        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_SPI_CLEAR_FAIL,resp);
+      }
+    }
+    if(e&BUS_HELPER_EV_ASYNC_CLOSE){      
+      //close async connection
+      async_close_remote();
+      //send event
+      ctl_events_set_clear(&SUB_events,SUB_EV_ASYNC_CLOSE,0);
+    }
+    if(e&BUS_HELPER_EV_ERR_REQ){
+        //get mutex
+        if(ctl_mutex_lock(&err_req.mutex,CTL_TIMEOUT_DELAY,100)){
+            //get buffer
+            ptr=BUS_get_buffer(CTL_TIMEOUT_DELAY,100);
+            //check if buffer was aquired
+            if(ptr){
+              //set data type
+              ptr[0]=SPI_ERROR_DAT;
+              //set own address
+              ptr[1]=BUS_get_OA();
+              //get maximum size for data packet. part of the buffer is used to read errors into
+              maxsize=BUS_get_buffer_size()-512-2;
+              //check if requested size is greater then max
+              if(maxsize<err_req.size){
+                //set maxsize
+                err_req.size=maxsize;
+              }
+              //check request type
+              switch(err_req.type){
+                case ERR_REQ_REPLAY:
+                  //get errors
+                  error_log_mem_replay(ptr+2,err_req.size,err_req.level,ptr+2+maxsize);
+                break;
+              }
+              //send data
+              resp=BUS_SPI_txrx(err_req.dest,ptr,NULL,err_req.size+2);
+              //Check if data was sent
+              if(resp!=RET_SUCCESS){
+                  //report error
+                  report_error(ERR_LEV_ERROR,BUS_ERR_SRC_ERR_REQ,ERR_REQ_ERR_SPI_SEND,resp);
+              }
+              //free buffer
+              BUS_free_buffer();
+            }else{
+              //set flag so we try again
+              ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ERR_REQ,0);
+              //report error
+              report_error(ERR_LEV_ERROR,BUS_ERR_SRC_ERR_REQ,ERR_REQ_ERR_BUFFER_BUSY,0);
+            }
+            ctl_mutex_unlock(&err_req.mutex);
+        }else{
+          //set flag so we try again
+          ctl_events_set_clear(&BUS_helper_events,BUS_HELPER_EV_ERR_REQ,0);
+          //report error
+          report_error(ERR_LEV_ERROR,BUS_ERR_SRC_ERR_REQ,ERR_REQ_ERR_MUTEX_TIMEOUT,0);
+        }
+    }
+    if(e&BUS_HELPER_EV_SPEED){
+      //set SPI speed, used for the next transaction
+      SPI_set_speed(BUS_speed_req.spi);
+      //save old I2C speed
+      len=arcBus_stat.i2c_stat.speed;
+      //set I2C speed
+      resp=BUS_I2C_set_speed(BUS_speed_req.i2c);
+      //check for errors
+      if(resp!=RET_SUCCESS){
+        //report error
+        report_error(ERR_LEV_ERROR,BUS_ERR_SRC_I2C,I2C_ERR_SPEED_FAIL,resp);
+      }else if(len!=arcBus_stat.i2c_stat.speed){
+        //report new speed
+        report_error(ERR_LEV_INFO,BUS_ERR_SRC_I2C,I2C_ERR_SPEED_CHANGE,(len<<8)|arcBus_stat.i2c_stat.speed);
+      }
+    }
+    if(e&BUS_HELPER_EV_NACK){
+      //send queued NACKs, the queue may already be empty if NACKs were sent with an earlier event
+      BUS_nack_send();
+    }
+    if(e&BUS_HELPER_EV_I2C_TX_DONE){
+      //count errors and notify for queued packets that were sent
+      BUS_I2C_tx_finish();
+    }
+  }
+}
+
+//=======================================================================================
+//                                 [Main Loop]
+//=======================================================================================
+
+//main loop function, start ARC_Bus task then enter Idle task
+void mainLoop(void) __toplevel{
+  //initialize events
+  ctl_events_init(&BUS_INT_events,0);
+  //start ARCbus task
+  ctl_task_run(&ARC_bus_task,BUS_PRI_ARCBUS,ARC_bus_run,NULL,"ARC_Bus",sizeof(BUS_stack)/sizeof(BUS_stack[0])-2,BUS_stack+1,0);
+  //kick WDT to give us some time
+  WDT_KICK();
+  // drop to lowest priority to start created tasks running.
+  ctl_task_set_priority(&idle_task,0); 
+  
+  //main idle loop
+  //NOTE that this task should never wait to ensure that there is always a runnable task
+  for(;;){    
+    //kick watchdog
+    WDT_KICK();
+    //skip ticks until the next deadline if tickless idle is enabled and go to low power mode
+    BUS_tick_sleep();
+    //catch up time once per wakeup, interrupts don't do this
+    BUS_tick_resync();
+  }
+}
+
+//main loop testing function, start ARC_Bus task then enter Idle task
+void mainLoop_testing(void (*cb)(void)) __toplevel{
+  //initialize events
+  ctl_events_init(&BUS_INT_events,0);
+  //start ARCbus task
+  ctl_task_run(&ARC_bus_task,BUS_PRI_ARCBUS,ARC_bus_run,NULL,"ARC_Bus",sizeof(BUS_stack)/sizeof(BUS_stack[0])-2,BUS_stack+1,0);
+  //kick WDT to give us some time
+  WDT_KICK();
+  // drop to lowest priority to start created tasks running.
+  ctl_task_set_priority(&idle_task,0); 
+  
+  //main idle loop
+  //NOTE that this task should never wait to ensure that there is always a runnable task
+  for(;;){    
+      //call the callback
+      cb();
+  }
+}
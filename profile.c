@@ -0,0 +1,77 @@
+#include <ctl.h>
+#include <msp430.h>
+#include <stdlib.h>
+#include "ARCbus.h"
+#include "ARCbus_internal.h"
+
+#ifdef BUS_PROFILE
+
+//cycle counts for profiled sections
+static BUS_PROF_STAT prof_stat[BUS_PROF_NUM];
+//set to use DMA for I2C master packets, cleared to compare against the interrupt only path
+unsigned char BUS_prof_dma_en=1;
+
+//start TA2 counting SMCLK cycles for profiling
+void BUS_prof_init(void){
+  //count SMCLK cycles in continuous mode
+  TA2CTL=TASSEL_2|ID_0|MC_2|TACLR;
+}
+
+//add cycles for a profiled section, can be called from an ISR
+void BUS_prof_add(unsigned char id,unsigned short cycles){
+  int en=ctl_global_interrupts_disable();
+  //count section
+  prof_stat[id].count++;
+  prof_stat[id].total+=cycles;
+  //save longest time
+  if(cycles>prof_stat[id].max){
+    prof_stat[id].max=cycles;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+#endif
+
+//get cycle counts for a profiled section, returns ERR_INVALID_ARGUMENT if the library was not built with BUS_PROFILE
+int BUS_prof_get(unsigned char id,BUS_PROF_STAT *st){
+#ifdef BUS_PROFILE
+  int en;
+  //check id
+  if(id>=BUS_PROF_NUM){
+    return ERR_INVALID_ARGUMENT;
+  }
+  en=ctl_global_interrupts_disable();
+  //copy stats
+  *st=prof_stat[id];
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return RET_SUCCESS;
+#else
+  return ERR_INVALID_ARGUMENT;
+#endif
+}
+
+//clear cycle counts for all profiled sections
+void BUS_prof_clear(void){
+#ifdef BUS_PROFILE
+  int i,en=ctl_global_interrupts_disable();
+  for(i=0;i<BUS_PROF_NUM;i++){
+    prof_stat[i].count=0;
+    prof_stat[i].total=0;
+    prof_stat[i].max=0;
+  }
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+#endif
+}
+
+//use DMA for I2C master packets, used to compare cycles with and without DMA. only works if the library was built with BUS_PROFILE
+void BUS_prof_i2c_dma(int en){
+#ifdef BUS_PROFILE
+  BUS_prof_dma_en=(en!=0);
+#endif
+}
@@ -1,55 +1,73 @@
-#include <msp430.h>
-#include "ARCbus.h"
-#include "ARCbus_internal.h"
-
-//==============[SPI mode switching commands]==============
-
-//setup UCA0 for master operation
-void SPI_master_setup(void){
-  //clear NACK status
-  arcBus_stat.spi_stat.nack=0;
-  //set mode
-  arcBus_stat.spi_stat.mode=BUS_SPI_MASTER;
-  //put UCA0 into master mode
-  UCA0CTLW0|=UCMST;
-  #ifdef CDH_LIB
-      //disable pull resistors for SPI pins only on CDH
-      P3REN&=~(BUS_PINS_SPI);
-  #endif
-  //set pins for SPI usage
-  P3SEL0|=BUS_PINS_SPI;
-  //bring UCA0 out of reset state
-  UCA0CTLW0&=~UCSWRST;
-}
-
-//setup UCA0 for slave operation
-void SPI_slave_setup(void){
-  //clear NACK status
-  arcBus_stat.spi_stat.nack=0;
-  //set mode
-  arcBus_stat.spi_stat.mode=BUS_SPI_SLAVE;
-  //put UCA0 into slave mode
-  UCA0CTLW0&=~UCMST;
-  #ifdef CDH_LIB
-      //disable pull resistors for SPI pins only on CDH
-      P3REN&=~(BUS_PINS_SPI);
-  #endif
-  //set pins for SPI usage
-  P3SEL0|=BUS_PINS_SPI;
-  //bring UCA0 out of reset state
-  UCA0CTLW0&=~UCSWRST;
-}
-
-//put UCA0 into reset state
-void SPI_deactivate(void){
-  //put UCA0 into reset state
-  UCA0CTLW0|=UCSWRST;
-  //set pins as inputs
-  P3SEL0&=~(BUS_PINS_SPI);
-  #ifdef CDH_LIB
-      //enable pull resistors for SPI pins only on CDH
-      P3REN|=BUS_PINS_SPI;
-  #endif
-  //set mode
-  arcBus_stat.spi_stat.mode=BUS_SPI_IDLE;
-}
+#include <msp430.h>
+#include "ARCbus.h"
+#include "ARCbus_internal.h"
+
+//SPI prescaler values for each bus speed off of 20MHz SMCLK
+static const unsigned short SPI_brw[BUS_SPI_NUM_SPEEDS]={80,20,5,2};
+
+//==============[SPI mode switching commands]==============
+
+//setup UCA0 for master operation
+void SPI_master_setup(void){
+  //clear NACK status
+  arcBus_stat.spi_stat.nack=0;
+  //set mode
+  arcBus_stat.spi_stat.mode=BUS_SPI_MASTER;
+  //SPI uses DMA2 so I2C can not
+  BUS_I2C_DMA_stop();
+  //put UCA0 into master mode
+  UCA0CTLW0|=UCMST;
+  //set SPI clock speed, UCA0 is in reset so this is safe to change
+  UCA0BRW=SPI_brw[arcBus_stat.spi_stat.speed];
+  #ifdef CDH_LIB
+      //disable pull resistors for SPI pins only on CDH
+      P3REN&=~(BUS_PINS_SPI);
+  #endif
+  //set pins for SPI usage
+  P3SEL0|=BUS_PINS_SPI;
+  //bring UCA0 out of reset state
+  UCA0CTLW0&=~UCSWRST;
+}
+
+//setup UCA0 for slave operation
+void SPI_slave_setup(void){
+  //clear NACK status
+  arcBus_stat.spi_stat.nack=0;
+  //set mode
+  arcBus_stat.spi_stat.mode=BUS_SPI_SLAVE;
+  //SPI uses DMA2 so I2C can not
+  BUS_I2C_DMA_stop();
+  //put UCA0 into slave mode
+  UCA0CTLW0&=~UCMST;
+  #ifdef CDH_LIB
+      //disable pull resistors for SPI pins only on CDH
+      P3REN&=~(BUS_PINS_SPI);
+  #endif
+  //set pins for SPI usage
+  P3SEL0|=BUS_PINS_SPI;
+  //bring UCA0 out of reset state
+  UCA0CTLW0&=~UCSWRST;
+}
+
+//put UCA0 into reset state
+void SPI_deactivate(void){
+  //put UCA0 into reset state
+  UCA0CTLW0|=UCSWRST;
+  //set pins as inputs
+  P3SEL0&=~(BUS_PINS_SPI);
+  #ifdef CDH_LIB
+      //enable pull resistors for SPI pins only on CDH
+      P3REN|=BUS_PINS_SPI;
+  #endif
+  //set mode
+  arcBus_stat.spi_stat.mode=BUS_SPI_IDLE;
+}
+
+//set SPI master clock speed, used when the next transaction is started
+void SPI_set_speed(unsigned char speed){
+  //check speed
+  if(speed<BUS_SPI_NUM_SPEEDS){
+    //save speed
+    arcBus_stat.spi_stat.speed=speed;
+  }
+}
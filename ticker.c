@@ -1,41 +1,221 @@
-#include <ctl.h>
-#include <msp430.h>
-#include <stdio.h>
-#include "ARCbus.h"
-
-//ticker to keep track of time
-ticker ticker_time;
-
-//=================[Time ticker functions]=================
-
-//get current ticker time
-ticker get_ticker_time(void){
-  ticker tmp;
-  int en=ctl_global_interrupts_disable();
-  tmp=ticker_time;
-  if(en){
-    ctl_global_interrupts_enable();
-  }
-  return tmp;
-}
-
-//set current ticker time
-void set_ticker_time(ticker nt){
-  int en=ctl_global_interrupts_disable();
-  ticker_time=nt;
-  if(en){
-    ctl_global_interrupts_enable();
-  }
-}
-
-//set current ticker time and return old time
-ticker setget_ticker_time(ticker nt){
-  ticker tmp;
-  int en=ctl_global_interrupts_disable();
-  tmp=ticker_time;
-  ticker_time=nt;
-  if(en){
-    ctl_global_interrupts_enable();
-  }
-  return tmp;
-}
+#include <ctl.h>
+#include <msp430.h>
+#include <stdio.h>
+#include "ARCbus.h"
+#include "ARCbus_internal.h"
+
+//ticker to keep track of time
+ticker ticker_time;
+//ticks since startup, this is never set so it only goes forward
+unsigned long long ticker_mono;
+//TA1R count when the last tick happened
+unsigned short ticker_ta;
+//incremented before and after the time is changed, odd while the time is being changed
+volatile unsigned short ticker_seq;
+
+//=================[Time ticker functions]=================
+
+//get current ticker time
+//the tick interrupt is not masked, the time is read again if a tick happens while it is being read
+ticker get_ticker_time(void){
+  ticker tmp;
+  unsigned short seq;
+  do{
+    seq=ticker_seq;
+    tmp=*(volatile ticker*)&ticker_time;
+  }while(seq&1 || seq!=ticker_seq);
+  return tmp;
+}
+
+//set current ticker time
+void set_ticker_time(ticker nt){
+  int en=ctl_global_interrupts_disable();
+  //time is changing
+  ticker_seq++;
+  ticker_time=nt;
+  //done changing time
+  ticker_seq++;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+}
+
+//set current ticker time and return old time
+ticker setget_ticker_time(ticker nt){
+  ticker tmp;
+  int en=ctl_global_interrupts_disable();
+  //time is changing
+  ticker_seq++;
+  tmp=ticker_time;
+  ticker_time=nt;
+  //done changing time
+  ticker_seq++;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  return tmp;
+}
+
+//get ticks since startup, sub is set to the 32.768kHz timer counts since the last tick if it is not NULL
+//this is not changed by set_ticker_time so it can be used to measure time
+unsigned long long BUS_time_ticks(unsigned short *sub){
+  unsigned long long tmp;
+  unsigned short seq,cnt;
+  do{
+    seq=ticker_seq;
+    tmp=*(volatile unsigned long long*)&ticker_mono;
+    //get timer counts since the tick
+    cnt=readTA1()-*(volatile unsigned short*)&ticker_ta;
+  }while(seq&1 || seq!=ticker_seq);
+  //return sub tick time
+  if(sub!=NULL){
+    *sub=cnt;
+  }
+  return tmp;
+}
+
+//get microseconds since startup, resolution is one 32.768kHz timer count (about 30us)
+unsigned long long BUS_time_now_us(void){
+  unsigned long long t;
+  unsigned short sub;
+  //get time
+  t=BUS_time_ticks(&sub);
+  //convert to 32.768kHz counts then to microseconds, 1000000/32768=15625/512
+  return (((t<<5)+sub)*15625)>>9;
+}
+
+//=================[Time synchronization]=================
+
+//timer counts to send the I2C address byte at each bus speed, the receive time is taken after this
+static const unsigned char time_addr_delay[BUS_I2C_NUM_SPEEDS]={6,3,1,0};
+//timer counts left to add to the time, positive if this board is behind
+static long time_slew=0;
+//estimated drift in timer counts per 65536 ticks, positive if this board is slow
+static long time_drift=0;
+//drift accumulated since the last whole count
+static long time_drift_acc=0;
+//local time of the last sync, zero if there is no sync to measure drift from
+static ticker time_sync_last=0;
+//last measured offset in timer counts
+static long time_sync_ofs=0;
+
+//extra timer counts between ticks for the next tick, called from the tick interrupt after n ticks
+//returns -1 to make the next tick early, 1 to make it late or 0
+short BUS_time_slew_step(unsigned short n){
+  //add drift for the ticks that passed
+  time_drift_acc+=time_drift*n;
+  //move whole counts into the slew
+  while(time_drift_acc>=65536){
+    time_drift_acc-=65536;
+    time_slew++;
+  }
+  while(time_drift_acc<=-65536){
+    time_drift_acc+=65536;
+    time_slew--;
+  }
+  //slew one count per tick
+  if(time_slew>0){
+    //behind, shorten the next tick
+    time_slew--;
+    return -1;
+  }
+  if(time_slew<0){
+    //ahead, lengthen the next tick
+    time_slew++;
+    return 1;
+  }
+  return 0;
+}
+
+//put the current time into a packet, 4 bytes of ticker time and 2 bytes of timer counts since the tick, sent MSB first
+//should be called with interrupts disabled so the time is close to when the packet is sent
+void BUS_time_stamp(unsigned char *ptr){
+  ticker t;
+  unsigned short sub;
+  int en=ctl_global_interrupts_disable();
+  //get time, sub can be more than a tick while ticks are skipped
+  //the receiver adds ticks and counts so the time is still right
+  t=ticker_time;
+  sub=readTA1()-ticker_ta;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  //write time
+  ptr[0]=t>>24;
+  ptr[1]=t>>16;
+  ptr[2]=t>>8;
+  ptr[3]=t;
+  //write sub tick time
+  ptr[4]=sub>>8;
+  ptr[5]=sub;
+}
+
+//update time from a time received from CDH, rt and rsub is the remote time and lt and lsub is the local time when it was received
+//small offsets are removed slowly by changing the tick length, large offsets step the time
+void BUS_time_sync(ticker rt,unsigned short rsub,ticker lt,unsigned short lsub){
+  ticker nt,ot,dt;
+  long ofs,drift;
+  int en;
+  //get difference in ticks
+  dt=rt-lt;
+  //check if the time is too far off to slew
+  if(dt>BUS_TIME_STEP_MAX && -dt>BUS_TIME_STEP_MAX){
+    en=ctl_global_interrupts_disable();
+    //step the time by the difference so time since the packet was received is kept
+    ot=ticker_time;
+    nt=ot+dt;
+    set_ticker_time(nt);
+    //stop slewing
+    time_slew=0;
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+    //drift can't be measured across a step
+    time_sync_last=0;
+    time_sync_ofs=0;
+    //trigger any alarms that were skipped
+    BUS_alarm_ticker_update(nt,ot);
+    return;
+  }
+  //get offset in timer counts, the receive time is taken after the address is sent
+  ofs=((long)dt)*32+(long)rsub-(long)lsub+time_addr_delay[arcBus_stat.i2c_stat.speed];
+  en=ctl_global_interrupts_disable();
+  //the part of the offset that was not being slewed out is from drift
+  drift=ofs-time_slew;
+  //slew out the new offset
+  time_slew=ofs;
+  if(en){
+    ctl_global_interrupts_enable();
+  }
+  //update drift estimate if there was a recent sync with a small offset
+  if(time_sync_last!=0 && lt-time_sync_last>=BUS_TIME_DRIFT_MIN && lt-time_sync_last<=BUS_TIME_DRIFT_MAX && drift<BUS_TIME_DRIFT_OFS_MAX && drift>-BUS_TIME_DRIFT_OFS_MAX){
+    //convert to counts per 65536 ticks, only move part of the way to filter noise
+    drift=(drift*65536)/(long)(lt-time_sync_last);
+    drift=time_drift+drift/BUS_TIME_DRIFT_GAIN;
+    //limit drift
+    if(drift>BUS_TIME_DRIFT_LIMIT){
+      drift=BUS_TIME_DRIFT_LIMIT;
+    }else if(drift<-BUS_TIME_DRIFT_LIMIT){
+      drift=-BUS_TIME_DRIFT_LIMIT;
+    }
+    //set new drift, the tick interrupt uses this
+    en=ctl_global_interrupts_disable();
+    time_drift=drift;
+    if(en){
+      ctl_global_interrupts_enable();
+    }
+  }
+  //save sync time and offset
+  time_sync_last=lt;
+  time_sync_ofs=ofs;
+}
+
+//get the last measured time offset in timer counts and the drift estimate in timer counts per 65536 ticks
+void BUS_time_sync_stat(long *ofs,long *drift){
+  if(ofs!=NULL){
+    *ofs=time_sync_ofs;
+  }
+  if(drift!=NULL){
+    *drift=time_drift;
+  }
+}
@@ -0,0 +1,145 @@
+#include <ctl.h>
+#include <msp430.h>
+#include <string.h>
+#include <Error.h>
+#include "ARCbus.h"
+#include "ARCbus_internal.h"
+
+//status of worker packets
+enum{BUS_WORKER_PK_FREE=0,BUS_WORKER_PK_USED};
+
+//deferred command waiting for a worker task
+typedef struct{
+  unsigned char stat;
+  unsigned char addr;
+  unsigned char cmd;
+  unsigned char flags;
+  //set if the sender requested a NACK
+  unsigned char nack;
+  unsigned char len;
+  //first callback to run
+  cmd_parse_Callback cb;
+  //rest of the callback list, deferred callbacks in it are tried if the callback does not know the command
+  CMD_PARSE_DAT *next;
+  unsigned char dat[BUS_I2C_MAX_PACKET_LEN];
+}BUS_WORKER_PK;
+
+//packets for deferred commands
+static BUS_WORKER_PK worker_pk[BUS_WORKER_PK_NUM];
+
+//queue of packets waiting for a worker
+static CTL_MESSAGE_QUEUE_t worker_queue;
+static void *worker_msg[BUS_WORKER_PK_NUM];
+
+//worker tasks
+static CTL_TASK_t worker_tasks[BUS_WORKER_NUM];
+//stacks for worker tasks
+static unsigned worker_stack[BUS_WORKER_NUM][BUS_WORKER_STACK_SIZE];
+//worker task priorities
+static unsigned char worker_pri[BUS_WORKER_NUM]={BUS_PRI_NORMAL,BUS_PRI_NORMAL};
+//set once worker tasks are started
+static unsigned char worker_running=0;
+
+//worker task, run deferred commands
+static void BUS_worker(void *p) __toplevel{
+  BUS_WORKER_PK *pk;
+  CMD_PARSE_DAT *parse_ptr;
+  int resp;
+  for(;;){
+    //wait for a command
+    ctl_message_queue_receive(&worker_queue,(void**)&pk,CTL_TIMEOUT_NONE,0);
+    //run callback
+    resp=pk->cb(pk->addr,pk->cmd,pk->dat,pk->len,pk->flags);
+    //try the rest of the deferred callbacks if the command was not known
+    //other callbacks run in the ARCbus task and are not reentrant so they are skipped
+    for(parse_ptr=pk->next;parse_ptr!=NULL && resp==ERR_UNKNOWN_CMD;parse_ptr=parse_ptr->next){
+      //check if flags match
+      if(parse_ptr->flags&pk->flags && parse_ptr->flags&CMD_PARSE_DEFERRED){
+        //check for subsystem command
+        resp=parse_ptr->cb(pk->addr,pk->cmd,pk->dat,pk->len,pk->flags);
+      }
+    }
+    //check if command failed
+    if(resp!=0){
+      report_error(ERR_LEV_ERROR,BUS_ERR_SRC_MAIN_LOOP,MAIN_LOOP_ERR_BAD_CMD,(((unsigned short)resp)<<8)|((unsigned short)pk->cmd));
+      //check if a NACK was requested
+      if(pk->nack&CMD_TX_NACK){
+        //queue NACK, it is combined with other NACKs to the same board by the helper task
+        BUS_nack_post(pk->addr,pk->cmd,resp);
+      }
+    }
+    //done with packet
+    pk->stat=BUS_WORKER_PK_FREE;
+  }
+}
+
+//start worker tasks for deferred command callbacks
+void BUS_worker_init(void){
+  int i;
+  //initialize queue
+  ctl_message_queue_init(&worker_queue,worker_msg,BUS_WORKER_PK_NUM);
+  //start tasks
+  for(i=0;i<BUS_WORKER_NUM;i++){
+    ctl_task_run(&worker_tasks[i],worker_pri[i],BUS_worker,NULL,"ARC_Bus_worker",BUS_WORKER_STACK_SIZE-2,worker_stack[i]+1,0);
+  }
+  //workers are running
+  worker_running=1;
+}
+
+//set the priority of a worker task that runs deferred command callbacks
+int BUS_worker_priority(unsigned char worker,unsigned char pri){
+  //check worker
+  if(worker>=BUS_WORKER_NUM){
+    return ERR_INVALID_ARGUMENT;
+  }
+  //save priority
+  worker_pri[worker]=pri;
+  //change priority if the task is running
+  if(worker_running){
+    ctl_task_set_priority(&worker_tasks[worker],pri);
+  }
+  return RET_SUCCESS;
+}
+
+//hand a command to a worker task, returns ERR_BUSY if no worker packets are free
+int BUS_cmd_defer(unsigned char addr,unsigned char cmd,const unsigned char *dat,unsigned short len,unsigned char flags,unsigned char nack,cmd_parse_Callback cb,CMD_PARSE_DAT *next){
+  BUS_WORKER_PK *pk=NULL;
+  int i;
+  //check that workers are running
+  if(!worker_running){
+    return ERR_BUSY;
+  }
+  //reassembled fragments don't fit in a worker packet, run them in the ARCbus task
+  if(len>BUS_I2C_MAX_PACKET_LEN){
+    return ERR_PACKET_TOO_LONG;
+  }
+  //find a free packet, only the ARCbus task allocates packets
+  for(i=0;i<BUS_WORKER_PK_NUM;i++){
+    if(worker_pk[i].stat==BUS_WORKER_PK_FREE){
+      pk=&worker_pk[i];
+      break;
+    }
+  }
+  //check if a packet was found
+  if(pk==NULL){
+    return ERR_BUSY;
+  }
+  //setup packet
+  pk->stat=BUS_WORKER_PK_USED;
+  pk->addr=addr;
+  pk->cmd=cmd;
+  pk->flags=flags;
+  pk->nack=nack;
+  pk->len=len;
+  pk->cb=cb;
+  pk->next=next;
+  //copy payload, receive buffer is reused once the ARCbus task is done with it
+  memcpy(pk->dat,dat,len);
+  //give packet to a worker
+  if(!ctl_message_queue_post_nb(&worker_queue,pk)){
+    //queue full, free packet
+    pk->stat=BUS_WORKER_PK_FREE;
+    return ERR_BUSY;
+  }
+  return RET_SUCCESS;
+}